@@ -10,25 +10,59 @@ SOURCES += \
     src/core/main.cpp \
     src/core/mainwindow.cpp \
     src/config/config.cpp \
+    src/config/exclusion_set.cpp \
     src/utils/logger.cpp \
+    src/utils/flight_recorder.cpp \
+    src/utils/foreground_tracker.cpp \
+    src/utils/latency_stats.cpp \
+    src/utils/latency_dialog.cpp \
+    src/utils/trace_recorder.cpp \
+    src/audio/audio_engine.cpp \
     src/audio/audio_muter.cpp \
+    src/audio/audio_session_index.cpp \
+    src/audio/device_registry.cpp \
+    src/audio/process_identity_cache.cpp \
+    src/audio/process_tree.cpp \
+    src/audio/simulated_audio_backend.cpp \
+    src/audio/wasapi_audio_backend.cpp \
+    src/audio/windows_process_probe.cpp \
     src/config/settings_manager.cpp \
     src/utils/process_selection_dialog.cpp \
     src/utils/theme_manager.cpp \
     src/utils/update_manager.cpp \
+    src/utils/hotkey_matcher.cpp \
     src/utils/keyboard_hook.cpp \
     src/utils/volume_osd.cpp
 
 HEADERS += \
     src/core/mainwindow.h \
     src/config/config.h \
+    src/config/exclusion_set.h \
     src/utils/logger.h \
+    src/utils/flight_recorder.h \
+    src/utils/foreground_tracker.h \
+    src/utils/latency_stats.h \
+    src/utils/latency_dialog.h \
+    src/utils/trace_recorder.h \
+    src/audio/audio_engine.h \
     src/audio/audio_muter.h \
+    src/audio/audio_backend.h \
+    src/audio/audio_batch.h \
+    src/audio/audio_session_index.h \
+    src/audio/device_registry.h \
+    src/audio/process_identity_cache.h \
+    src/audio/process_tree.h \
+    src/audio/session_visitor.h \
+    src/audio/simulated_audio_backend.h \
+    src/audio/wasapi_audio_backend.h \
+    src/audio/windows_process_probe.h \
     src/config/settings_manager.h \
     src/utils/process_selection_dialog.h \
     src/utils/theme_manager.h \
     src/utils/update_manager.h \
+    src/utils/hotkey_matcher.h \
     src/utils/keyboard_hook.h \
+    src/utils/spsc_queue.h \
     src/utils/volume_osd.h
 
 FORMS += \
@@ -52,6 +86,9 @@ TARGET = MuteActiveWindowC
 VERSION = 2.2.1
 DEFINES += APP_VERSION=\\\"$$VERSION\\\"
 
+# Compile trace-level logging out of release builds
+CONFIG(release, debug|release): DEFINES += MAW_STRIP_TRACE_LOGS
+
 # Auto-deploy after build (Release only)
 win32:CONFIG(release, release|debug) {
     QMAKE_POST_LINK = $$(QTDIR)/bin/windeployqt.exe $$shell_quote($$OUT_PWD/release/$$shell_quote($$TARGET).exe) --no-compiler-runtime --no-translations --no-system-d3d-compiler --no-opengl-sw && \
@@ -0,0 +1,41 @@
+# Benchmarks for the platform-neutral muting engine, driven by
+# SimulatedAudioBackend. Builds and runs without Windows:
+#   qmake bench.pro && make && ./bench --output results.json
+QT = core
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = bench
+
+SOURCES += \
+    main.cpp \
+    ../src/audio/audio_muter.cpp \
+    ../src/audio/audio_session_index.cpp \
+    ../src/audio/process_identity_cache.cpp \
+    ../src/audio/process_tree.cpp \
+    ../src/audio/simulated_audio_backend.cpp \
+    ../src/config/exclusion_set.cpp \
+    ../src/utils/hotkey_matcher.cpp \
+    ../src/utils/latency_stats.cpp \
+    ../src/utils/logger.cpp \
+    ../src/utils/trace_recorder.cpp
+
+HEADERS += \
+    ../src/audio/audio_backend.h \
+    ../src/audio/audio_batch.h \
+    ../src/audio/audio_muter.h \
+    ../src/audio/audio_session_index.h \
+    ../src/audio/process_identity_cache.h \
+    ../src/audio/process_tree.h \
+    ../src/audio/session_visitor.h \
+    ../src/audio/simulated_audio_backend.h \
+    ../src/config/exclusion_set.h \
+    ../src/utils/hotkey_matcher.h \
+    ../src/utils/latency_stats.h \
+    ../src/utils/logger.h \
+    ../src/utils/trace_recorder.h
+
+INCLUDEPATH += ../src/audio \
+               ../src/config \
+               ../src/utils
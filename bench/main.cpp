@@ -0,0 +1,1403 @@
+// Benchmarks for the muting engine's platform-neutral code: matching,
+// exclusions and volume math against SimulatedAudioBackend, the parallel
+// device scan, the process identity cache, hot-path logging, hotkey
+// matching and the process tree behind family muting. Results go to stdout
+// (or --output) as JSON; progress goes to stderr.
+
+#include "audio_muter.h"
+#include "exclusion_set.h"
+#include "hotkey_matcher.h"
+#include "logger.h"
+#include "process_identity_cache.h"
+#include "process_tree.h"
+#include "simulated_audio_backend.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+#include <QStringList>
+#include <QTextStream>
+#include <QThread>
+#include <QVector>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <new>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Allocation counting. With glibc every malloc is counted, which covers
+// QString's buffers as well as operator new; elsewhere only operator new is.
+// Only the thread that switched counting on is counted, so background
+// threads such as the log writer stay out of the numbers.
+
+static thread_local bool t_countAllocations = false;
+static std::atomic<quint64> g_allocations(0);
+
+static inline void countAllocation() {
+    if (t_countAllocations) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+#if defined(__GLIBC__)
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+extern "C" void *malloc(size_t size) {
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) {
+    countAllocation();
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size) {
+    countAllocation();
+    return __libc_realloc(ptr, size);
+}
+
+static const char *const ALLOCATION_COUNTER = "malloc";
+#else
+void *operator new(size_t size) {
+    countAllocation();
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+static const char *const ALLOCATION_COUNTER = "operator new";
+#endif
+
+// Results computed inside a measured loop are stored here so they are not optimized away
+static volatile bool g_sink;
+
+// Checks failed by any suite; main() exits non-zero if there were any
+static int g_failedChecks = 0;
+
+// ---------------------------------------------------------------------------
+// Measurement
+
+struct Options {
+    int minTimeMs = 20;     // Per case, after one warm-up run
+    int minReps = 5;
+    QString keyStreamPath;  // Recorded key events for the hotkey suite
+};
+
+struct Measurement {
+    int reps = 0;
+    qint64 minNs = 0;
+    qint64 medianNs = 0;
+    qint64 p95Ns = 0;
+    qint64 meanNs = 0;
+};
+
+// Run `op` once to warm up, then repeatedly until both minimums are met
+template <typename Op>
+static Measurement measure(const Options& options, Op&& op) {
+    op(0);
+
+    std::vector<qint64> samples;
+    QElapsedTimer total;
+    total.start();
+    QElapsedTimer timer;
+    for (int rep = 1; rep <= options.minReps || total.elapsed() < options.minTimeMs; ++rep) {
+        timer.start();
+        op(rep);
+        samples.push_back(timer.nsecsElapsed());
+    }
+
+    std::sort(samples.begin(), samples.end());
+    Measurement m;
+    m.reps = static_cast<int>(samples.size());
+    m.minNs = samples.front();
+    m.medianNs = samples[samples.size() / 2];
+    m.p95Ns = samples[std::min(samples.size() - 1, samples.size() * 95 / 100)];
+    qint64 sum = 0;
+    for (qint64 sample : samples) {
+        sum += sample;
+    }
+    m.meanNs = sum / m.reps;
+    return m;
+}
+
+static QJsonObject toJson(const Measurement& m) {
+    QJsonObject object;
+    object.insert("reps", m.reps);
+    object.insert("minNs", m.minNs);
+    object.insert("medianNs", m.medianNs);
+    object.insert("p95Ns", m.p95Ns);
+    object.insert("meanNs", m.meanNs);
+    return object;
+}
+
+static void progress(const QString& line) {
+    QTextStream err(stderr);
+    err << line << "\n";
+}
+
+// Exclusion list of `count` entries. The first ones name real simulated
+// processes other than the target (app0.exe), so excluded sessions are hit;
+// the rest are padding that never matches.
+static QStringList makeExclusions(int count, int processCount) {
+    QStringList processes;
+    processes.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        processes.append(i + 1 < processCount ? QString("app%1.exe").arg(i + 1) : QString("excluded%1.exe").arg(i));
+    }
+    return processes;
+}
+
+static void publishExclusions(const QStringList& processes) {
+    ExclusionSet::publish(std::make_shared<const ExclusionSet>(processes, QStringList()));
+}
+
+// ---------------------------------------------------------------------------
+// scan: toggle/adjust one target across session counts, device counts,
+// selection mode and exclusion list sizes, on both lookup paths
+
+static void benchScan(const Options& options, bool quick, QJsonArray& results) {
+    const QVector<int> sessionCounts = quick ? QVector<int>{10, 1000} : QVector<int>{10, 100, 1000, 10000};
+    const QVector<int> deviceCounts = quick ? QVector<int>{1, 16} : QVector<int>{1, 2, 4, 8, 16};
+    const QVector<int> exclusionCounts = quick ? QVector<int>{0, 5000} : QVector<int>{0, 10, 100, 1000, 5000};
+
+    for (const bool indexed : {true, false}) {
+        for (int sessions : sessionCounts) {
+            for (int devices : deviceCounts) {
+                if (devices > sessions) {
+                    continue;
+                }
+                // About four sessions per process, as with browsers and games
+                const int processCount = qMax(1, sessions / 4);
+                SimulatedAudioBackend backend;
+                backend.setNotificationsAvailable(indexed);
+                backend.populate(devices, sessions / devices, processCount);
+                AudioMuter muter(&backend);
+                const int total = (sessions / devices) * devices;
+
+                for (int exclusions : exclusionCounts) {
+                    publishExclusions(makeExclusions(exclusions, processCount));
+                    for (const bool byPid : {false, true}) {
+                        for (const bool volume : {false, true}) {
+                            int matched = 0;
+                            const Measurement m = measure(options, [&](int rep) {
+                                if (volume) {
+                                    const float step = rep % 2 ? 5.0f : -5.0f;
+                                    const VolumeAdjustResult result = byPid ? muter.adjustVolumeByPID(1000, step)
+                                                                            : muter.adjustVolumeByExeName("app0.exe", step);
+                                    matched = result.adjustedCount();
+                                } else {
+                                    matched = byPid ? muter.toggleMuteByPID(1000) : muter.toggleMuteByExeName("app0.exe");
+                                }
+                            });
+
+                            QJsonObject result = toJson(m);
+                            result.insert("suite", "scan");
+                            result.insert("path", indexed ? "index" : "scan");
+                            result.insert("sessions", total);
+                            result.insert("devices", devices);
+                            result.insert("exclusions", exclusions);
+                            result.insert("mode", byPid ? "pid" : "exe");
+                            result.insert("op", volume ? "adjustVolume" : "toggleMute");
+                            result.insert("matched", matched);
+                            results.append(result);
+                        }
+                    }
+                }
+                progress(QString("scan: %1 path, %2 sessions, %3 devices")
+                         .arg(indexed ? "index" : "scan").arg(total).arg(devices));
+            }
+        }
+    }
+    publishExclusions(QStringList());
+}
+
+// ---------------------------------------------------------------------------
+// parallel: sequential vs parallel device scan with simulated per-call latency.
+// "spin" latency keeps the CPU busy, as if each call were pure computation;
+// "block" sleeps, as a cross-process COM call does while the audio service
+// answers. Only the latter can overlap on a machine with fewer cores than
+// scan threads.
+
+static void benchParallel(const Options& options, bool quick, QJsonArray& results) {
+    const int sessionsPerDevice = 16;
+    const int latencyMicros = 10;
+    const QVector<int> deviceCounts = quick ? QVector<int>{1, 8} : QVector<int>{1, 2, 4, 8, 16};
+    const QVector<int> threadCounts = quick ? QVector<int>{4} : QVector<int>{2, 4, 8, 16};
+
+    for (const bool blocking : {false, true}) {
+        for (int devices : deviceCounts) {
+            SimulatedAudioBackend backend;
+            backend.setNotificationsAvailable(false);
+            backend.populate(devices, sessionsPerDevice, qMax(1, devices * sessionsPerDevice / 4));
+            backend.setCallLatencyMicros(latencyMicros);
+            backend.setBlockingLatency(blocking);
+            AudioMuter muter(&backend);
+
+            QVector<int> modes = {0};
+            modes += threadCounts;
+            for (int threads : modes) {
+                muter.setScanMode(threads == 0 ? AudioMuter::ScanMode::Sequential : AudioMuter::ScanMode::Parallel, qMax(1, threads));
+                int matched = 0;
+                const Measurement m = measure(options, [&](int) {
+                    matched = muter.toggleMuteByExeName("app0.exe");
+                });
+
+                QJsonObject result = toJson(m);
+                result.insert("suite", "parallel");
+                result.insert("devices", devices);
+                result.insert("sessionsPerDevice", sessionsPerDevice);
+                result.insert("callLatencyMicros", latencyMicros);
+                result.insert("latency", blocking ? "block" : "spin");
+                result.insert("scanMode", threads == 0 ? "sequential" : "parallel");
+                result.insert("threads", threads == 0 ? 1 : threads);
+                result.insert("matched", matched);
+                results.append(result);
+            }
+            progress(QString("parallel: %1 devices, %2 latency").arg(devices).arg(blocking ? "block" : "spin"));
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// process-cache: cold vs warm PID -> executable resolution
+
+// Probe with the cost profile of OpenProcess + QueryFullProcessImageNameW
+// (resolve) and GetProcessTimes (isSameProcess)
+class SyntheticProcessProbe : public ProcessProbe {
+public:
+    SyntheticProcessProbe(int resolveMicros, int checkMicros, bool exitWatches)
+        : resolveMicros_(resolveMicros), checkMicros_(checkMicros), exitWatches_(exitWatches) {}
+
+    bool resolve(quint32 pid, ProcessIdentity* identity) override {
+        spin(resolveMicros_);
+        identity->pid = pid;
+        identity->creationTime = pid;
+        identity->imagePath = QString("C:\\Program Files\\App%1\\app%1.exe").arg(pid);
+        return true;
+    }
+    bool isSameProcess(quint32 pid, quint64 creationTime) override {
+        spin(checkMicros_);
+        return creationTime == pid;
+    }
+    bool watchExit(quint32, quint64, ProcessIdentityCache*) override { return exitWatches_; }
+    void cancelAllWatches() override {}
+
+    void setExitWatches(bool exitWatches) { exitWatches_ = exitWatches; }
+
+private:
+    static void spin(int micros) {
+        QElapsedTimer timer;
+        timer.start();
+        while (timer.nsecsElapsed() < qint64(micros) * 1000) {
+        }
+    }
+
+    int resolveMicros_;
+    int checkMicros_;
+    bool exitWatches_;
+};
+
+static void benchProcessCache(const Options& options, bool, QJsonArray& results) {
+    const int pidCount = 100;
+    const int resolveMicros = 20;
+    const int checkMicros = 1;
+
+    struct Case {
+        const char *name;
+        bool warm;
+        bool exitWatches;
+    };
+    const Case cases[] = {
+        {"cold", false, true},
+        {"warm", true, true},
+        {"warm-unwatched", true, false},
+    };
+    for (const Case& c : cases) {
+        ProcessIdentityCache cache(std::make_unique<SyntheticProcessProbe>(resolveMicros, checkMicros, c.exitWatches));
+        const Measurement m = measure(options, [&](int) {
+            if (!c.warm) {
+                cache.clear();
+            }
+            for (int i = 0; i < pidCount; ++i) {
+                cache.lookup(static_cast<quint32>(4000 + i));
+            }
+        });
+
+        QJsonObject result = toJson(m);
+        result.insert("suite", "process-cache");
+        result.insert("case", c.name);
+        result.insert("lookupsPerRep", pidCount);
+        result.insert("resolveMicros", resolveMicros);
+        result.insert("nsPerLookup", m.medianNs / pidCount);
+        results.append(result);
+        progress(QString("process-cache: %1").arg(c.name));
+    }
+
+    // Overflowing the cache with unwatched processes must leave the watched
+    // ones in place; their exit watches still point at them
+    const int overflowLookups = 5000;   // More than the cache holds
+    auto probe = std::make_unique<SyntheticProcessProbe>(0, 0, true);
+    SyntheticProcessProbe *overflowProbe = probe.get();
+    ProcessIdentityCache cache(std::move(probe));
+    for (int i = 0; i < pidCount; ++i) {
+        cache.lookup(static_cast<quint32>(4000 + i));
+    }
+    overflowProbe->setExitWatches(false);
+    for (int i = 0; i < overflowLookups; ++i) {
+        cache.lookup(static_cast<quint32>(100000 + i));
+    }
+    const quint64 missesBefore = cache.misses();
+    for (int i = 0; i < pidCount; ++i) {
+        cache.lookup(static_cast<quint32>(4000 + i));
+    }
+    const quint64 watchedEvicted = cache.misses() - missesBefore;
+    if (watchedEvicted > 0) {
+        ++g_failedChecks;
+        progress(QString("process-cache: overflow FAILED: %1 of %2 watched entries evicted").arg(watchedEvicted).arg(pidCount));
+    }
+
+    QJsonObject result;
+    result.insert("suite", "process-cache");
+    result.insert("case", "overflow");
+    result.insert("watched", pidCount);
+    result.insert("unwatchedLookups", overflowLookups);
+    result.insert("watchedEvicted", static_cast<qint64>(watchedEvicted));
+    result.insert("cacheSize", cache.size());
+    results.append(result);
+    progress("process-cache: overflow checked");
+}
+
+// ---------------------------------------------------------------------------
+// exclusion-lookup: one exclusion check against list sizes, by process name,
+// endpoint ID and legacy device name, with the allocations each check makes
+
+static void benchExclusionLookup(const Options& options, bool, QJsonArray& results) {
+    struct Case {
+        const char *kind;
+        QString hit;   // Case (and extension) differ from the stored entry, as they do in practice
+        QString miss;
+        std::function<bool(const ExclusionSet&, const QString&)> check;
+    };
+    const QString unlistedId("{0.0.0.00000000}.{bench-unlisted}");
+    const Case cases[] = {
+        {"process", "App1.EXE", "chrome.exe",
+         [](const ExclusionSet& set, const QString& name) { return set.isProcessExcluded(name); }},
+        {"device", "{0.0.0.00000000}.{BENCH-DEVICE-1}", "{0.0.0.00000000}.{bench-headset}",
+         [](const ExclusionSet& set, const QString& id) { return set.isDeviceExcluded(id); }},
+        {"deviceName", "SPEAKERS 1", "Headset",
+         [&unlistedId](const ExclusionSet& set, const QString& name) { return set.isDeviceExcluded(unlistedId, name); }},
+    };
+
+    for (int count : {0, 10, 100, 1000, 5000}) {
+        QStringList deviceIds;
+        QStringList deviceNames;
+        for (int i = 0; i < count; ++i) {
+            deviceIds.append(QString("{0.0.0.00000000}.{bench-device-%1}").arg(i + 1));
+            deviceNames.append(QString("Speakers %1").arg(i + 1));
+        }
+        const ExclusionSet set(makeExclusions(count, count + 1), deviceIds, deviceNames);
+        const int lookupsPerRep = 1000;
+        for (const Case& c : cases) {
+            for (const bool isHit : {true, false}) {
+                if (isHit && count == 0) {
+                    continue;
+                }
+                const QString& name = isHit ? c.hit : c.miss;
+                if (c.check(set, name) != isHit) {
+                    ++g_failedChecks;
+                    progress(QString("exclusion-lookup: %1 %2 FAILED with %3 exclusions").arg(c.kind, isHit ? "hit" : "miss").arg(count));
+                }
+                g_allocations = 0;
+                const Measurement m = measure(options, [&](int) {
+                    bool excluded = false;
+                    t_countAllocations = true;
+                    for (int i = 0; i < lookupsPerRep; ++i) {
+                        excluded = c.check(set, name) != excluded;
+                    }
+                    t_countAllocations = false;
+                    g_sink = excluded;
+                });
+                // The warm-up run counts too
+                const double lookups = double(m.reps + 1) * lookupsPerRep;
+                const double allocationsPerLookup = double(g_allocations.load()) / lookups;
+                if (allocationsPerLookup > 0) {
+                    ++g_failedChecks;
+                    progress(QString("exclusion-lookup: %1 %2 FAILED: %3 allocations per lookup")
+                             .arg(c.kind, isHit ? "hit" : "miss").arg(allocationsPerLookup));
+                }
+
+                QJsonObject result = toJson(m);
+                result.insert("suite", "exclusion-lookup");
+                result.insert("kind", c.kind);
+                result.insert("exclusions", count);
+                result.insert("case", isHit ? "hit" : "miss");
+                result.insert("lookupsPerRep", lookupsPerRep);
+                result.insert("nsPerLookup", m.medianNs / lookupsPerRep);
+                result.insert("allocationsPerLookup", allocationsPerLookup);
+                result.insert("allocationCounter", ALLOCATION_COUNTER);
+                results.append(result);
+            }
+        }
+    }
+    progress("exclusion-lookup: done");
+}
+
+// ---------------------------------------------------------------------------
+// logging: allocations per keypress with logging at its default level. "eager"
+// is the call pattern from before leveled logging, which built every message;
+// "lazy" is the LOG_* macros. The log file is not opened, so "eager" leaves
+// out the old per-line file write and is a lower bound on the old cost.
+// "enabled" is the LOG_* macros with their level on and the writer running,
+// i.e. what a line that is actually written costs the thread logging it.
+
+static void logKeypressEager(quint32 message, quint64 wParam, qint64 lParam) {
+    Logger::log(QString("Key event: message=0x%1, wParam=0x%2, lParam=0x%3").arg(message, 0, 16).arg(wParam, 0, 16).arg(lParam, 0, 16));
+}
+
+static void logKeypressLazy(quint32 message, quint64 wParam, qint64 lParam) {
+    LOG_TRACE(Hotkey, QString("Key event: message=0x%1, wParam=0x%2, lParam=0x%3").arg(message, 0, 16).arg(wParam, 0, 16).arg(lParam, 0, 16));
+}
+
+static void logHotkeyEager(quint64 wParam, qint64 lParam, const QString& exeName, quint32 pid) {
+    Logger::log(QString("WM_HOTKEY received: wParam=0x%1, lParam=0x%2").arg(wParam, 0, 16).arg(lParam, 0, 16));
+    Logger::log("Hotkey ID matches! Triggering onHotkeyTriggered()");
+    Logger::log("=== Hotkey Triggered ===");
+    Logger::log(QString("Hotkey pressed. Target executable: %1 (PID: %2)").arg(exeName).arg(pid));
+    Logger::log("Executable-based muting mode: Muting all processes with same executable name");
+}
+
+static void logHotkeyLazy(quint64 wParam, qint64 lParam, const QString& exeName, quint32 pid) {
+    LOG_DEBUG(Hotkey, QString("WM_HOTKEY received: wParam=0x%1, lParam=0x%2").arg(wParam, 0, 16).arg(lParam, 0, 16));
+    LOG_DEBUG(Hotkey, "Hotkey ID matches! Triggering onHotkeyTriggered()");
+    LOG_DEBUG(Hotkey, "=== Hotkey Triggered ===");
+    LOG_DEBUG(Hotkey, QString("Hotkey pressed. Target executable: %1 (PID: %2)").arg(exeName).arg(pid));
+    LOG_DEBUG(Hotkey, "Executable-based muting mode: Muting all processes with same executable name");
+}
+
+static void benchLogging(const Options& options, bool, QJsonArray& results) {
+    // Default threshold: trace and debug are off
+    Logger::setLevel(LogLevel::Info);
+    const QString exeName("app0.exe");
+    const QString logPath = QDir::temp().filePath("maw-bench-logging.log");
+
+    struct Case {
+        const char *event;
+        const char *style;
+        bool writing;   // Logger running with every level enabled
+        std::function<void(int)> op;
+    };
+    const std::vector<Case> cases = {
+        // A keypress is a WM_KEYDOWN and a WM_KEYUP
+        {"keypress", "eager", false, [](int rep) { logKeypressEager(0x100, 0x41 + rep % 26, 0x1e0001); logKeypressEager(0x101, 0x41 + rep % 26, 0xc01e0001); }},
+        {"keypress", "lazy", false, [](int rep) { logKeypressLazy(0x100, 0x41 + rep % 26, 0x1e0001); logKeypressLazy(0x101, 0x41 + rep % 26, 0xc01e0001); }},
+        {"keypress", "enabled", true, [](int rep) { logKeypressLazy(0x100, 0x41 + rep % 26, 0x1e0001); logKeypressLazy(0x101, 0x41 + rep % 26, 0xc01e0001); }},
+        {"hotkey", "eager", false, [&exeName](int rep) { logHotkeyEager(1, 0x4d0003, exeName, 1000 + rep); }},
+        {"hotkey", "lazy", false, [&exeName](int rep) { logHotkeyLazy(1, 0x4d0003, exeName, 1000 + rep); }},
+        {"hotkey", "enabled", true, [&exeName](int rep) { logHotkeyLazy(1, 0x4d0003, exeName, 1000 + rep); }},
+    };
+    for (const Case& c : cases) {
+        if (c.writing) {
+            Logger::init(logPath);
+            Logger::setLevel(LogLevel::Trace);
+        }
+        const int eventsPerRep = 1000;
+        g_allocations = 0;
+        t_countAllocations = true;
+        const Measurement m = measure(options, [&](int rep) {
+            for (int i = 0; i < eventsPerRep; ++i) {
+                c.op(rep + i);
+            }
+        });
+        t_countAllocations = false;
+        if (c.writing) {
+            Logger::shutdown();
+            Logger::setLevel(LogLevel::Info);
+            QFile::remove(logPath);
+        }
+
+        // The warm-up run counts too
+        const double events = double(m.reps + 1) * eventsPerRep;
+        QJsonObject result = toJson(m);
+        result.insert("suite", "logging");
+        result.insert("event", c.event);
+        result.insert("style", c.style);
+        result.insert("eventsPerRep", eventsPerRep);
+        result.insert("nsPerEvent", m.medianNs / eventsPerRep);
+        result.insert("allocationsPerEvent", double(g_allocations.load()) / events);
+        result.insert("allocationCounter", ALLOCATION_COUNTER);
+        results.append(result);
+    }
+    Logger::setLevel(LogLevel::Info);
+    progress("logging: done");
+}
+
+// ---------------------------------------------------------------------------
+// hotkey: replay synthetic typing, or a recorded stream (--key-stream),
+// through HotkeyMatcher with 4 and 400 bindings; per-event cost against a
+// linear scan of the bindings, trigger counts, and a check of every trigger
+// and of the modifier state against a reference model
+
+// Windows virtual-key codes used by the generator
+enum : int {
+    KEY_SHIFT = 0x10, KEY_CONTROL = 0x11, KEY_MENU = 0x12,
+    KEY_UP = 0x26, KEY_DOWN = 0x28, KEY_F1 = 0x70,
+    KEY_LWIN = 0x5B, KEY_RWIN = 0x5C,
+    KEY_LSHIFT = 0xA0, KEY_RSHIFT = 0xA1, KEY_LCONTROL = 0xA2, KEY_RCONTROL = 0xA3, KEY_LMENU = 0xA4, KEY_RMENU = 0xA5,
+};
+
+struct KeyEvent {
+    quint8 vk;
+    bool down;
+};
+
+// Straightforward model of what the matcher is expected to conclude: a
+// per-key held flag and a scan of the bindings in order of precedence,
+// where a key that is already down only fires Repeat bindings. Also serves
+// as the if/else-chain baseline.
+class ReferenceKeyboard {
+public:
+    explicit ReferenceKeyboard(const HotkeyMatcher& matcher) {
+        QList<int> actionIds = matcher.actions();
+        std::stable_sort(actionIds.begin(), actionIds.end(), [&matcher](int a, int b) {
+            return matcher.binding(a).priority < matcher.binding(b).priority;
+        });
+        for (int actionId : actionIds) {
+            actionIds_.append(actionId);
+            bindings_.append(matcher.binding(actionId));
+        }
+    }
+
+    void onKey(int vk, bool down) {
+        down_[vk] = down;
+        // A generic modifier code holds the left key and releases both
+        const int left = leftKeyFor(vk);
+        if (left == 0) {
+            held_[vk] = down;
+        } else if (down) {
+            held_[left] = true;
+        } else {
+            held_[left] = false;
+            held_[left + 1] = false;
+        }
+    }
+
+    int modifiers() const {
+        int mods = 0;
+        if (held_[KEY_LCONTROL] || held_[KEY_RCONTROL]) mods |= HotkeyMatcher::ModControl;
+        if (held_[KEY_LMENU] || held_[KEY_RMENU]) mods |= HotkeyMatcher::ModAlt;
+        if (held_[KEY_LSHIFT] || held_[KEY_RSHIFT]) mods |= HotkeyMatcher::ModShift;
+        if (held_[KEY_LWIN] || held_[KEY_RWIN]) mods |= HotkeyMatcher::ModWin;
+        return mods;
+    }
+
+    // Action a key event triggers in the current state, or 0
+    int expected(int vk, bool down) const {
+        if (!down) {
+            return 0;
+        }
+        const int mods = modifiers();
+        for (int i = 0; i < bindings_.size(); ++i) {
+            if (bindings_[i].virtualKey == vk && bindings_[i].modifiers == mods) {
+                return down_[vk] && bindings_[i].trigger != HotkeyMatcher::Repeat ? 0 : actionIds_[i];
+            }
+        }
+        return 0;
+    }
+
+    void reset() {
+        std::fill(std::begin(held_), std::end(held_), false);
+        std::fill(std::begin(down_), std::end(down_), false);
+    }
+
+private:
+    static int leftKeyFor(int vk) {
+        switch (vk) {
+        case KEY_CONTROL: return KEY_LCONTROL;
+        case KEY_MENU: return KEY_LMENU;
+        case KEY_SHIFT: return KEY_LSHIFT;
+        default: return 0;
+        }
+    }
+
+    QVector<int> actionIds_;
+    QVector<HotkeyMatcher::Binding> bindings_;
+    bool held_[256] = {};
+    bool down_[256] = {};  // By the code received, generic modifiers included
+};
+
+// The application's hotkeys, with the IDs and precedence MainWindow binds
+// them with
+struct NamedAction {
+    int id;
+    int priority;
+    const char *name;
+};
+static const NamedAction APP_ACTIONS[] = {
+    {0xBEEF, 0, "mute"}, {0xBEE1, 1, "volumeUp"}, {0xBEE2, 2, "volumeDown"}, {0xBEE3, 3, "adminRestart"},
+};
+
+// Bindings as a user might configure them: the default mute key, volume on
+// Ctrl+Shift+Up/Down (repeating while held, as in the app), and a letter
+// that ordinary typing also hits. Extra bindings go on digits and F2-F24
+// under every modifier combination, ranked below the app's own.
+static void bindHotkeys(HotkeyMatcher& matcher, int extraBindings) {
+    auto bind = [&matcher](const NamedAction& action, int vk, int modifiers, HotkeyMatcher::Trigger trigger = HotkeyMatcher::Edge) {
+        HotkeyMatcher::Binding binding;
+        binding.isValid = true;
+        binding.virtualKey = vk;
+        binding.modifiers = modifiers;
+        binding.trigger = trigger;
+        binding.priority = action.priority;
+        matcher.setBinding(action.id, binding);
+    };
+    bind(APP_ACTIONS[0], KEY_F1, 0);
+    bind(APP_ACTIONS[1], KEY_UP, HotkeyMatcher::ModControl | HotkeyMatcher::ModShift, HotkeyMatcher::Repeat);
+    bind(APP_ACTIONS[2], KEY_DOWN, HotkeyMatcher::ModControl | HotkeyMatcher::ModShift, HotkeyMatcher::Repeat);
+    bind(APP_ACTIONS[3], 'R', HotkeyMatcher::ModControl | HotkeyMatcher::ModAlt | HotkeyMatcher::ModShift);
+
+    QVector<int> keys;
+    for (int vk = '0'; vk <= '9'; ++vk) {
+        keys.append(vk);
+    }
+    for (int vk = KEY_F1 + 1; vk < KEY_F1 + 24; ++vk) {
+        keys.append(vk);
+    }
+    for (int i = 0; i < extraBindings; ++i) {
+        bind({100 + i, 4, nullptr}, keys[i % keys.size()], (i / keys.size()) % HotkeyMatcher::MODIFIER_COMBINATIONS,
+             i % 2 ? HotkeyMatcher::Repeat : HotkeyMatcher::Edge);
+    }
+}
+
+// Deterministic typing: letters and digits with auto-repeat, modifiers
+// pressed and released on either side (and occasionally by generic code),
+// and chords for the given bindings. Everything is released at the end.
+static std::vector<KeyEvent> syntheticKeyStream(int count, const QVector<HotkeyMatcher::Binding>& chords) {
+    static const int modifierKeys[] = {KEY_LCONTROL, KEY_RCONTROL, KEY_LMENU, KEY_RMENU,
+                                       KEY_LSHIFT, KEY_RSHIFT, KEY_LWIN, KEY_RWIN};
+    quint64 state = 0x9e3779b97f4a7c15ull;
+    auto next = [&state](int bound) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return static_cast<int>(state % static_cast<quint64>(bound));
+    };
+
+    std::vector<KeyEvent> events;
+    events.reserve(count + 16);
+    bool held[256] = {};
+    auto emitKey = [&](int vk, bool down) {
+        events.push_back({static_cast<quint8>(vk), down});
+        held[vk] = down;
+    };
+    auto tap = [&](int vk) {
+        emitKey(vk, true);
+        for (int repeats = next(8) == 0 ? next(4) : 0; repeats > 0; --repeats) {
+            emitKey(vk, true);
+        }
+        emitKey(vk, false);
+    };
+
+    while (static_cast<int>(events.size()) < count) {
+        const int roll = next(100);
+        if (roll < 15) {
+            const int vk = modifierKeys[next(8)];
+            emitKey(vk, !held[vk]);
+        } else if (roll < 17) {
+            // Held as the left key, released on both sides
+            const int generic = KEY_SHIFT + next(3);
+            const int left = generic == KEY_SHIFT ? KEY_LSHIFT : generic == KEY_CONTROL ? KEY_LCONTROL : KEY_LMENU;
+            const bool down = next(2) == 0;
+            events.push_back({static_cast<quint8>(generic), down});
+            held[left] = down;
+            held[left + 1] = held[left + 1] && down;
+        } else if (roll < 25 && !chords.isEmpty()) {
+            // Set up exactly the bound modifiers, then press the key
+            const HotkeyMatcher::Binding& binding = chords[next(chords.size())];
+            for (int vk : modifierKeys) {
+                if (held[vk]) {
+                    emitKey(vk, false);
+                }
+            }
+            if (binding.modifiers & HotkeyMatcher::ModControl) emitKey(next(2) ? KEY_LCONTROL : KEY_RCONTROL, true);
+            if (binding.modifiers & HotkeyMatcher::ModAlt) emitKey(next(2) ? KEY_LMENU : KEY_RMENU, true);
+            if (binding.modifiers & HotkeyMatcher::ModShift) emitKey(next(2) ? KEY_LSHIFT : KEY_RSHIFT, true);
+            if (binding.modifiers & HotkeyMatcher::ModWin) emitKey(next(2) ? KEY_LWIN : KEY_RWIN, true);
+            tap(binding.virtualKey);
+        } else {
+            tap(next(4) == 0 ? '0' + next(10) : 'A' + next(26));
+        }
+    }
+    for (int vk : modifierKeys) {
+        if (held[vk]) {
+            emitKey(vk, false);
+        }
+    }
+    return events;
+}
+
+// One event per line, "down <vk>" or "up <vk>" with the code in hex or
+// decimal; blank lines and lines starting with '#' are skipped
+static bool loadKeyStream(const QString& path, std::vector<KeyEvent>* events) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        progress(QString("Cannot read key stream %1: %2").arg(path, file.errorString()));
+        return false;
+    }
+    QTextStream in(&file);
+    int lineNumber = 0;
+    while (!in.atEnd()) {
+        const QString line = in.readLine().trimmed();
+        ++lineNumber;
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+        const QStringList fields = line.split(' ', Qt::SkipEmptyParts);
+        bool ok = fields.size() == 2 && (fields[0] == "down" || fields[0] == "up");
+        const int vk = ok ? fields[1].toInt(&ok, 0) : 0;
+        if (!ok || vk <= 0 || vk > 0xff) {
+            progress(QString("%1:%2: expected \"down <vk>\" or \"up <vk>\"").arg(path).arg(lineNumber));
+            return false;
+        }
+        events->push_back({static_cast<quint8>(vk), fields[0] == "down"});
+    }
+    return true;
+}
+
+static void benchHotkeyStream(const Options& options, const char *source, const std::vector<KeyEvent>& events,
+                              int extraBindings, QJsonArray& results) {
+    HotkeyMatcher matcher;
+    bindHotkeys(matcher, extraBindings);
+    ReferenceKeyboard reference(matcher);
+
+    // Verification pass: every event against the reference model
+    QHash<int, int> triggers;
+    int wrongTriggers = 0;
+    int wrongModifiers = 0;
+    for (const KeyEvent& event : events) {
+        const int expected = reference.expected(event.vk, event.down);
+        reference.onKey(event.vk, event.down);
+        const int actionId = matcher.onKey(event.vk, event.down);
+        if (actionId != 0) {
+            ++triggers[actionId];
+        }
+        if (actionId != expected) {
+            ++wrongTriggers;
+        }
+        if (matcher.modifiers() != reference.modifiers()) {
+            ++wrongModifiers;
+        }
+    }
+    const int finalModifiers = matcher.modifiers();
+    const int bindings = matcher.actions().size();
+    const bool ok = wrongTriggers == 0 && wrongModifiers == 0 && finalModifiers == reference.modifiers();
+    if (!ok) {
+        ++g_failedChecks;
+        progress(QString("hotkey: %1 stream with %2 bindings FAILED: %3 wrong triggers, %4 events with wrong modifier state")
+                 .arg(source).arg(bindings).arg(wrongTriggers).arg(wrongModifiers));
+    }
+
+    QJsonObject counts;
+    int otherTriggers = 0;
+    for (auto it = triggers.constBegin(); it != triggers.constEnd(); ++it) {
+        otherTriggers += it.value();
+    }
+    for (const NamedAction& action : APP_ACTIONS) {
+        counts.insert(action.name, triggers.value(action.id));
+        otherTriggers -= triggers.value(action.id);
+    }
+    counts.insert("other", otherTriggers);
+
+    for (const bool table : {true, false}) {
+        int fired = 0;
+        const Measurement m = measure(options, [&](int) {
+            int count = 0;
+            if (table) {
+                matcher.reset();
+                for (const KeyEvent& event : events) {
+                    count += matcher.onKey(event.vk, event.down) != 0;
+                }
+            } else {
+                reference.reset();
+                for (const KeyEvent& event : events) {
+                    count += reference.expected(event.vk, event.down) != 0;
+                    reference.onKey(event.vk, event.down);
+                }
+            }
+            fired = count;
+        });
+        g_sink = fired > 0;
+
+        QJsonObject result = toJson(m);
+        result.insert("suite", "hotkey");
+        result.insert("source", source);
+        result.insert("dispatch", table ? "table" : "linear");
+        result.insert("bindings", bindings);
+        result.insert("events", static_cast<qint64>(events.size()));
+        result.insert("nsPerEvent", events.empty() ? 0.0 : double(m.medianNs) / events.size());
+        result.insert("triggers", counts);
+        result.insert("wrongTriggers", wrongTriggers);
+        result.insert("wrongModifierStates", wrongModifiers);
+        result.insert("finalModifiers", finalModifiers);
+        result.insert("ok", ok);
+        results.append(result);
+    }
+    progress(QString("hotkey: %1 stream, %2 events, %3 bindings").arg(source).arg(events.size()).arg(bindings));
+}
+
+// All four app hotkeys on one combination, bound lowest precedence first:
+// each press must fire the highest-precedence one still bound, with mute
+// first, whatever the IDs
+static void checkSharedHotkeys(QJsonArray& results) {
+    HotkeyMatcher matcher;
+    const int modifiers = HotkeyMatcher::ModControl | HotkeyMatcher::ModAlt;
+    for (int i = 3; i >= 0; --i) {
+        HotkeyMatcher::Binding binding;
+        binding.isValid = true;
+        binding.virtualKey = 'M';
+        binding.modifiers = modifiers;
+        binding.priority = APP_ACTIONS[i].priority;
+        matcher.setBinding(APP_ACTIONS[i].id, binding);
+    }
+
+    QJsonArray fired;
+    int wrong = 0;
+    for (const NamedAction& expected : APP_ACTIONS) {
+        matcher.reset();
+        matcher.onKey(KEY_LCONTROL, true);
+        matcher.onKey(KEY_LMENU, true);
+        const int actionId = matcher.onKey('M', true);
+        QString name = "none";
+        for (const NamedAction& action : APP_ACTIONS) {
+            if (action.id == actionId) {
+                name = action.name;
+            }
+        }
+        fired.append(name);
+        if (actionId != expected.id) {
+            ++wrong;
+        }
+        matcher.clearBinding(expected.id);
+    }
+    if (wrong > 0) {
+        ++g_failedChecks;
+        progress(QString("hotkey: shared combination FAILED: %1 of 4 presses fired the wrong action").arg(wrong));
+    }
+
+    QJsonObject result;
+    result.insert("suite", "hotkey");
+    result.insert("case", "shared");
+    result.insert("fired", fired);
+    result.insert("ok", wrong == 0);
+    results.append(result);
+    progress("hotkey: shared combination checked");
+}
+
+static void benchHotkey(const Options& options, bool quick, QJsonArray& results) {
+    // The same stream is replayed against every binding count
+    HotkeyMatcher appBindings;
+    bindHotkeys(appBindings, 0);
+    QVector<HotkeyMatcher::Binding> chords;
+    for (int actionId : appBindings.actions()) {
+        chords.append(appBindings.binding(actionId));
+    }
+    const std::vector<KeyEvent> synthetic = syntheticKeyStream(quick ? 100000 : 2000000, chords);
+
+    std::vector<KeyEvent> recorded;
+    const bool haveRecorded = !options.keyStreamPath.isEmpty() && loadKeyStream(options.keyStreamPath, &recorded);
+    if (!options.keyStreamPath.isEmpty() && !haveRecorded) {
+        ++g_failedChecks;
+    }
+
+    for (int extraBindings : {0, 396}) {
+        benchHotkeyStream(options, "synthetic", synthetic, extraBindings, results);
+        if (haveRecorded) {
+            benchHotkeyStream(options, "recorded", recorded, extraBindings, results);
+        }
+    }
+    checkSharedHotkeys(results);
+}
+
+// ---------------------------------------------------------------------------
+// process-tree: ProcessTree against a naive reference over synthetic process
+// tables with starts, exits and PID reuse, applied one event at a time and as
+// listing diffs; a family lookup against building the tree from a fresh
+// listing per press; and family muting through AudioMuter
+
+// What family() must return for a listing: every process whose chain of
+// trusted parents reaches `rootPid`, walked from scratch. A parent is
+// trusted if it is listed and did not start after the child.
+static QVector<quint32> referenceFamily(const QVector<ProcessTreeEntry>& processes, quint32 rootPid) {
+    QHash<quint32, ProcessTreeEntry> byPid;
+    for (const ProcessTreeEntry& process : processes) {
+        byPid.insert(process.pid, process);
+    }
+    QVector<quint32> members;
+    members.append(rootPid);
+    if (!byPid.contains(rootPid)) {
+        return members;
+    }
+    for (const ProcessTreeEntry& process : processes) {
+        ProcessTreeEntry current = process;
+        for (int hops = 0; hops <= processes.size() && current.pid != rootPid; ++hops) {
+            auto parent = byPid.constFind(current.parentPid);
+            if (current.parentPid == current.pid || parent == byPid.constEnd()
+                || parent->creationTime > current.creationTime) {
+                break;
+            }
+            current = *parent;
+        }
+        if (current.pid == rootPid && process.pid != rootPid) {
+            members.append(process.pid);
+        }
+    }
+    return members;
+}
+
+static QVector<quint32> sorted(QVector<quint32> pids) {
+    std::sort(pids.begin(), pids.end());
+    return pids;
+}
+
+// Deterministic process table: a few long-lived roots, and processes that
+// mostly start under a live process (sometimes under one that has exited).
+// PIDs are multiples of 4 from a small pool, so exits free PIDs that later
+// starts reuse, as on Windows.
+class SyntheticProcessTable {
+public:
+    SyntheticProcessTable(int count, quint64 seed) : state_(seed), clock_(1000) {
+        for (int i = 0; i < count; ++i) {
+            start();
+        }
+    }
+
+    const QVector<ProcessTreeEntry>& processes() const { return processes_; }
+
+    ProcessTreeEntry start() {
+        ProcessTreeEntry process;
+        process.pid = freePid();
+        process.creationTime = ++clock_;
+        const int roll = next(100);
+        if (processes_.isEmpty() || roll < 3) {
+            process.parentPid = 0;
+        } else if (roll < 8) {
+            process.parentPid = 4 * (1 + next(pidPool()));  // Possibly gone or reused
+        } else {
+            process.parentPid = processes_[next(processes_.size())].pid;
+        }
+        processes_.append(process);
+        live_.insert(process.pid);
+        return process;
+    }
+
+    quint32 exitOne() {
+        const int index = next(processes_.size());
+        const quint32 pid = processes_[index].pid;
+        processes_.remove(index);
+        live_.remove(pid);
+        return pid;
+    }
+
+    quint32 randomPid() { return processes_[next(processes_.size())].pid; }
+    int next(int bound) {
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 7;
+        state_ ^= state_ << 17;
+        return static_cast<int>(state_ % static_cast<quint64>(bound));
+    }
+
+private:
+    int pidPool() const { return processes_.size() + processes_.size() / 4 + 8; }
+    quint32 freePid() {
+        for (;;) {
+            const quint32 pid = 4 * (1 + next(pidPool()));
+            if (!live_.contains(pid)) {
+                return pid;
+            }
+        }
+    }
+
+    quint64 state_;
+    quint64 clock_;
+    QVector<ProcessTreeEntry> processes_;
+    QSet<quint32> live_;
+};
+
+// Starts and exits applied to `events` (one call per event) and `synced`
+// (a listing diff every few events), checked against the reference and a
+// tree rebuilt from the same listing. Returns the number of mismatches.
+static int verifyProcessTree(int count, int steps, quint64 seed) {
+    SyntheticProcessTable table(count, seed);
+    ProcessTree events;
+    ProcessTree synced;
+    events.reset(table.processes());
+    synced.reset(table.processes());
+
+    int mismatches = 0;
+    auto check = [&](const ProcessTree& tree, const char *name, quint32 rootPid, const QVector<quint32>& expected) {
+        if (sorted(tree.family(rootPid)) != expected) {
+            if (++mismatches <= 5) {
+                progress(QString("process-tree: %1 tree has the wrong family for PID %2").arg(name).arg(rootPid));
+            }
+        }
+    };
+    for (int step = 1; step <= steps; ++step) {
+        if (table.next(2) == 0 && table.processes().size() > 1) {
+            events.processExited(table.exitOne());
+        } else {
+            events.processStarted(table.start());
+        }
+        if (step % 8 != 0) {
+            continue;
+        }
+        synced.sync(table.processes());
+        ProcessTree rebuilt;
+        rebuilt.reset(table.processes());
+        for (int i = 0; i < 4; ++i) {
+            const quint32 rootPid = table.randomPid();
+            const QVector<quint32> expected = sorted(referenceFamily(table.processes(), rootPid));
+            check(events, "event-driven", rootPid, expected);
+            check(synced, "synced", rootPid, expected);
+            check(rebuilt, "rebuilt", rootPid, expected);
+            const quint32 memberPid = expected[table.next(expected.size())];
+            if (!events.isInFamily(memberPid, rootPid) && ++mismatches <= 5) {
+                progress(QString("process-tree: PID %1 not found in the family of %2").arg(memberPid).arg(rootPid));
+            }
+        }
+        if (events.size() != table.processes().size() || synced.size() != table.processes().size()) {
+            if (++mismatches <= 5) {
+                progress(QString("process-tree: trees hold %1/%2 processes, table has %3")
+                         .arg(events.size()).arg(synced.size()).arg(table.processes().size()));
+            }
+        }
+    }
+    return mismatches;
+}
+
+// A browser with renderers, a second instance of the same browser and an
+// unrelated process, each with audio. Family muting of the first browser
+// must leave the second alone and list the processes only once. The shell
+// and a launcher started everything; without sessions of their own, family
+// muting them must stay on their own PID.
+static bool verifyFamilyMuting(bool indexed, int presses, QString* failure) {
+    SimulatedAudioBackend backend;
+    backend.setNotificationsAvailable(indexed);
+    QVector<ProcessTreeEntry> processes = {
+        {4, 0, 1},          // System
+        {500, 4, 2},        // explorer.exe
+        {2000, 500, 10},    // browser.exe, the foreground window
+        {2004, 2000, 11},   // renderers and the audio service
+        {2008, 2000, 12},
+        {2012, 2004, 13},
+        {3000, 500, 20},    // Another browser.exe profile
+        {3004, 3000, 21},
+        {4000, 500, 30},    // player.exe
+        {5000, 500, 40},    // steam.exe
+        {5004, 5000, 41},   // game.exe, started from Steam
+    };
+    backend.setProcesses(processes);
+    const quint64 renderer = backend.addSession("dev0", 2008, "browser.exe");
+    const quint64 audioService = backend.addSession("dev0", 2012, "browser.exe");
+    const quint64 otherProfile = backend.addSession("dev1", 3004, "browser.exe");
+    const quint64 player = backend.addSession("dev1", 4000, "player.exe");
+    backend.addSession("dev0", 5004, "game.exe");
+    AudioMuter muter(&backend);
+
+    for (int press = 1; press <= presses; ++press) {
+        const int toggled = muter.toggleMuteByFamily(2000, "browser.exe");
+        bool rendererMuted = false;
+        bool serviceMuted = false;
+        bool otherMuted = true;
+        bool playerMuted = true;
+        backend.getMute(renderer, &rendererMuted);
+        backend.getMute(audioService, &serviceMuted);
+        backend.getMute(otherProfile, &otherMuted);
+        backend.getMute(player, &playerMuted);
+        const bool muted = press % 2 == 1;
+        if (toggled != 2 || rendererMuted != muted || serviceMuted != muted || otherMuted || playerMuted) {
+            *failure = QString("press %1 toggled %2 sessions").arg(press).arg(toggled);
+            return false;
+        }
+    }
+    if (muter.toggleMuteByPID(2000) != 0) {
+        *failure = "the browser's own PID has no session, PID mode should miss";
+        return false;
+    }
+    if (indexed && backend.processListings() != 1) {
+        *failure = QString("%1 process listings for %2 presses").arg(backend.processListings()).arg(presses);
+        return false;
+    }
+
+    if (muter.toggleMuteByFamily(500, "Explorer.EXE") != 0) {
+        *failure = "family muting of explorer.exe reached the apps it started";
+        return false;
+    }
+    if (muter.toggleMuteByFamily(5000, "steam.exe") != 0) {
+        *failure = "family muting of a launcher without audio reached its game";
+        return false;
+    }
+    // With audio of its own the launcher is an ordinary family root
+    backend.addSession("dev1", 5000, "steam.exe");
+    const int launcherToggled = muter.toggleMuteByFamily(5000, "steam.exe");
+    if (launcherToggled != 2) {
+        *failure = QString("family muting of a launcher with audio toggled %1 sessions").arg(launcherToggled);
+        return false;
+    }
+    return true;
+}
+
+// Two processes whose creation times could not be read, each recorded as
+// the other's parent, and a child of one. However the tree learns of them,
+// no PID may become its own ancestor or appear twice in a family, and
+// family muting must toggle each session once.
+static bool verifyParentCycle(QString* failure) {
+    const QVector<ProcessTreeEntry> processes = {
+        {8, 12, 0},
+        {12, 8, 0},
+        {16, 8, 0},
+    };
+    ProcessTree listed;
+    listed.reset(processes);
+    ProcessTree started;
+    for (int i = processes.size() - 1; i >= 0; --i) {
+        started.processStarted(processes[i]);
+    }
+    for (const ProcessTree* tree : {&listed, &started}) {
+        for (const ProcessTreeEntry& process : processes) {
+            const QVector<quint32> family = tree->family(process.pid);
+            if (QSet<quint32>(family.begin(), family.end()).size() != family.size()) {
+                *failure = QString("the family of PID %1 lists a process twice").arg(process.pid);
+                return false;
+            }
+            const quint32 parent = tree->parentOf(process.pid);
+            if (parent != 0 && tree->isInFamily(parent, process.pid)) {
+                *failure = QString("PID %1 is its own ancestor").arg(process.pid);
+                return false;
+            }
+        }
+    }
+
+    SimulatedAudioBackend backend;
+    backend.setProcesses(processes);
+    const quint64 root = backend.addSession("dev0", 12, "app.exe");
+    const quint64 child = backend.addSession("dev0", 16, "app.exe");
+    AudioMuter muter(&backend);
+    const int toggled = muter.toggleMuteByFamily(12, "app.exe");
+    bool rootMuted = false;
+    bool childMuted = false;
+    backend.getMute(root, &rootMuted);
+    backend.getMute(child, &childMuted);
+    if (toggled != 2 || !rootMuted || !childMuted) {
+        *failure = QString("family muting toggled %1 sessions, leaving the root %2 and the child %3")
+                   .arg(toggled).arg(rootMuted ? "muted" : "unmuted", childMuted ? "muted" : "unmuted");
+        return false;
+    }
+    return true;
+}
+
+static void benchProcessTree(const Options& options, bool quick, QJsonArray& results) {
+    for (int count : {50, 300, 2000}) {
+        const int steps = quick ? 400 : 4000;
+        const int mismatches = verifyProcessTree(count, steps, 0x2545f4914f6cdd1dull + count);
+        if (mismatches > 0) {
+            ++g_failedChecks;
+            progress(QString("process-tree: %1 processes FAILED: %2 mismatches").arg(count).arg(mismatches));
+        }
+
+        // A process with a few generations of children, as a browser has
+        SyntheticProcessTable table(count, 0x9e3779b97f4a7c15ull + count);
+        ProcessTree tree;
+        tree.reset(table.processes());
+        quint32 rootPid = table.processes().front().pid;
+        int rootFamily = 0;
+        for (const ProcessTreeEntry& process : table.processes()) {
+            const int size = tree.family(process.pid).size();
+            if (size > rootFamily && size <= count / 4 + 4) {
+                rootPid = process.pid;
+                rootFamily = size;
+            }
+        }
+
+        for (const bool fresh : {false, true}) {
+            int members = 0;
+            const Measurement m = measure(options, [&](int) {
+                if (fresh) {
+                    // Snapshot per press: copy the listing as a snapshot would, then index it
+                    ProcessTree pressTree;
+                    pressTree.reset(QVector<ProcessTreeEntry>(table.processes()));
+                    members = pressTree.family(rootPid).size();
+                } else {
+                    members = tree.family(rootPid).size();
+                }
+            });
+
+            QJsonObject result = toJson(m);
+            result.insert("suite", "process-tree");
+            result.insert("case", fresh ? "rebuild-per-press" : "indexed");
+            result.insert("processes", count);
+            result.insert("familySize", members);
+            result.insert("mismatches", mismatches);
+            result.insert("ok", mismatches == 0);
+            results.append(result);
+        }
+
+        // Applying a later listing in which a few processes started and
+        // exited, then the earlier one again
+        const QVector<ProcessTreeEntry> before = table.processes();
+        for (int i = 0; i < 4; ++i) {
+            table.exitOne();
+            table.start();
+        }
+        int changed = 0;
+        const Measurement m = measure(options, [&](int rep) {
+            changed = tree.sync(rep % 2 ? before : table.processes());
+        });
+        QJsonObject result = toJson(m);
+        result.insert("suite", "process-tree");
+        result.insert("case", "sync");
+        result.insert("processes", count);
+        result.insert("changed", changed);
+        results.append(result);
+        progress(QString("process-tree: %1 processes, %2 events checked").arg(count).arg(steps));
+    }
+
+    for (const bool indexed : {true, false}) {
+        const int presses = 8;
+        QString failure;
+        const bool ok = verifyFamilyMuting(indexed, presses, &failure);
+        if (!ok) {
+            ++g_failedChecks;
+            progress(QString("process-tree: family muting on the %1 path FAILED: %2").arg(indexed ? "index" : "scan", failure));
+        }
+        QJsonObject result;
+        result.insert("suite", "process-tree");
+        result.insert("case", "family-muting");
+        result.insert("path", indexed ? "index" : "scan");
+        result.insert("presses", presses);
+        result.insert("ok", ok);
+        results.append(result);
+    }
+
+    QString failure;
+    const bool ok = verifyParentCycle(&failure);
+    if (!ok) {
+        ++g_failedChecks;
+        progress(QString("process-tree: parent cycle FAILED: %1").arg(failure));
+    }
+    QJsonObject result;
+    result.insert("suite", "process-tree");
+    result.insert("case", "parent-cycle");
+    result.insert("ok", ok);
+    results.append(result);
+    progress("process-tree: family muting checked");
+}
+
+// ---------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("bench");
+
+    struct Suite {
+        const char *name;
+        void (*run)(const Options&, bool, QJsonArray&);
+    };
+    const Suite suites[] = {
+        {"scan", benchScan},
+        {"parallel", benchParallel},
+        {"process-cache", benchProcessCache},
+        {"exclusion-lookup", benchExclusionLookup},
+        {"logging", benchLogging},
+        {"hotkey", benchHotkey},
+        {"process-tree", benchProcessTree},
+    };
+    QStringList suiteNames;
+    for (const Suite& suite : suites) {
+        suiteNames.append(suite.name);
+    }
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks for the MuteActiveWindowC muting engine. Prints JSON results.");
+    parser.addHelpOption();
+    QCommandLineOption suiteOption("suite", QString("Run only this suite (repeatable): %1.").arg(suiteNames.join(", ")), "name");
+    QCommandLineOption outputOption("output", "Write the JSON results to <file> instead of stdout.", "file");
+    QCommandLineOption minTimeOption("min-time-ms", "Minimum measuring time per case (default 20).", "ms", "20");
+    QCommandLineOption quickOption("quick", "Run a reduced matrix, e.g. as a smoke test.");
+    QCommandLineOption keyStreamOption("key-stream", "Also replay the key events in <file> in the hotkey suite.", "file");
+    parser.addOption(suiteOption);
+    parser.addOption(outputOption);
+    parser.addOption(minTimeOption);
+    parser.addOption(quickOption);
+    parser.addOption(keyStreamOption);
+    parser.process(app);
+
+    const QStringList selected = parser.values(suiteOption);
+    for (const QString& name : selected) {
+        if (!suiteNames.contains(name)) {
+            progress(QString("Unknown suite '%1'; expected one of: %2").arg(name, suiteNames.join(", ")));
+            return 2;
+        }
+    }
+
+    Options options;
+    options.minTimeMs = qMax(0, parser.value(minTimeOption).toInt());
+    options.keyStreamPath = parser.value(keyStreamOption);
+    const bool quick = parser.isSet(quickOption);
+
+    QJsonArray results;
+    for (const Suite& suite : suites) {
+        if (selected.isEmpty() || selected.contains(suite.name)) {
+            suite.run(options, quick, results);
+        }
+    }
+
+    QJsonObject root;
+    root.insert("benchmark", "MuteActiveWindowC");
+    root.insert("timestamp", QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+    root.insert("qtVersion", qVersion());
+    root.insert("idealThreadCount", QThread::idealThreadCount());
+    root.insert("minTimeMs", options.minTimeMs);
+    root.insert("quick", quick);
+    root.insert("results", results);
+    const QByteArray json = QJsonDocument(root).toJson(QJsonDocument::Indented);
+
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            progress(QString("Cannot write %1: %2").arg(file.fileName(), file.errorString()));
+            return 1;
+        }
+        file.write(json);
+    } else {
+        QFile out;
+        out.open(stdout, QIODevice::WriteOnly);
+        out.write(json);
+    }
+    if (g_failedChecks > 0) {
+        progress(QString("%1 correctness check(s) failed").arg(g_failedChecks));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "process_tree.h"
+#include <QString>
+#include <QVector>
+
+// One active render endpoint
+struct AudioDeviceInfo {
+    QString id;             // Endpoint ID, stable across renames
+    QString name;           // Friendly name shown to the user
+    bool excluded = false;  // Matched a device exclusion when listed
+};
+
+// One audio session as reported by an AudioBackend
+struct AudioSessionEntry {
+    quint64 sessionId = 0;  // Opaque key assigned by the backend, stable for the session's lifetime
+    QString deviceId;       // Endpoint ID of the render device owning the session
+    QString deviceName;     // Friendly name of that device
+    quint32 pid = 0;
+    QString exeName;        // Executable file name, e.g. "chrome.exe", or "(unknown)"
+    QString processKey;     // exeName in ExclusionSet::normalizeProcessName() form, e.g. "chrome"
+};
+
+// Platform boundary for the audio code. Everything AudioMuter needs from the
+// OS goes through here, so the matching, exclusion and toggle logic can run
+// against SimulatedAudioBackend as well as the real Core Audio backend.
+class AudioBackend {
+public:
+    class Listener {
+    public:
+        virtual ~Listener() = default;
+
+        virtual void sessionAdded(const AudioSessionEntry& entry) = 0;
+        virtual void sessionRemoved(quint64 sessionId) = 0;
+        virtual void deviceRemoved(const QString& deviceId) = 0;
+
+        // The reported set can no longer be trusted (device added/removed/renamed).
+        // A resync follows: invalidated() again just before it reports every
+        // session afresh, then synced().
+        virtual void invalidated() = 0;
+
+        // Every session present at this point has been reported
+        virtual void synced() = 0;
+    };
+
+    virtual ~AudioBackend() = default;
+
+    // Scan path: active render endpoints and a snapshot of the sessions on one
+    // of them. Session IDs from a snapshot stay valid at least until the next
+    // snapshot of the same device. The device list is cached where the
+    // platform can tell us when it changes.
+    virtual QVector<AudioDeviceInfo> devices() = 0;
+    virtual QVector<AudioSessionEntry> sessions(const QString& deviceId) = 0;
+
+    // Executable file name for a PID, or "(unknown)"
+    virtual QString processName(quint32 pid) = 0;
+
+    // Every running process with its parent, for ProcessTree. Returns false
+    // when the processes cannot be listed.
+    virtual bool processes(QVector<ProcessTreeEntry>* processes) = 0;
+
+    // Live path: report all current sessions to `listener` and keep reporting
+    // changes until stop(). Returns false when notifications are unavailable,
+    // in which case callers use the scan path.
+    virtual bool start(Listener* listener) = 0;
+    virtual void stop() = 0;
+
+    // Re-enumerate if the backend was invalidated since the last sync. Called by
+    // the consumer before lookups; cheap when nothing changed.
+    virtual void resyncIfNeeded() = 0;
+
+    virtual bool getMute(quint64 sessionId, bool* muted) = 0;
+    virtual bool setMute(quint64 sessionId, bool muted) = 0;
+    virtual bool getVolume(quint64 sessionId, float* volume) = 0;
+    virtual bool setVolume(quint64 sessionId, float volume) = 0;
+};
@@ -0,0 +1,76 @@
+#pragma once
+#include "session_visitor.h"
+#include <QMetaType>
+#include <QString>
+#include <QVector>
+
+// Types for AudioMuter::applyBatch(): many (selector, action) pairs resolved
+// against a single enumeration, e.g. "mute A, B and C, set D to 40%".
+
+// Which sessions a batch command applies to
+struct SessionSelector {
+    enum class Kind { Pid, ExeName };
+
+    Kind kind = Kind::ExeName;
+    quint32 pid = 0;
+    QString exeName;    // Case-insensitive, e.g. "chrome.exe"
+
+    static SessionSelector byPid(quint32 pid) {
+        SessionSelector selector;
+        selector.kind = Kind::Pid;
+        selector.pid = pid;
+        return selector;
+    }
+    static SessionSelector byExeName(const QString& exeName) {
+        SessionSelector selector;
+        selector.kind = Kind::ExeName;
+        selector.exeName = exeName;
+        return selector;
+    }
+
+    QString describe() const { return kind == Kind::Pid ? QString("PID=%1").arg(pid) : QString("exe=%1").arg(exeName); }
+};
+
+// What a batch command does to each selected session
+struct BatchAction {
+    enum class Kind { ToggleMute, SetMute, SetVolume, AdjustVolume };
+
+    Kind kind = Kind::ToggleMute;
+    bool mute = false;  // SetMute
+    float value = 0.0f; // SetVolume: 0.0-1.0; AdjustVolume: step in percent, negative to decrease
+
+    static BatchAction toggleMute() { return BatchAction(); }
+    static BatchAction setMute(bool mute) {
+        BatchAction action;
+        action.kind = Kind::SetMute;
+        action.mute = mute;
+        return action;
+    }
+    static BatchAction setVolume(float volume) {
+        BatchAction action;
+        action.kind = Kind::SetVolume;
+        action.value = volume;
+        return action;
+    }
+    static BatchAction adjustVolume(float stepPercent) {
+        BatchAction action;
+        action.kind = Kind::AdjustVolume;
+        action.value = stepPercent;
+        return action;
+    }
+};
+
+struct BatchCommand {
+    SessionSelector selector;
+    BatchAction action;
+};
+
+// Outcome of one batch command, in the same position as its command
+struct BatchResult {
+    int matched = 0;                  // Sessions selected after exclusions
+    int applied = 0;                  // Sessions the action succeeded on
+    QVector<SessionVolume> volumes;   // New volumes, for SetVolume and AdjustVolume
+};
+
+Q_DECLARE_METATYPE(BatchCommand)
+Q_DECLARE_METATYPE(BatchResult)
@@ -0,0 +1,216 @@
+#include "audio_engine.h"
+#include "latency_stats.h"
+#include "logger.h"
+#include "trace_recorder.h"
+#include <utility>
+
+AudioEngine::AudioEngine(BackendFactory factory, QObject *parent)
+    : QThread(parent), factory_(std::move(factory)), head_(nullptr), nextId_(1), stopping_(false) {
+    setObjectName("AudioEngine");
+    qRegisterMetaType<AudioTarget>();
+    qRegisterMetaType<VolumeAdjustResult>();
+    qRegisterMetaType<QVector<AudioDeviceInfo>>();
+    qRegisterMetaType<QVector<BatchResult>>();
+}
+
+AudioEngine::~AudioEngine() {
+    stop();
+    deleteChain(head_.exchange(nullptr));
+}
+
+quint64 AudioEngine::toggleMute(const AudioTarget& target) {
+    Command *command = new Command;
+    command->type = CommandType::ToggleMute;
+    command->target = target;
+    return submit(command);
+}
+
+quint64 AudioEngine::adjustVolume(const AudioTarget& target, float stepPercent) {
+    Command *command = new Command;
+    command->type = CommandType::AdjustVolume;
+    command->target = target;
+    command->stepPercent = stepPercent;
+    return submit(command);
+}
+
+quint64 AudioEngine::requestDevices() {
+    Command *command = new Command;
+    command->type = CommandType::ListDevices;
+    return submit(command);
+}
+
+quint64 AudioEngine::applyBatch(const QVector<BatchCommand>& commands) {
+    Command *command = new Command;
+    command->type = CommandType::Batch;
+    command->batch = commands;
+    return submit(command);
+}
+
+quint64 AudioEngine::setScanMode(AudioMuter::ScanMode mode, int threads) {
+    Command *command = new Command;
+    command->type = CommandType::SetScanMode;
+    command->scanMode = mode;
+    command->scanThreads = threads;
+    return submit(command);
+}
+
+void AudioEngine::stop() {
+    if (stopping_.exchange(true)) {
+        wait();
+        return;
+    }
+    wakeups_.release();
+    wait();
+}
+
+quint64 AudioEngine::submit(Command *command) {
+    const quint64 id = nextId_++;
+    command->id = id;
+    command->queued.start();
+    if (stopping_) {
+        delete command;
+        return id;
+    }
+
+    Command *head = head_.load(std::memory_order_relaxed);
+    do {
+        command->next = head;
+    } while (!head_.compare_exchange_weak(head, command, std::memory_order_release, std::memory_order_relaxed));
+    wakeups_.release();
+    return id;
+}
+
+AudioEngine::Command* AudioEngine::takeAll() {
+    Command *newestFirst = head_.exchange(nullptr, std::memory_order_acquire);
+    Command *oldestFirst = nullptr;
+    while (newestFirst) {
+        Command *next = newestFirst->next;
+        newestFirst->next = oldestFirst;
+        oldestFirst = newestFirst;
+        newestFirst = next;
+    }
+    return oldestFirst;
+}
+
+void AudioEngine::run() {
+    std::unique_ptr<AudioBackend> backend = factory_();
+    if (!backend) {
+        LOG_ERROR(Audio, "Audio engine has no backend, stopping");
+        return;
+    }
+    AudioMuter muter(backend.get());
+    LOG_INFO(Audio, "Audio engine started");
+
+    while (!stopping_) {
+        wakeups_.acquire();
+        // One wakeup may cover several commands; later wakeups then find the queue empty
+        Command *command = takeAll();
+        while (command && !stopping_) {
+            Command *next = command->next;
+            execute(muter, *backend, *command);
+            delete command;
+            command = next;
+        }
+        deleteChain(command);
+    }
+    LOG_INFO(Audio, "Audio engine stopped");
+}
+
+void AudioEngine::execute(AudioMuter& muter, AudioBackend& backend, const Command& command) {
+    const AudioTarget& target = command.target;
+    const qint64 queueNs = command.queued.nsecsElapsed();
+    LatencyStats::record(LatencyStage::QueueWait, queueNs);
+    if (TraceRecorder::isEnabled()) {
+        TraceRecorder::complete("queueWait", "stage", TraceRecorder::now() - queueNs);
+    }
+    TraceSpan span(commandName(command.type), "audio");
+    QElapsedTimer applyTimer;
+    applyTimer.start();
+    switch (command.type) {
+    case CommandType::ToggleMute: {
+        int n = 0;
+        if (target.preferFamily) {
+            n = muter.toggleMuteByFamily(target.pid, target.exeName);
+            if (n == 0) {
+                LOG_DEBUG(Audio, "No audio sessions found for process family, falling back to executable-based muting");
+                n = muter.toggleMuteByExeName(target.exeName);
+            }
+        } else if (target.preferPid) {
+            n = muter.toggleMuteByPID(target.pid);
+            if (n == 0) {
+                LOG_DEBUG(Audio, "No audio sessions found for specific PID, falling back to executable-based muting");
+                n = muter.toggleMuteByExeName(target.exeName);
+            }
+        } else {
+            n = muter.toggleMuteByExeName(target.exeName);
+        }
+        recordApplied(FlightEvent::MuteApplied, command, queueNs, applyTimer.nsecsElapsed(), n, 0);
+        emit muteToggled(command.id, target, n);
+        break;
+    }
+    case CommandType::AdjustVolume: {
+        VolumeAdjustResult result;
+        if (target.preferFamily) {
+            result = muter.adjustVolumeByFamily(target.pid, target.exeName, command.stepPercent);
+            if (result.adjustedCount() == 0) {
+                LOG_DEBUG(Audio, "No audio sessions found for process family, falling back to executable-based");
+                result = muter.adjustVolumeByExeName(target.exeName, command.stepPercent);
+            }
+        } else if (target.preferPid) {
+            result = muter.adjustVolumeByPID(target.pid, command.stepPercent);
+            if (result.adjustedCount() == 0) {
+                LOG_DEBUG(Audio, "No audio sessions found for specific PID, falling back to executable-based");
+                result = muter.adjustVolumeByExeName(target.exeName, command.stepPercent);
+            }
+        } else {
+            result = muter.adjustVolumeByExeName(target.exeName, command.stepPercent);
+        }
+        recordApplied(FlightEvent::VolumeApplied, command, queueNs, applyTimer.nsecsElapsed(),
+                      result.adjustedCount(), result.averageVolume < 0.0f ? -1 : qRound(result.averageVolume * 100.0f));
+        emit volumeAdjusted(command.id, target, result);
+        break;
+    }
+    case CommandType::ListDevices:
+        emit devicesListed(command.id, backend.devices());
+        break;
+    case CommandType::SetScanMode:
+        muter.setScanMode(command.scanMode, command.scanThreads);
+        break;
+    case CommandType::Batch:
+        emit batchApplied(command.id, muter.applyBatch(command.batch));
+        break;
+    }
+}
+
+void AudioEngine::recordApplied(FlightEvent event, const Command& command, qint64 queueNs, qint64 applyNs,
+                                int sessions, int value) {
+    FlightRecord record;
+    record.event = event;
+    record.commandId = static_cast<quint32>(command.id);
+    record.pid = command.target.pid;
+    record.matched = static_cast<quint16>(qMin(sessions, 0xffff));
+    record.value = value;
+    record.setExe(command.target.exeName);
+    record.setStage(FlightStage::Queue, queueNs);
+    record.setStage(FlightStage::Apply, applyNs);
+    FlightRecorder::record(record);
+}
+
+const char* AudioEngine::commandName(CommandType type) {
+    switch (type) {
+    case CommandType::ToggleMute: return "AudioEngine::toggleMute";
+    case CommandType::AdjustVolume: return "AudioEngine::adjustVolume";
+    case CommandType::ListDevices: return "AudioEngine::listDevices";
+    case CommandType::SetScanMode: return "AudioEngine::setScanMode";
+    case CommandType::Batch: return "AudioEngine::applyBatch";
+    }
+    return "AudioEngine::execute";
+}
+
+void AudioEngine::deleteChain(Command *command) {
+    while (command) {
+        Command *next = command->next;
+        delete command;
+        command = next;
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "audio_backend.h"
+#include "audio_muter.h"
+#include "flight_recorder.h"
+#include <QElapsedTimer>
+#include <QMetaType>
+#include <QSemaphore>
+#include <QString>
+#include <QThread>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// What a hotkey acts on: the foreground process, and whether to try its PID
+// (or its process family) before falling back to every process with the
+// same executable name
+struct AudioTarget {
+    quint32 pid = 0;
+    QString exeName;
+    bool preferPid = false;
+    bool preferFamily = false;  // The PID and its descendants; takes precedence over preferPid
+};
+
+// Thread that owns the audio backend and runs every mute and volume
+// operation, so a slow endpoint driver never stalls the GUI thread. The
+// backend is created on this thread, which makes it the COM MTA thread for
+// Core Audio. Commands go through a lock-free queue and any thread may submit
+// them; results come back as signals, queued to the receiver's thread.
+class AudioEngine : public QThread {
+    Q_OBJECT
+public:
+    using BackendFactory = std::function<std::unique_ptr<AudioBackend>()>;
+
+    explicit AudioEngine(BackendFactory factory, QObject *parent = nullptr);
+    ~AudioEngine() override;
+
+    // Each returns the command ID echoed by the completion signal
+    quint64 toggleMute(const AudioTarget& target);
+    quint64 adjustVolume(const AudioTarget& target, float stepPercent);
+    quint64 requestDevices();
+    quint64 applyBatch(const QVector<BatchCommand>& commands);
+    // Applied in order with the other commands
+    quint64 setScanMode(AudioMuter::ScanMode mode, int threads);
+
+    // Finish the command being executed, drop the rest and join the thread
+    void stop();
+
+signals:
+    void muteToggled(quint64 commandId, const AudioTarget& target, int sessions);
+    void volumeAdjusted(quint64 commandId, const AudioTarget& target, const VolumeAdjustResult& result);
+    void devicesListed(quint64 commandId, const QVector<AudioDeviceInfo>& devices);
+    // One result per command, in command order
+    void batchApplied(quint64 commandId, const QVector<BatchResult>& results);
+
+protected:
+    void run() override;
+
+private:
+    enum class CommandType { ToggleMute, AdjustVolume, ListDevices, SetScanMode, Batch };
+
+    struct Command {
+        quint64 id = 0;
+        CommandType type = CommandType::ToggleMute;
+        AudioTarget target;
+        float stepPercent = 0.0f;
+        AudioMuter::ScanMode scanMode = AudioMuter::ScanMode::Sequential;
+        int scanThreads = 1;
+        QVector<BatchCommand> batch;
+        QElapsedTimer queued;   // Started on submission
+        Command *next = nullptr;
+    };
+
+    quint64 submit(Command *command);
+    // Detach every queued command, oldest first
+    Command* takeAll();
+    void execute(AudioMuter& muter, AudioBackend& backend, const Command& command);
+    static void recordApplied(FlightEvent event, const Command& command, qint64 queueNs, qint64 applyNs,
+                              int sessions, int value);
+    static void deleteChain(Command *command);
+    // Span name for traces
+    static const char* commandName(CommandType type);
+
+    BackendFactory factory_;
+    // Multi-producer stack of pending commands, newest first; the engine
+    // thread swaps the whole stack out and reverses it
+    std::atomic<Command*> head_;
+    // Counts submissions so the engine thread can sleep while the queue is empty
+    QSemaphore wakeups_;
+    std::atomic<quint64> nextId_;
+    std::atomic<bool> stopping_;
+};
+
+Q_DECLARE_METATYPE(AudioTarget)
+Q_DECLARE_METATYPE(VolumeAdjustResult)
@@ -1,1100 +1,435 @@
 #include "audio_muter.h"
 #include "logger.h"
-#include "config.h"
-#include <atlbase.h>       // CComPtr
-#include <functiondiscoverykeys_devpkey.h>
+#include <QHash>
+#include <QSet>
 #include <QString>
-#include <QFileInfo>
-
-AudioMuter::AudioMuter() : enumerator_(nullptr) {
-    CoInitializeEx(nullptr, COINIT_MULTITHREADED);
-    CoCreateInstance(__uuidof(MMDeviceEnumerator),
-                     nullptr,
-                     CLSCTX_ALL,
-                     IID_PPV_ARGS(&enumerator_));
+#include <QThread>
+#include <algorithm>
+#include <utility>
+
+AudioMuter::AudioMuter(AudioBackend *backend)
+    : backend_(backend), indexStarted_(false), scanMode_(ScanMode::Sequential), processTreeBuilt_(false) {
+    scanPool_.setMaxThreadCount(qBound(1, QThread::idealThreadCount(), 4));
+    if (backend_ && backend_->start(&sessionIndex_)) {
+        indexStarted_ = true;
+        LOG_INFO(Audio, QString("Audio session index live with %1 sessions").arg(sessionIndex_.sessionCount()));
+    } else {
+        LOG_INFO(Audio, "Audio session index unavailable, falling back to full scans");
+    }
 }
 
 AudioMuter::~AudioMuter() {
-    if (enumerator_) enumerator_->Release();
-    CoUninitialize();
-}
-
-int AudioMuter::toggleOnDevice(IMMDevice *device, const QString& targetExeName) {
-    Logger::log("=== toggleOnDevice called ===");
-    
-    CComPtr<IAudioSessionManager2> mgr2;
-    if (FAILED(device->Activate(__uuidof(IAudioSessionManager2),
-                                CLSCTX_ALL,
-                                nullptr,
-                                (void**)&mgr2))) {
-        Logger::log("Failed to activate IAudioSessionManager2");
-        return 0;
-    }
-    Logger::log("IAudioSessionManager2 activated successfully");
-    
-    CComPtr<IAudioSessionEnumerator> sessEnum;
-    if (FAILED(mgr2->GetSessionEnumerator(&sessEnum))) {
-        Logger::log("Failed to get session enumerator");
-        return 0;
+    scanPool_.waitForDone();
+    if (indexStarted_) {
+        backend_->stop();
     }
-    Logger::log("Session enumerator obtained successfully");
+}
 
-    int count = 0;
-    int n;
-    sessEnum->GetCount(&n);
-    Logger::log(QString("Total audio sessions on device: %1").arg(n));
-    
-    for (int i = 0; i < n; ++i) {
-        CComPtr<IAudioSessionControl> ctl;
-        if (FAILED(sessEnum->GetSession(i, &ctl))) {
-            Logger::log(QString("Failed to get session %1").arg(i));
-            continue;
-        }
+void AudioMuter::setScanMode(ScanMode mode, int threads) {
+    scanMode_ = mode;
+    scanPool_.setMaxThreadCount(qBound(1, threads, MAX_SCAN_THREADS));
+    LOG_INFO(Audio, QString("Device scan mode: %1, %2 threads").arg(scanModeToString(mode)).arg(scanPool_.maxThreadCount()));
+}
 
-        CComPtr<IAudioSessionControl2> ctl2;
-        if (FAILED(ctl->QueryInterface(__uuidof(IAudioSessionControl2), (void**)&ctl2))) {
-            Logger::log(QString("Failed to get IAudioSessionControl2 for session %1").arg(i));
-            continue;
-        }
+AudioMuter::ScanMode AudioMuter::scanModeFromString(const QString& mode) {
+    return mode.compare("parallel", Qt::CaseInsensitive) == 0 ? ScanMode::Parallel : ScanMode::Sequential;
+}
 
-        DWORD pid = 0;
-        if (FAILED(ctl2->GetProcessId(&pid))) {
-            Logger::log(QString("Failed to get process ID for session %1").arg(i));
-            continue;
-        }
-        
-        // Get process name
-        QString exeName = "(unknown)";
-        HANDLE hProc = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
-        if (hProc) {
-            WCHAR buf[MAX_PATH];
-            DWORD len = MAX_PATH;
-            if (QueryFullProcessImageNameW(hProc, 0, buf, &len)) {
-                exeName = QFileInfo(QString::fromWCharArray(buf)).fileName();
-            }
-            CloseHandle(hProc);
-        }
-        
-        Logger::log(QString("Session %1: PID=%2, EXE=%3, Target EXE=%4").arg(i).arg(pid).arg(exeName, targetExeName));
-        
-        // Check if this process is in the exclusion list
-        QString processNameWithoutExt = exeName;
-        if (processNameWithoutExt.endsWith(".exe", Qt::CaseInsensitive)) {
-            processNameWithoutExt = processNameWithoutExt.left(processNameWithoutExt.length() - 4);
-        }
-        
-        if (Config::instance().isProcessExcluded(processNameWithoutExt)) {
-            Logger::log(QString("Session %1: Process '%2' is in exclusion list, skipping").arg(i).arg(processNameWithoutExt));
-            continue;
-        }
-        
-        if (exeName.compare(targetExeName, Qt::CaseInsensitive) != 0) {
-            Logger::log(QString("Session %1: Executable mismatch, skipping").arg(i));
-            continue;
-        }
+QString AudioMuter::scanModeToString(ScanMode mode) {
+    return mode == ScanMode::Parallel ? "parallel" : "sequential";
+}
 
-        Logger::log(QString("Session %1: Executable match found! Checking mute state...").arg(i));
+bool AudioMuter::sessionIndexReady() {
+    if (!indexStarted_) {
+        return false;
+    }
+    backend_->resyncIfNeeded();
+    return sessionIndex_.isLive();
+}
 
-        CComPtr<ISimpleAudioVolume> vol;
-        if (FAILED(ctl2->QueryInterface(__uuidof(ISimpleAudioVolume), (void**)&vol))) {
-            Logger::log(QString("Failed to get ISimpleAudioVolume for session %1").arg(i));
-            continue;
-        }
-        
-        if (vol) {
-            BOOL isMuted = FALSE;
-            if (SUCCEEDED(vol->GetMute(&isMuted))) {
-                Logger::log(QString("Session %1: Current mute state: %2").arg(i).arg(isMuted ? "Muted" : "Not muted"));
-                
-                // Toggle the mute state
-                BOOL newMuteState = !isMuted;
-                if (SUCCEEDED(vol->SetMute(newMuteState, nullptr))) {
-                    ++count;
-                    Logger::log(QString("Session %1: Successfully toggled mute to %2 for session pid=%3").arg(i).arg(newMuteState ? "Muted" : "Unmuted").arg(pid));
-                } else {
-                    Logger::log(QString("Session %1: Failed to toggle mute for session pid=%2").arg(i).arg(pid));
-                }
+QVector<quint32> AudioMuter::processFamily(quint32 rootPID, const QString& rootExeName) {
+    if (isShellOrLauncher(rootExeName) && !hasOwnSessions(rootPID)) {
+        LOG_DEBUG(Audio, QString("%1 (PID=%2) is a shell or launcher without audio, using its PID only").arg(rootExeName).arg(rootPID));
+        return QVector<quint32>{rootPID};
+    }
+    if (backend_ && processTreeNeedsSync(rootPID)) {
+        LatencySpan span(LatencyStage::ProcessTree);
+        QVector<ProcessTreeEntry> listing;
+        processTreeSynced_.start();
+        if (backend_->processes(&listing)) {
+            if (processTreeBuilt_) {
+                const int changed = processTree_.sync(listing);
+                LOG_DEBUG(Audio, QString("Process tree synced: %1 processes started or exited").arg(changed));
             } else {
-                Logger::log(QString("Session %1: Failed to get mute state for session pid=%2").arg(i).arg(pid));
+                processTree_.reset(listing);
+                processTreeBuilt_ = true;
+                LOG_INFO(Audio, QString("Process tree built with %1 processes").arg(processTree_.size()));
             }
-        } else {
-            Logger::log(QString("Session %1: ISimpleAudioVolume is null").arg(i));
         }
     }
-    
-    Logger::log(QString("toggleOnDevice completed: %1 sessions toggled").arg(count));
-    return count;
+    return processTree_.family(rootPID);
 }
 
-int AudioMuter::toggleMuteByExeName(const QString& targetExeName) {
-    Logger::log(QString("=== toggleMuteByExeName called with target EXE: %1 ===").arg(targetExeName));
-    
-    if (!enumerator_) {
-        Logger::log("Audio enumerator is null!");
-        return 0;
-    }
-    
-    CComPtr<IMMDeviceCollection> devs;
-    HRESULT hr = enumerator_->EnumAudioEndpoints(eRender, DEVICE_STATE_ACTIVE, &devs);
-    if (FAILED(hr)) {
-        Logger::log(QString("Failed to enumerate audio endpoints. HRESULT: 0x%1").arg(hr, 0, 16));
-        return 0;
-    }
-    Logger::log("Audio endpoints enumerated successfully");
-
-    int total = 0;
-    UINT n;
-    devs->GetCount(&n);
-    Logger::log(QString("Found %1 active audio render devices").arg(n));
-    
-    for (UINT i = 0; i < n; ++i) {
-        CComPtr<IMMDevice> dev;
-        if (FAILED(devs->Item(i, &dev))) {
-            Logger::log(QString("Failed to get device %1").arg(i));
-            continue;
-        }
+bool AudioMuter::isShellOrLauncher(const QString& exeName) {
+    // The desktop shell and consoles, and the game launchers every game starts under
+    static const QSet<QString> keys = {
+        "explorer", "cmd", "powershell", "pwsh", "windowsterminal",
+        "steam", "epicgameslauncher", "galaxyclient", "battle.net", "eadesktop", "origin", "upc",
+    };
+    return keys.contains(ExclusionSet::normalizeProcessName(exeName));
+}
 
-        // Get device friendly name
-        QString deviceName = "(unknown)";
-        CComPtr<IPropertyStore> props;
-        if (SUCCEEDED(dev->OpenPropertyStore(STGM_READ, &props))) {
-            PROPVARIANT var; 
-            PropVariantInit(&var);
-            if (SUCCEEDED(props->GetValue(PKEY_Device_FriendlyName, &var))) {
-                deviceName = QString::fromWCharArray(var.pwszVal);
+bool AudioMuter::hasOwnSessions(quint32 pid) {
+    if (sessionIndexReady()) {
+        return !sessionIndex_.sessionsForPID(pid).isEmpty();
+    }
+    const QVector<AudioDeviceInfo> devices = scanDevices();
+    for (const AudioDeviceInfo& device : devices) {
+        const QVector<AudioSessionEntry> sessions = scanSessions(device);
+        for (const AudioSessionEntry& session : sessions) {
+            if (session.pid == pid) {
+                return true;
             }
-            PropVariantClear(&var);
         }
-        
-        Logger::log(QString("Scanning device %1: %2").arg(i).arg(deviceName));
-        
-        // Check if device is excluded
-        if (Config::instance().isDeviceExcluded(deviceName)) {
-            Logger::log(QString("Device %1 (%2) is excluded, skipping").arg(i).arg(deviceName));
-            continue;
-        }
-        
-        int deviceToggled = toggleOnDevice(dev, targetExeName);
-        total += deviceToggled;
-        Logger::log(QString("Device %1: %2 sessions toggled").arg(i).arg(deviceToggled));
     }
-    
-    Logger::log(QString("=== toggleMuteByExeName completed: Total sessions toggled for exe=%1: %2 ===")
-                    .arg(targetExeName)
-                    .arg(total)
-                );
-    return total;
+    return false;
 }
 
-int AudioMuter::toggleMuteByPID(DWORD targetPID) {
-    Logger::log(QString("=== toggleMuteByPID called with target PID: %1 ===").arg(targetPID));
-    
-    if (!enumerator_) {
-        Logger::log("Audio enumerator is null!");
-        return 0;
+bool AudioMuter::processTreeNeedsSync(quint32 rootPID) const {
+    if (!processTreeSynced_.isValid()) {
+        return true;
+    }
+    const qint64 age = processTreeSynced_.elapsed();
+    if (age < PROCESS_TREE_RESYNC_MS) {
+        return false;
     }
-    
-    // Get the executable name for logging
-    QString exeName = "(unknown)";
-    HANDLE hProc = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, targetPID);
-    if (hProc) {
-        WCHAR buf[MAX_PATH];
-        DWORD len = MAX_PATH;
-        if (QueryFullProcessImageNameW(hProc, 0, buf, &len)) {
-            exeName = QFileInfo(QString::fromWCharArray(buf)).fileName();
+    if (!processTreeBuilt_ || age >= PROCESS_TREE_MAX_AGE_MS || !processTree_.contains(rootPID)) {
+        return true;
+    }
+    // The scan path cannot tell which processes have sessions without a scan of its own
+    if (!indexStarted_ || !sessionIndex_.isLive()) {
+        return true;
+    }
+    // A process started after the last listing may be a new renderer of the family
+    const QVector<quint32> sessionPids = sessionIndex_.pids();
+    for (quint32 pid : sessionPids) {
+        if (pid != 0 && !processTree_.contains(pid)) {
+            return true;
         }
-        CloseHandle(hProc);
     }
-    
-    Logger::log(QString("Target process: %1 (PID: %2)").arg(exeName).arg(targetPID));
-    
-    CComPtr<IMMDeviceCollection> devs;
-    HRESULT hr = enumerator_->EnumAudioEndpoints(eRender, DEVICE_STATE_ACTIVE, &devs);
-    if (FAILED(hr)) {
-        Logger::log(QString("Failed to enumerate audio endpoints. HRESULT: 0x%1").arg(hr, 0, 16));
-        return 0;
+    return false;
+}
+
+bool AudioMuter::isProcessExcluded(const ExclusionSet& exclusions, const AudioSessionEntry& session) {
+    if (exclusions.isProcessKeyExcluded(session.processKey)) {
+        LOG_TRACE(Audio, QString("Session %1: Process '%2' is in exclusion list, skipping").arg(session.sessionId).arg(session.exeName));
+        return true;
     }
-    Logger::log("Audio endpoints enumerated successfully");
+    return false;
+}
 
-    int total = 0;
-    UINT n;
-    devs->GetCount(&n);
-    Logger::log(QString("Found %1 active audio render devices").arg(n));
-    
-    for (UINT i = 0; i < n; ++i) {
-        CComPtr<IMMDevice> dev;
-        if (FAILED(devs->Item(i, &dev))) {
-            Logger::log(QString("Failed to get device %1").arg(i));
-            continue;
-        }
+bool AudioMuter::isSessionExcluded(const ExclusionSet& exclusions, const AudioSessionEntry& session) {
+    if (exclusions.isDeviceExcluded(session.deviceId, session.deviceName)) {
+        LOG_TRACE(Audio, QString("Session %1: Device '%2' is excluded, skipping").arg(session.sessionId).arg(session.deviceName));
+        return true;
+    }
+    return isProcessExcluded(exclusions, session);
+}
+
+QVector<AudioDeviceInfo> AudioMuter::scanDevices() {
+    LatencySpan span(LatencyStage::DeviceEnumeration);
+    QVector<AudioDeviceInfo> result;
+    const QVector<AudioDeviceInfo> devices = backend_->devices();
+    LOG_DEBUG(Audio, QString("Found %1 active audio render devices").arg(devices.size()));
+
+    for (int i = 0; i < devices.size(); ++i) {
+        const AudioDeviceInfo& device = devices[i];
+        LOG_TRACE(Audio, QString("Scanning device %1: %2").arg(i).arg(device.name));
 
-        // Get device friendly name
-        QString deviceName = "(unknown)";
-        CComPtr<IPropertyStore> props;
-        if (SUCCEEDED(dev->OpenPropertyStore(STGM_READ, &props))) {
-            PROPVARIANT var; 
-            PropVariantInit(&var);
-            if (SUCCEEDED(props->GetValue(PKEY_Device_FriendlyName, &var))) {
-                deviceName = QString::fromWCharArray(var.pwszVal);
-            }
-            PropVariantClear(&var);
-        }
-        
-        Logger::log(QString("Scanning device %1: %2").arg(i).arg(deviceName));
-        
         // Check if device is excluded
-        if (Config::instance().isDeviceExcluded(deviceName)) {
-            Logger::log(QString("Device %1 (%2) is excluded, skipping").arg(i).arg(deviceName));
+        if (device.excluded) {
+            LOG_DEBUG(Audio, QString("Device %1 (%2) is excluded, skipping").arg(i).arg(device.name));
             continue;
         }
-        
-        int deviceToggled = toggleOnDeviceByPID(dev, targetPID);
-        total += deviceToggled;
-        Logger::log(QString("Device %1: %2 sessions toggled").arg(i).arg(deviceToggled));
+        result.append(device);
     }
-    
-    Logger::log(QString("=== toggleMuteByPID completed: Total sessions toggled for PID=%1: %2 ===")
-                    .arg(targetPID)
-                    .arg(total)
+    return result;
+}
+
+QVector<AudioSessionEntry> AudioMuter::scanSessions(const AudioDeviceInfo& device) {
+    LatencySpan span(LatencyStage::SessionScan);
+    return backend_->sessions(device.id);
+}
+
+int AudioMuter::toggleMuteByExeName(const QString& targetExeName) {
+    LOG_DEBUG(Audio, QString("=== toggleMuteByExeName called with target EXE: %1 ===").arg(targetExeName));
+
+    ToggleMuteAction toggle;
+    visitSessions(ExeMatcher{targetExeName}, toggle);
+
+    LOG_DEBUG(Audio, QString("=== toggleMuteByExeName completed: Total sessions toggled for exe=%1: %2 ===")
+                    .arg(targetExeName)
+                    .arg(toggle.toggled)
                 );
-    return total;
+    return toggle.toggled;
 }
 
-int AudioMuter::toggleOnDeviceByPID(IMMDevice *device, DWORD targetPID) {
-    Logger::log("=== toggleOnDeviceByPID called ===");
-    
-    CComPtr<IAudioSessionManager2> mgr2;
-    if (FAILED(device->Activate(__uuidof(IAudioSessionManager2),
-                                CLSCTX_ALL,
-                                nullptr,
-                                (void**)&mgr2))) {
-        Logger::log("Failed to activate IAudioSessionManager2");
-        return 0;
-    }
-    Logger::log("IAudioSessionManager2 activated successfully");
-    
-    CComPtr<IAudioSessionEnumerator> sessEnum;
-    if (FAILED(mgr2->GetSessionEnumerator(&sessEnum))) {
-        Logger::log("Failed to get session enumerator");
-        return 0;
-    }
-    Logger::log("Session enumerator obtained successfully");
+int AudioMuter::toggleMuteByPID(quint32 targetPID) {
+    LOG_DEBUG(Audio, QString("=== toggleMuteByPID called with target PID: %1 ===").arg(targetPID));
 
-    int count = 0;
-    int n;
-    sessEnum->GetCount(&n);
-    Logger::log(QString("Total audio sessions on device: %1").arg(n));
-    
-    for (int i = 0; i < n; ++i) {
-        CComPtr<IAudioSessionControl> ctl;
-        if (FAILED(sessEnum->GetSession(i, &ctl))) {
-            Logger::log(QString("Failed to get session %1").arg(i));
-            continue;
-        }
+    ToggleMuteAction toggle;
+    visitSessions(PidMatcher{targetPID}, toggle);
 
-        CComPtr<IAudioSessionControl2> ctl2;
-        if (FAILED(ctl->QueryInterface(__uuidof(IAudioSessionControl2), (void**)&ctl2))) {
-            Logger::log(QString("Failed to get IAudioSessionControl2 for session %1").arg(i));
-            continue;
-        }
+    LOG_DEBUG(Audio, QString("=== toggleMuteByPID completed: Total sessions toggled for PID=%1: %2 ===")
+                    .arg(targetPID)
+                    .arg(toggle.toggled)
+                );
+    return toggle.toggled;
+}
 
-        DWORD pid = 0;
-        if (FAILED(ctl2->GetProcessId(&pid))) {
-            Logger::log(QString("Failed to get process ID for session %1").arg(i));
-            continue;
-        }
-        
-        // Get process name
-        QString exeName = "(unknown)";
-        HANDLE hProc = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
-        if (hProc) {
-            WCHAR buf[MAX_PATH];
-            DWORD len = MAX_PATH;
-            if (QueryFullProcessImageNameW(hProc, 0, buf, &len)) {
-                exeName = QFileInfo(QString::fromWCharArray(buf)).fileName();
-            }
-            CloseHandle(hProc);
-        }
-        
-        Logger::log(QString("Session %1: PID=%2, EXE=%3").arg(i).arg(pid).arg(exeName));
-        
-        // Check if this process is in the exclusion list
-        QString processNameWithoutExt = exeName;
-        if (processNameWithoutExt.endsWith(".exe", Qt::CaseInsensitive)) {
-            processNameWithoutExt = processNameWithoutExt.left(processNameWithoutExt.length() - 4);
-        }
-        
-        if (Config::instance().isProcessExcluded(processNameWithoutExt)) {
-            Logger::log(QString("Session %1: Process '%2' is in exclusion list, skipping").arg(i).arg(processNameWithoutExt));
-            continue;
-        }
-        
-        // Check if this PID matches our target PID
-        if (pid != targetPID) {
-            Logger::log(QString("Session %1: PID %2 not in target list, skipping").arg(i).arg(pid));
-            continue;
-        }
+int AudioMuter::toggleMuteByFamily(quint32 rootPID, const QString& rootExeName) {
+    LOG_DEBUG(Audio, QString("=== toggleMuteByFamily called with root PID: %1 (%2) ===").arg(rootPID).arg(rootExeName));
 
-        Logger::log(QString("Session %1: PID match found! Checking mute state...").arg(i));
+    ToggleMuteAction toggle;
+    visitSessions(FamilyMatcher(rootPID, processFamily(rootPID, rootExeName)), toggle);
 
-        CComPtr<ISimpleAudioVolume> vol;
-        if (FAILED(ctl2->QueryInterface(__uuidof(ISimpleAudioVolume), (void**)&vol))) {
-            Logger::log(QString("Failed to get ISimpleAudioVolume for session %1").arg(i));
-            continue;
-        }
-        
-        if (vol) {
-            BOOL isMuted = FALSE;
-            if (SUCCEEDED(vol->GetMute(&isMuted))) {
-                Logger::log(QString("Session %1: Current mute state: %2").arg(i).arg(isMuted ? "Muted" : "Not muted"));
-                
-                // Toggle the mute state
-                BOOL newMuteState = !isMuted;
-                if (SUCCEEDED(vol->SetMute(newMuteState, nullptr))) {
-                    ++count;
-                    Logger::log(QString("Session %1: Successfully toggled mute to %2 for session pid=%3").arg(i).arg(newMuteState ? "Muted" : "Unmuted").arg(pid));
-                } else {
-                    Logger::log(QString("Session %1: Failed to toggle mute for session pid=%2").arg(i).arg(pid));
-                }
-            } else {
-                Logger::log(QString("Session %1: Failed to get mute state for session pid=%2").arg(i).arg(pid));
-            }
-        } else {
-            Logger::log(QString("Session %1: ISimpleAudioVolume is null").arg(i));
-        }
-    }
-    
-    Logger::log(QString("toggleOnDeviceByPID completed: %1 sessions toggled").arg(count));
-    return count;
+    LOG_DEBUG(Audio, QString("=== toggleMuteByFamily completed: Total sessions toggled for family of PID=%1: %2 ===")
+                    .arg(rootPID)
+                    .arg(toggle.toggled)
+                );
+    return toggle.toggled;
 }
 
 int AudioMuter::increaseVolumeByExeName(const QString& targetExeName, float stepPercent) {
-    Logger::log(QString("=== increaseVolumeByExeName called with target EXE: %1, step: %2% ===").arg(targetExeName).arg(stepPercent));
-    
-    if (!enumerator_) {
-        Logger::log("Audio enumerator is null!");
-        return 0;
-    }
-    
-    CComPtr<IMMDeviceCollection> devs;
-    HRESULT hr = enumerator_->EnumAudioEndpoints(eRender, DEVICE_STATE_ACTIVE, &devs);
-    if (FAILED(hr)) {
-        Logger::log(QString("Failed to enumerate audio endpoints. HRESULT: 0x%1").arg(hr, 0, 16));
-        return 0;
-    }
-    Logger::log("Audio endpoints enumerated successfully");
+    LOG_DEBUG(Audio, QString("=== increaseVolumeByExeName called with target EXE: %1, step: %2% ===").arg(targetExeName).arg(stepPercent));
 
-    int total = 0;
-    UINT n;
-    devs->GetCount(&n);
-    Logger::log(QString("Found %1 active audio render devices").arg(n));
-    
-    for (UINT i = 0; i < n; ++i) {
-        CComPtr<IMMDevice> dev;
-        if (FAILED(devs->Item(i, &dev))) {
-            Logger::log(QString("Failed to get device %1").arg(i));
-            continue;
-        }
+    VolumeAdjustResult result = adjustVolumeByExeName(targetExeName, stepPercent);
 
-        // Get device friendly name
-        QString deviceName = "(unknown)";
-        CComPtr<IPropertyStore> props;
-        if (SUCCEEDED(dev->OpenPropertyStore(STGM_READ, &props))) {
-            PROPVARIANT var; 
-            PropVariantInit(&var);
-            if (SUCCEEDED(props->GetValue(PKEY_Device_FriendlyName, &var))) {
-                deviceName = QString::fromWCharArray(var.pwszVal);
-            }
-            PropVariantClear(&var);
-        }
-        
-        Logger::log(QString("Scanning device %1: %2").arg(i).arg(deviceName));
-        
-        // Check if device is excluded
-        if (Config::instance().isDeviceExcluded(deviceName)) {
-            Logger::log(QString("Device %1 (%2) is excluded, skipping").arg(i).arg(deviceName));
-            continue;
-        }
-        
-        int deviceAdjusted = adjustVolumeOnDevice(dev, targetExeName, stepPercent);
-        total += deviceAdjusted;
-        Logger::log(QString("Device %1: %2 sessions adjusted").arg(i).arg(deviceAdjusted));
-    }
-    
-    Logger::log(QString("=== increaseVolumeByExeName completed: Total sessions adjusted for exe=%1: %2 ===")
+    LOG_DEBUG(Audio, QString("=== increaseVolumeByExeName completed: Total sessions adjusted for exe=%1: %2 ===")
                     .arg(targetExeName)
-                    .arg(total)
+                    .arg(result.adjustedCount())
                 );
-    return total;
+    return result.adjustedCount();
 }
 
 int AudioMuter::decreaseVolumeByExeName(const QString& targetExeName, float stepPercent) {
-    Logger::log(QString("=== decreaseVolumeByExeName called with target EXE: %1, step: %2% ===").arg(targetExeName).arg(stepPercent));
-    
-    if (!enumerator_) {
-        Logger::log("Audio enumerator is null!");
-        return 0;
-    }
-    
-    CComPtr<IMMDeviceCollection> devs;
-    HRESULT hr = enumerator_->EnumAudioEndpoints(eRender, DEVICE_STATE_ACTIVE, &devs);
-    if (FAILED(hr)) {
-        Logger::log(QString("Failed to enumerate audio endpoints. HRESULT: 0x%1").arg(hr, 0, 16));
-        return 0;
-    }
-    Logger::log("Audio endpoints enumerated successfully");
+    LOG_DEBUG(Audio, QString("=== decreaseVolumeByExeName called with target EXE: %1, step: %2% ===").arg(targetExeName).arg(stepPercent));
 
-    int total = 0;
-    UINT n;
-    devs->GetCount(&n);
-    Logger::log(QString("Found %1 active audio render devices").arg(n));
-    
-    for (UINT i = 0; i < n; ++i) {
-        CComPtr<IMMDevice> dev;
-        if (FAILED(devs->Item(i, &dev))) {
-            Logger::log(QString("Failed to get device %1").arg(i));
-            continue;
-        }
+    VolumeAdjustResult result = adjustVolumeByExeName(targetExeName, -stepPercent);
 
-        // Get device friendly name
-        QString deviceName = "(unknown)";
-        CComPtr<IPropertyStore> props;
-        if (SUCCEEDED(dev->OpenPropertyStore(STGM_READ, &props))) {
-            PROPVARIANT var; 
-            PropVariantInit(&var);
-            if (SUCCEEDED(props->GetValue(PKEY_Device_FriendlyName, &var))) {
-                deviceName = QString::fromWCharArray(var.pwszVal);
-            }
-            PropVariantClear(&var);
-        }
-        
-        Logger::log(QString("Scanning device %1: %2").arg(i).arg(deviceName));
-        
-        // Check if device is excluded
-        if (Config::instance().isDeviceExcluded(deviceName)) {
-            Logger::log(QString("Device %1 (%2) is excluded, skipping").arg(i).arg(deviceName));
-            continue;
-        }
-        
-        int deviceAdjusted = adjustVolumeOnDevice(dev, targetExeName, -stepPercent);
-        total += deviceAdjusted;
-        Logger::log(QString("Device %1: %2 sessions adjusted").arg(i).arg(deviceAdjusted));
-    }
-    
-    Logger::log(QString("=== decreaseVolumeByExeName completed: Total sessions adjusted for exe=%1: %2 ===")
+    LOG_DEBUG(Audio, QString("=== decreaseVolumeByExeName completed: Total sessions adjusted for exe=%1: %2 ===")
                     .arg(targetExeName)
-                    .arg(total)
+                    .arg(result.adjustedCount())
                 );
-    return total;
+    return result.adjustedCount();
 }
 
-int AudioMuter::increaseVolumeByPID(DWORD targetPID, float stepPercent) {
-    Logger::log(QString("=== increaseVolumeByPID called with target PID: %1, step: %2% ===").arg(targetPID).arg(stepPercent));
-    
-    if (!enumerator_) {
-        Logger::log("Audio enumerator is null!");
-        return 0;
-    }
-    
-    // Get the executable name for logging
-    QString exeName = "(unknown)";
-    HANDLE hProc = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, targetPID);
-    if (hProc) {
-        WCHAR buf[MAX_PATH];
-        DWORD len = MAX_PATH;
-        if (QueryFullProcessImageNameW(hProc, 0, buf, &len)) {
-            exeName = QFileInfo(QString::fromWCharArray(buf)).fileName();
-        }
-        CloseHandle(hProc);
-    }
-    
-    Logger::log(QString("Target process: %1 (PID: %2)").arg(exeName).arg(targetPID));
-    
-    CComPtr<IMMDeviceCollection> devs;
-    HRESULT hr = enumerator_->EnumAudioEndpoints(eRender, DEVICE_STATE_ACTIVE, &devs);
-    if (FAILED(hr)) {
-        Logger::log(QString("Failed to enumerate audio endpoints. HRESULT: 0x%1").arg(hr, 0, 16));
-        return 0;
-    }
-    Logger::log("Audio endpoints enumerated successfully");
+int AudioMuter::increaseVolumeByPID(quint32 targetPID, float stepPercent) {
+    LOG_DEBUG(Audio, QString("=== increaseVolumeByPID called with target PID: %1, step: %2% ===").arg(targetPID).arg(stepPercent));
 
-    int total = 0;
-    UINT n;
-    devs->GetCount(&n);
-    Logger::log(QString("Found %1 active audio render devices").arg(n));
-    
-    for (UINT i = 0; i < n; ++i) {
-        CComPtr<IMMDevice> dev;
-        if (FAILED(devs->Item(i, &dev))) {
-            Logger::log(QString("Failed to get device %1").arg(i));
-            continue;
-        }
+    VolumeAdjustResult result = adjustVolumeByPID(targetPID, stepPercent);
 
-        // Get device friendly name
-        QString deviceName = "(unknown)";
-        CComPtr<IPropertyStore> props;
-        if (SUCCEEDED(dev->OpenPropertyStore(STGM_READ, &props))) {
-            PROPVARIANT var; 
-            PropVariantInit(&var);
-            if (SUCCEEDED(props->GetValue(PKEY_Device_FriendlyName, &var))) {
-                deviceName = QString::fromWCharArray(var.pwszVal);
-            }
-            PropVariantClear(&var);
-        }
-        
-        Logger::log(QString("Scanning device %1: %2").arg(i).arg(deviceName));
-        
-        // Check if device is excluded
-        if (Config::instance().isDeviceExcluded(deviceName)) {
-            Logger::log(QString("Device %1 (%2) is excluded, skipping").arg(i).arg(deviceName));
-            continue;
-        }
-        
-        int deviceAdjusted = adjustVolumeOnDeviceByPID(dev, targetPID, stepPercent);
-        total += deviceAdjusted;
-        Logger::log(QString("Device %1: %2 sessions adjusted").arg(i).arg(deviceAdjusted));
-    }
-    
-    Logger::log(QString("=== increaseVolumeByPID completed: Total sessions adjusted for PID=%1: %2 ===")
+    LOG_DEBUG(Audio, QString("=== increaseVolumeByPID completed: Total sessions adjusted for PID=%1: %2 ===")
                     .arg(targetPID)
-                    .arg(total)
+                    .arg(result.adjustedCount())
                 );
-    return total;
+    return result.adjustedCount();
 }
 
-int AudioMuter::decreaseVolumeByPID(DWORD targetPID, float stepPercent) {
-    Logger::log(QString("=== decreaseVolumeByPID called with target PID: %1, step: %2% ===").arg(targetPID).arg(stepPercent));
-    
-    if (!enumerator_) {
-        Logger::log("Audio enumerator is null!");
-        return 0;
-    }
-    
-    // Get the executable name for logging
-    QString exeName = "(unknown)";
-    HANDLE hProc = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, targetPID);
-    if (hProc) {
-        WCHAR buf[MAX_PATH];
-        DWORD len = MAX_PATH;
-        if (QueryFullProcessImageNameW(hProc, 0, buf, &len)) {
-            exeName = QFileInfo(QString::fromWCharArray(buf)).fileName();
-        }
-        CloseHandle(hProc);
-    }
-    
-    Logger::log(QString("Target process: %1 (PID: %2)").arg(exeName).arg(targetPID));
-    
-    CComPtr<IMMDeviceCollection> devs;
-    HRESULT hr = enumerator_->EnumAudioEndpoints(eRender, DEVICE_STATE_ACTIVE, &devs);
-    if (FAILED(hr)) {
-        Logger::log(QString("Failed to enumerate audio endpoints. HRESULT: 0x%1").arg(hr, 0, 16));
-        return 0;
-    }
-    Logger::log("Audio endpoints enumerated successfully");
+int AudioMuter::decreaseVolumeByPID(quint32 targetPID, float stepPercent) {
+    LOG_DEBUG(Audio, QString("=== decreaseVolumeByPID called with target PID: %1, step: %2% ===").arg(targetPID).arg(stepPercent));
 
-    int total = 0;
-    UINT n;
-    devs->GetCount(&n);
-    Logger::log(QString("Found %1 active audio render devices").arg(n));
-    
-    for (UINT i = 0; i < n; ++i) {
-        CComPtr<IMMDevice> dev;
-        if (FAILED(devs->Item(i, &dev))) {
-            Logger::log(QString("Failed to get device %1").arg(i));
-            continue;
-        }
+    VolumeAdjustResult result = adjustVolumeByPID(targetPID, -stepPercent);
 
-        // Get device friendly name
-        QString deviceName = "(unknown)";
-        CComPtr<IPropertyStore> props;
-        if (SUCCEEDED(dev->OpenPropertyStore(STGM_READ, &props))) {
-            PROPVARIANT var; 
-            PropVariantInit(&var);
-            if (SUCCEEDED(props->GetValue(PKEY_Device_FriendlyName, &var))) {
-                deviceName = QString::fromWCharArray(var.pwszVal);
-            }
-            PropVariantClear(&var);
-        }
-        
-        Logger::log(QString("Scanning device %1: %2").arg(i).arg(deviceName));
-        
-        // Check if device is excluded
-        if (Config::instance().isDeviceExcluded(deviceName)) {
-            Logger::log(QString("Device %1 (%2) is excluded, skipping").arg(i).arg(deviceName));
-            continue;
-        }
-        
-        int deviceAdjusted = adjustVolumeOnDeviceByPID(dev, targetPID, -stepPercent);
-        total += deviceAdjusted;
-        Logger::log(QString("Device %1: %2 sessions adjusted").arg(i).arg(deviceAdjusted));
-    }
-    
-    Logger::log(QString("=== decreaseVolumeByPID completed: Total sessions adjusted for PID=%1: %2 ===")
+    LOG_DEBUG(Audio, QString("=== decreaseVolumeByPID completed: Total sessions adjusted for PID=%1: %2 ===")
                     .arg(targetPID)
-                    .arg(total)
+                    .arg(result.adjustedCount())
                 );
-    return total;
+    return result.adjustedCount();
 }
 
-float AudioMuter::adjustVolumeOnSession(ISimpleAudioVolume *vol, float stepPercent) {
-    if (!vol) {
-        return -1.0f;
-    }
-    
-    float currentVolume = 0.0f;
-    if (FAILED(vol->GetMasterVolume(&currentVolume))) {
-        return -1.0f;
-    }
-    
-    float stepFloat = stepPercent / 100.0f;
-    float newVolume = currentVolume + stepFloat;
-    
-    // Clamp to valid range [0.0, 1.0]
-    if (newVolume > 1.0f) {
-        newVolume = 1.0f;
-    } else if (newVolume < 0.0f) {
-        newVolume = 0.0f;
-    }
-    
-    if (SUCCEEDED(vol->SetMasterVolume(newVolume, nullptr))) {
-        Logger::log(QString("Successfully adjusted volume from %1 to %2").arg(currentVolume).arg(newVolume));
-        return newVolume;
-    }
-    
-    return -1.0f;
+VolumeAdjustResult AudioMuter::adjustVolumeByExeName(const QString& targetExeName, float stepPercent) {
+    AdjustVolumeAction adjust(stepPercent);
+    int matched = visitSessions(ExeMatcher{targetExeName}, adjust);
+    return makeAdjustResult(adjust, matched);
 }
 
-int AudioMuter::adjustVolumeOnDevice(IMMDevice *device, const QString& targetExeName, float stepPercent) {
-    Logger::log("=== adjustVolumeOnDevice called ===");
-    
-    CComPtr<IAudioSessionManager2> mgr2;
-    if (FAILED(device->Activate(__uuidof(IAudioSessionManager2),
-                                CLSCTX_ALL,
-                                nullptr,
-                                (void**)&mgr2))) {
-        Logger::log("Failed to activate IAudioSessionManager2");
-        return 0;
-    }
-    Logger::log("IAudioSessionManager2 activated successfully");
-    
-    CComPtr<IAudioSessionEnumerator> sessEnum;
-    if (FAILED(mgr2->GetSessionEnumerator(&sessEnum))) {
-        Logger::log("Failed to get session enumerator");
-        return 0;
-    }
-    Logger::log("Session enumerator obtained successfully");
-
-    int count = 0;
-    int n;
-    sessEnum->GetCount(&n);
-    Logger::log(QString("Total audio sessions on device: %1").arg(n));
-    
-    for (int i = 0; i < n; ++i) {
-        CComPtr<IAudioSessionControl> ctl;
-        if (FAILED(sessEnum->GetSession(i, &ctl))) {
-            Logger::log(QString("Failed to get session %1").arg(i));
-            continue;
-        }
+VolumeAdjustResult AudioMuter::adjustVolumeByPID(quint32 targetPID, float stepPercent) {
+    AdjustVolumeAction adjust(stepPercent);
+    int matched = visitSessions(PidMatcher{targetPID}, adjust);
+    return makeAdjustResult(adjust, matched);
+}
 
-        CComPtr<IAudioSessionControl2> ctl2;
-        if (FAILED(ctl->QueryInterface(__uuidof(IAudioSessionControl2), (void**)&ctl2))) {
-            Logger::log(QString("Failed to get IAudioSessionControl2 for session %1").arg(i));
-            continue;
-        }
+VolumeAdjustResult AudioMuter::adjustVolumeByFamily(quint32 rootPID, const QString& rootExeName, float stepPercent) {
+    AdjustVolumeAction adjust(stepPercent);
+    int matched = visitSessions(FamilyMatcher(rootPID, processFamily(rootPID, rootExeName)), adjust);
+    return makeAdjustResult(adjust, matched);
+}
 
-        DWORD pid = 0;
-        if (FAILED(ctl2->GetProcessId(&pid))) {
-            Logger::log(QString("Failed to get process ID for session %1").arg(i));
-            continue;
-        }
-        
-        // Get process name (reuse existing detection logic)
-        QString exeName = "(unknown)";
-        HANDLE hProc = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
-        if (hProc) {
-            WCHAR buf[MAX_PATH];
-            DWORD len = MAX_PATH;
-            if (QueryFullProcessImageNameW(hProc, 0, buf, &len)) {
-                exeName = QFileInfo(QString::fromWCharArray(buf)).fileName();
+QVector<BatchResult> AudioMuter::applyBatch(const QVector<BatchCommand>& commands) {
+    QVector<BatchResult> results(commands.size());
+    if (!backend_ || commands.isEmpty()) {
+        return results;
+    }
+    LOG_DEBUG(Audio, QString("=== applyBatch called with %1 commands ===").arg(commands.size()));
+
+    const std::shared_ptr<const ExclusionSet> exclusions = ExclusionSet::current();
+
+    if (sessionIndexReady()) {
+        // Each selector is a hash lookup; gather them per session so several
+        // commands on one session still run in command order
+        QVector<quint64> order;
+        QHash<quint64, AudioSessionEntry> sessions;
+        QHash<quint64, QVector<int>> commandsBySession;
+        for (int i = 0; i < commands.size(); ++i) {
+            const SessionSelector& selector = commands[i].selector;
+            const QVector<AudioSessionEntry> matches = selector.kind == SessionSelector::Kind::Pid
+                ? sessionIndex_.sessionsForPID(selector.pid)
+                : sessionIndex_.sessionsForExeName(selector.exeName);
+            for (const AudioSessionEntry& session : matches) {
+                if (!sessions.contains(session.sessionId)) {
+                    order.append(session.sessionId);
+                    sessions.insert(session.sessionId, session);
+                }
+                commandsBySession[session.sessionId].append(i);
             }
-            CloseHandle(hProc);
         }
-        
-        Logger::log(QString("Session %1: PID=%2, EXE=%3, Target EXE=%4").arg(i).arg(pid).arg(exeName, targetExeName));
-        
-        // Check if this process is in the exclusion list
-        QString processNameWithoutExt = exeName;
-        if (processNameWithoutExt.endsWith(".exe", Qt::CaseInsensitive)) {
-            processNameWithoutExt = processNameWithoutExt.left(processNameWithoutExt.length() - 4);
+        for (quint64 sessionId : std::as_const(order)) {
+            const AudioSessionEntry& session = sessions[sessionId];
+            if (isSessionExcluded(*exclusions, session)) {
+                continue;
+            }
+            for (int i : std::as_const(commandsBySession[sessionId])) {
+                ++results[i].matched;
+                applyBatchAction(commands[i].action, session, results[i]);
+            }
         }
-        
-        if (Config::instance().isProcessExcluded(processNameWithoutExt)) {
-            Logger::log(QString("Session %1: Process '%2' is in exclusion list, skipping").arg(i).arg(processNameWithoutExt));
-            continue;
+    } else {
+        // Selector -> command lookup tables, so each scanned session costs two hash probes
+        QHash<quint32, QVector<int>> byPid;
+        QHash<QString, QVector<int>> byExe;
+        for (int i = 0; i < commands.size(); ++i) {
+            const SessionSelector& selector = commands[i].selector;
+            if (selector.kind == SessionSelector::Kind::Pid) {
+                byPid[selector.pid].append(i);
+            } else {
+                byExe[ExclusionSet::normalizeProcessName(selector.exeName)].append(i);
+            }
         }
-        
-        if (exeName.compare(targetExeName, Qt::CaseInsensitive) != 0) {
-            Logger::log(QString("Session %1: Executable mismatch, skipping").arg(i));
-            continue;
+
+        QVector<int> matching;
+        const QVector<AudioDeviceInfo> devices = scanDevices();
+        for (const AudioDeviceInfo& device : devices) {
+            const QVector<AudioSessionEntry> sessions = scanSessions(device);
+            LOG_DEBUG(Audio, QString("Device %1: scanning %2 sessions for batch").arg(device.name).arg(sessions.size()));
+            for (const AudioSessionEntry& session : sessions) {
+                matching.clear();
+                auto pidIt = byPid.constFind(session.pid);
+                if (pidIt != byPid.constEnd()) {
+                    matching += pidIt.value();
+                }
+                auto exeIt = byExe.constFind(session.processKey);
+                if (exeIt != byExe.constEnd()) {
+                    matching += exeIt.value();
+                }
+                if (matching.isEmpty() || isProcessExcluded(*exclusions, session)) {
+                    continue;
+                }
+                std::sort(matching.begin(), matching.end());
+                for (int i : std::as_const(matching)) {
+                    ++results[i].matched;
+                    applyBatchAction(commands[i].action, session, results[i]);
+                }
+            }
         }
+    }
 
-        Logger::log(QString("Session %1: Executable match found! Adjusting volume...").arg(i));
+    for (int i = 0; i < commands.size(); ++i) {
+        LOG_DEBUG(Audio, QString("Batch command %1 (%2): %3 matched, %4 applied")
+                        .arg(i)
+                        .arg(commands[i].selector.describe())
+                        .arg(results[i].matched)
+                        .arg(results[i].applied));
+    }
+    return results;
+}
 
-        CComPtr<ISimpleAudioVolume> vol;
-        if (FAILED(ctl2->QueryInterface(__uuidof(ISimpleAudioVolume), (void**)&vol))) {
-            Logger::log(QString("Failed to get ISimpleAudioVolume for session %1").arg(i));
-            continue;
+void AudioMuter::applyBatchAction(const BatchAction& action, const AudioSessionEntry& session, BatchResult& result) {
+    switch (action.kind) {
+    case BatchAction::Kind::ToggleMute: {
+        ToggleMuteAction toggle;
+        toggle.apply(*backend_, session);
+        result.applied += toggle.toggled;
+        break;
+    }
+    case BatchAction::Kind::SetMute: {
+        LatencySpan span(LatencyStage::SetMute);
+        if (backend_->setMute(session.sessionId, action.mute)) {
+            ++result.applied;
+        } else {
+            LOG_WARNING(Audio, QString("Session %1: Failed to set mute for session pid=%2").arg(session.sessionId).arg(session.pid));
         }
-        
-        float newVolume = adjustVolumeOnSession(vol, stepPercent);
-        if (newVolume >= 0.0f) {
-            ++count;
-            Logger::log(QString("Session %1: Successfully adjusted volume for session pid=%2").arg(i).arg(pid));
+        break;
+    }
+    case BatchAction::Kind::SetVolume: {
+        LatencySpan span(LatencyStage::SetVolume);
+        const float volume = qBound(0.0f, action.value, 1.0f);
+        if (backend_->setVolume(session.sessionId, volume)) {
+            ++result.applied;
+            result.volumes.append(SessionVolume{session.sessionId, session.pid, volume});
         } else {
-            Logger::log(QString("Session %1: Failed to adjust volume for session pid=%2").arg(i).arg(pid));
+            LOG_WARNING(Audio, QString("Session %1: Failed to set volume for session pid=%2").arg(session.sessionId).arg(session.pid));
         }
+        break;
     }
-    
-    Logger::log(QString("adjustVolumeOnDevice completed: %1 sessions adjusted").arg(count));
-    return count;
-}
-
-int AudioMuter::adjustVolumeOnDeviceByPID(IMMDevice *device, DWORD targetPID, float stepPercent) {
-    Logger::log("=== adjustVolumeOnDeviceByPID called ===");
-    
-    CComPtr<IAudioSessionManager2> mgr2;
-    if (FAILED(device->Activate(__uuidof(IAudioSessionManager2),
-                                CLSCTX_ALL,
-                                nullptr,
-                                (void**)&mgr2))) {
-        Logger::log("Failed to activate IAudioSessionManager2");
-        return 0;
+    case BatchAction::Kind::AdjustVolume: {
+        AdjustVolumeAction adjust(action.value);
+        adjust.apply(*backend_, session);
+        result.applied += adjust.adjusted;
+        result.volumes += adjust.newVolumes;
+        break;
     }
-    Logger::log("IAudioSessionManager2 activated successfully");
-    
-    CComPtr<IAudioSessionEnumerator> sessEnum;
-    if (FAILED(mgr2->GetSessionEnumerator(&sessEnum))) {
-        Logger::log("Failed to get session enumerator");
-        return 0;
     }
-    Logger::log("Session enumerator obtained successfully");
-
-    int count = 0;
-    int n;
-    sessEnum->GetCount(&n);
-    Logger::log(QString("Total audio sessions on device: %1").arg(n));
-    
-    for (int i = 0; i < n; ++i) {
-        CComPtr<IAudioSessionControl> ctl;
-        if (FAILED(sessEnum->GetSession(i, &ctl))) {
-            Logger::log(QString("Failed to get session %1").arg(i));
-            continue;
-        }
-
-        CComPtr<IAudioSessionControl2> ctl2;
-        if (FAILED(ctl->QueryInterface(__uuidof(IAudioSessionControl2), (void**)&ctl2))) {
-            Logger::log(QString("Failed to get IAudioSessionControl2 for session %1").arg(i));
-            continue;
-        }
-
-        DWORD pid = 0;
-        if (FAILED(ctl2->GetProcessId(&pid))) {
-            Logger::log(QString("Failed to get process ID for session %1").arg(i));
-            continue;
-        }
-        
-        // Get process name (reuse existing detection logic)
-        QString exeName = "(unknown)";
-        HANDLE hProc = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
-        if (hProc) {
-            WCHAR buf[MAX_PATH];
-            DWORD len = MAX_PATH;
-            if (QueryFullProcessImageNameW(hProc, 0, buf, &len)) {
-                exeName = QFileInfo(QString::fromWCharArray(buf)).fileName();
-            }
-            CloseHandle(hProc);
-        }
-        
-        Logger::log(QString("Session %1: PID=%2, EXE=%3").arg(i).arg(pid).arg(exeName));
-        
-        // Check if this process is in the exclusion list
-        QString processNameWithoutExt = exeName;
-        if (processNameWithoutExt.endsWith(".exe", Qt::CaseInsensitive)) {
-            processNameWithoutExt = processNameWithoutExt.left(processNameWithoutExt.length() - 4);
-        }
-        
-        if (Config::instance().isProcessExcluded(processNameWithoutExt)) {
-            Logger::log(QString("Session %1: Process '%2' is in exclusion list, skipping").arg(i).arg(processNameWithoutExt));
-            continue;
-        }
-        
-        // Check if this PID matches our target PID
-        if (pid != targetPID) {
-            Logger::log(QString("Session %1: PID %2 not in target list, skipping").arg(i).arg(pid));
-            continue;
-        }
-
-        Logger::log(QString("Session %1: PID match found! Adjusting volume...").arg(i));
+}
 
-        CComPtr<ISimpleAudioVolume> vol;
-        if (FAILED(ctl2->QueryInterface(__uuidof(ISimpleAudioVolume), (void**)&vol))) {
-            Logger::log(QString("Failed to get ISimpleAudioVolume for session %1").arg(i));
-            continue;
-        }
-        
-        float newVolume = adjustVolumeOnSession(vol, stepPercent);
-        if (newVolume >= 0.0f) {
-            ++count;
-            Logger::log(QString("Session %1: Successfully adjusted volume for session pid=%2").arg(i).arg(pid));
-        } else {
-            Logger::log(QString("Session %1: Failed to adjust volume for session pid=%2").arg(i).arg(pid));
+VolumeAdjustResult AudioMuter::makeAdjustResult(const AdjustVolumeAction& adjust, int matched) {
+    VolumeAdjustResult result;
+    result.sessions = adjust.newVolumes;
+    result.matched = matched;
+    if (!result.sessions.isEmpty()) {
+        float totalVolume = 0.0f;
+        for (const SessionVolume& session : std::as_const(result.sessions)) {
+            totalVolume += session.volume;
         }
+        result.averageVolume = totalVolume / result.sessions.size();
     }
-    
-    Logger::log(QString("adjustVolumeOnDeviceByPID completed: %1 sessions adjusted").arg(count));
-    return count;
+    return result;
 }
 
 float AudioMuter::getVolumeByExeName(const QString& targetExeName) {
-    Logger::log(QString("=== getVolumeByExeName called with target EXE: %1 ===").arg(targetExeName));
-    
-    if (!enumerator_) {
-        Logger::log("Enumerator not initialized");
-        return -1.0f;
-    }
-    
-    CComPtr<IMMDeviceCollection> devices;
-    if (FAILED(enumerator_->EnumAudioEndpoints(eRender, DEVICE_STATE_ACTIVE, &devices))) {
-        Logger::log("Failed to enumerate audio endpoints");
-        return -1.0f;
-    }
-    
-    UINT count = 0;
-    devices->GetCount(&count);
-    Logger::log(QString("Found %1 active render devices").arg(count));
-    
-    float totalVolume = 0.0f;
-    int sessionCount = 0;
-    
-    for (UINT i = 0; i < count; ++i) {
-        CComPtr<IMMDevice> device;
-        if (FAILED(devices->Item(i, &device))) {
-            continue;
-        }
-        
-        CComPtr<IPropertyStore> props;
-        if (FAILED(device->OpenPropertyStore(STGM_READ, &props))) {
-            continue;
-        }
-        
-        PROPVARIANT nameVar;
-        PropVariantInit(&nameVar);
-        if (FAILED(props->GetValue(PKEY_Device_FriendlyName, &nameVar))) {
-            continue;
-        }
-        
-        QString deviceName = QString::fromWCharArray(nameVar.pwszVal);
-        PropVariantClear(&nameVar);
-        
-        if (Config::instance().isDeviceExcluded(deviceName)) {
-            Logger::log(QString("Device '%1' is excluded, skipping").arg(deviceName));
-            continue;
-        }
-        
-        CComPtr<IAudioSessionManager2> mgr2;
-        if (FAILED(device->Activate(__uuidof(IAudioSessionManager2), CLSCTX_ALL, nullptr, (void**)&mgr2))) {
-            continue;
-        }
-        
-        CComPtr<IAudioSessionEnumerator> sessEnum;
-        if (FAILED(mgr2->GetSessionEnumerator(&sessEnum))) {
-            continue;
-        }
-        
-        int n;
-        sessEnum->GetCount(&n);
-        
-        for (int j = 0; j < n; ++j) {
-            CComPtr<IAudioSessionControl> ctl;
-            if (FAILED(sessEnum->GetSession(j, &ctl))) {
-                continue;
-            }
-            
-            CComPtr<IAudioSessionControl2> ctl2;
-            if (FAILED(ctl->QueryInterface(__uuidof(IAudioSessionControl2), (void**)&ctl2))) {
-                continue;
-            }
-            
-            DWORD pid = 0;
-            if (FAILED(ctl2->GetProcessId(&pid))) {
-                continue;
-            }
-            
-            QString exeName = "(unknown)";
-            HANDLE hProc = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
-            if (hProc) {
-                WCHAR buf[MAX_PATH];
-                DWORD len = MAX_PATH;
-                if (QueryFullProcessImageNameW(hProc, 0, buf, &len)) {
-                    exeName = QFileInfo(QString::fromWCharArray(buf)).fileName();
-                }
-                CloseHandle(hProc);
-            }
-            
-            QString processNameWithoutExt = exeName;
-            if (processNameWithoutExt.endsWith(".exe", Qt::CaseInsensitive)) {
-                processNameWithoutExt = processNameWithoutExt.left(processNameWithoutExt.length() - 4);
-            }
-            
-            if (Config::instance().isProcessExcluded(processNameWithoutExt)) {
-                continue;
-            }
-            
-            if (exeName.compare(targetExeName, Qt::CaseInsensitive) != 0) {
-                continue;
-            }
-            
-            CComPtr<ISimpleAudioVolume> vol;
-            if (FAILED(ctl2->QueryInterface(__uuidof(ISimpleAudioVolume), (void**)&vol))) {
-                continue;
-            }
-            
-            float volume = 0.0f;
-            if (SUCCEEDED(vol->GetMasterVolume(&volume))) {
-                totalVolume += volume;
-                ++sessionCount;
-            }
-        }
-    }
-    
-    if (sessionCount > 0) {
-        float avgVolume = totalVolume / sessionCount;
-        Logger::log(QString("getVolumeByExeName completed: Average volume for %1 sessions = %2").arg(sessionCount).arg(avgVolume));
-        return avgVolume;
+    LOG_DEBUG(Audio, QString("=== getVolumeByExeName called with target EXE: %1 ===").arg(targetExeName));
+
+    ReadVolumeAction read;
+    visitSessions(ExeMatcher{targetExeName}, read);
+
+    if (read.sessionCount > 0) {
+        LOG_DEBUG(Audio, QString("getVolumeByExeName completed: Average volume for %1 sessions = %2").arg(read.sessionCount).arg(read.average()));
+    } else {
+        LOG_DEBUG(Audio, "getVolumeByExeName completed: No matching sessions found");
     }
-    
-    Logger::log("getVolumeByExeName completed: No matching sessions found");
-    return -1.0f;
+    return read.average();
 }
 
-float AudioMuter::getVolumeByPID(DWORD targetPID) {
-    Logger::log(QString("=== getVolumeByPID called with target PID: %1 ===").arg(targetPID));
-    
-    if (!enumerator_) {
-        Logger::log("Enumerator not initialized");
-        return -1.0f;
-    }
-    
-    CComPtr<IMMDeviceCollection> devices;
-    if (FAILED(enumerator_->EnumAudioEndpoints(eRender, DEVICE_STATE_ACTIVE, &devices))) {
-        Logger::log("Failed to enumerate audio endpoints");
-        return -1.0f;
-    }
-    
-    UINT count = 0;
-    devices->GetCount(&count);
-    Logger::log(QString("Found %1 active render devices").arg(count));
-    
-    float totalVolume = 0.0f;
-    int sessionCount = 0;
-    
-    for (UINT i = 0; i < count; ++i) {
-        CComPtr<IMMDevice> device;
-        if (FAILED(devices->Item(i, &device))) {
-            continue;
-        }
-        
-        CComPtr<IPropertyStore> props;
-        if (FAILED(device->OpenPropertyStore(STGM_READ, &props))) {
-            continue;
-        }
-        
-        PROPVARIANT nameVar;
-        PropVariantInit(&nameVar);
-        if (FAILED(props->GetValue(PKEY_Device_FriendlyName, &nameVar))) {
-            continue;
-        }
-        
-        QString deviceName = QString::fromWCharArray(nameVar.pwszVal);
-        PropVariantClear(&nameVar);
-        
-        if (Config::instance().isDeviceExcluded(deviceName)) {
-            Logger::log(QString("Device '%1' is excluded, skipping").arg(deviceName));
-            continue;
-        }
-        
-        CComPtr<IAudioSessionManager2> mgr2;
-        if (FAILED(device->Activate(__uuidof(IAudioSessionManager2), CLSCTX_ALL, nullptr, (void**)&mgr2))) {
-            continue;
-        }
-        
-        CComPtr<IAudioSessionEnumerator> sessEnum;
-        if (FAILED(mgr2->GetSessionEnumerator(&sessEnum))) {
-            continue;
-        }
-        
-        int n;
-        sessEnum->GetCount(&n);
-        
-        for (int j = 0; j < n; ++j) {
-            CComPtr<IAudioSessionControl> ctl;
-            if (FAILED(sessEnum->GetSession(j, &ctl))) {
-                continue;
-            }
-            
-            CComPtr<IAudioSessionControl2> ctl2;
-            if (FAILED(ctl->QueryInterface(__uuidof(IAudioSessionControl2), (void**)&ctl2))) {
-                continue;
-            }
-            
-            DWORD pid = 0;
-            if (FAILED(ctl2->GetProcessId(&pid))) {
-                continue;
-            }
-            
-            if (pid != targetPID) {
-                continue;
-            }
-            
-            QString exeName = "(unknown)";
-            HANDLE hProc = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
-            if (hProc) {
-                WCHAR buf[MAX_PATH];
-                DWORD len = MAX_PATH;
-                if (QueryFullProcessImageNameW(hProc, 0, buf, &len)) {
-                    exeName = QFileInfo(QString::fromWCharArray(buf)).fileName();
-                }
-                CloseHandle(hProc);
-            }
-            
-            QString processNameWithoutExt = exeName;
-            if (processNameWithoutExt.endsWith(".exe", Qt::CaseInsensitive)) {
-                processNameWithoutExt = processNameWithoutExt.left(processNameWithoutExt.length() - 4);
-            }
-            
-            if (Config::instance().isProcessExcluded(processNameWithoutExt)) {
-                continue;
-            }
-            
-            CComPtr<ISimpleAudioVolume> vol;
-            if (FAILED(ctl2->QueryInterface(__uuidof(ISimpleAudioVolume), (void**)&vol))) {
-                continue;
-            }
-            
-            float volume = 0.0f;
-            if (SUCCEEDED(vol->GetMasterVolume(&volume))) {
-                totalVolume += volume;
-                ++sessionCount;
-            }
-        }
-    }
-    
-    if (sessionCount > 0) {
-        float avgVolume = totalVolume / sessionCount;
-        Logger::log(QString("getVolumeByPID completed: Average volume for %1 sessions = %2").arg(sessionCount).arg(avgVolume));
-        return avgVolume;
+float AudioMuter::getVolumeByPID(quint32 targetPID) {
+    LOG_DEBUG(Audio, QString("=== getVolumeByPID called with target PID: %1 ===").arg(targetPID));
+
+    ReadVolumeAction read;
+    visitSessions(PidMatcher{targetPID}, read);
+
+    if (read.sessionCount > 0) {
+        LOG_DEBUG(Audio, QString("getVolumeByPID completed: Average volume for %1 sessions = %2").arg(read.sessionCount).arg(read.average()));
+    } else {
+        LOG_DEBUG(Audio, "getVolumeByPID completed: No matching sessions found");
     }
-    
-    Logger::log("getVolumeByPID completed: No matching sessions found");
-    return -1.0f;
-}
\ No newline at end of file
+    return read.average();
+}
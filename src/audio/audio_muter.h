@@ -1,69 +1,269 @@
 #pragma once
 #include "logger.h"
-#include <Windows.h>
-#include <mmdeviceapi.h>
-#include <audiopolicy.h>
-#include <string>
+#include "audio_backend.h"
+#include "audio_batch.h"
+#include "audio_session_index.h"
+#include "exclusion_set.h"
+#include "latency_stats.h"
+#include "process_tree.h"
+#include "session_visitor.h"
+#include <QElapsedTimer>
+#include <QSemaphore>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+#include <tuple>
+#include <vector>
 
+// Outcome of a volume adjustment, complete enough to drive the volume OSD
+// without reading the volumes back in a second pass
+struct VolumeAdjustResult {
+    QVector<SessionVolume> sessions;  // New volume of every adjusted session
+    int matched = 0;                  // Sessions selected after exclusions, adjusted or not
+    float averageVolume = -1.0f;      // Average of the new volumes, or -1.0 if nothing was adjusted
+
+    int adjustedCount() const { return sessions.size(); }
+};
+
+// Matching, exclusion and mute/volume logic. All platform access goes through
+// the AudioBackend, so this class builds and runs on any platform.
 class AudioMuter {
 public:
-    AudioMuter();
+    // How the scan path walks the devices when the session index is not live
+    enum class ScanMode {
+        Sequential,     // One device after another on the calling thread
+        Parallel        // One task per device on the scan pool, merged in device order
+    };
+
+    // `backend` is borrowed and must outlive this object
+    explicit AudioMuter(AudioBackend *backend);
     ~AudioMuter();
 
+    // threads: scan pool size for ScanMode::Parallel, clamped to [1, MAX_SCAN_THREADS]
+    void setScanMode(ScanMode mode, int threads);
+    ScanMode scanMode() const { return scanMode_; }
+    int scanThreads() const { return scanPool_.maxThreadCount(); }
+
+    static constexpr int MAX_SCAN_THREADS = 16;
+    static ScanMode scanModeFromString(const QString& mode);
+    static QString scanModeToString(ScanMode mode);
+
     // Toggle mute state for all sessions whose executable name matches targetExeName (case-insensitive)
     // Returns number of sessions toggled
     int toggleMuteByExeName(const QString& targetExeName);
-    
+
     // Toggle mute state for specific PID
     // Returns number of sessions toggled
-    int toggleMuteByPID(DWORD targetPID);
+    int toggleMuteByPID(quint32 targetPID);
+
+    // Toggle mute state for a process and every process it started (browser
+    // renderers, Electron helpers), without touching other instances of the
+    // same executable. A shell or launcher without sessions of its own
+    // (explorer.exe, Steam) started most of the desktop, so for those only
+    // the PID itself is tried. Returns number of sessions toggled
+    int toggleMuteByFamily(quint32 rootPID, const QString& rootExeName);
 
     // Increase volume for all sessions whose executable name matches targetExeName (case-insensitive)
     // stepPercent: volume step as percentage (e.g., 5.0 for 5%)
     // Returns number of sessions adjusted
     int increaseVolumeByExeName(const QString& targetExeName, float stepPercent);
-    
+
     // Decrease volume for all sessions whose executable name matches targetExeName (case-insensitive)
     // stepPercent: volume step as percentage (e.g., 5.0 for 5%)
     // Returns number of sessions adjusted
     int decreaseVolumeByExeName(const QString& targetExeName, float stepPercent);
-    
+
     // Increase volume for specific PID
     // stepPercent: volume step as percentage (e.g., 5.0 for 5%)
     // Returns number of sessions adjusted
-    int increaseVolumeByPID(DWORD targetPID, float stepPercent);
-    
+    int increaseVolumeByPID(quint32 targetPID, float stepPercent);
+
     // Decrease volume for specific PID
     // stepPercent: volume step as percentage (e.g., 5.0 for 5%)
     // Returns number of sessions adjusted
-    int decreaseVolumeByPID(DWORD targetPID, float stepPercent);
-    
+    int decreaseVolumeByPID(quint32 targetPID, float stepPercent);
+
+    // Adjust volume for all sessions whose executable name matches targetExeName (case-insensitive)
+    // and report the resulting volumes in the same pass
+    // stepPercent: volume step as percentage (positive for increase, negative for decrease)
+    VolumeAdjustResult adjustVolumeByExeName(const QString& targetExeName, float stepPercent);
+
+    // Adjust volume for specific PID and report the resulting volumes in the same pass
+    // stepPercent: volume step as percentage (positive for increase, negative for decrease)
+    VolumeAdjustResult adjustVolumeByPID(quint32 targetPID, float stepPercent);
+
+    // Adjust volume for a process and its descendants (see toggleMuteByFamily) and report the
+    // resulting volumes in the same pass
+    // stepPercent: volume step as percentage (positive for increase, negative for decrease)
+    VolumeAdjustResult adjustVolumeByFamily(quint32 rootPID, const QString& rootExeName, float stepPercent);
+
     // Get current volume for process by executable name
     // Returns average volume (0.0-1.0) of all matching sessions, or -1.0 if not found
     float getVolumeByExeName(const QString& targetExeName);
-    
+
     // Get current volume for process by PID
     // Returns average volume (0.0-1.0) of all matching sessions, or -1.0 if not found
-    float getVolumeByPID(DWORD targetPID);
+    float getVolumeByPID(quint32 targetPID);
+
+    // Resolve every command against one pass over the sessions and apply them.
+    // A session selected by several commands gets their actions in command
+    // order. Cost grows with the session count, not commands x sessions.
+    // Returns one result per command, in command order.
+    QVector<BatchResult> applyBatch(const QVector<BatchCommand>& commands);
+
+    // Run every action on each non-excluded session selected by `matcher`, in a
+    // single pass over the session index (or over the devices when the index
+    // is not live). See session_visitor.h for matchers and actions.
+    // Returns number of sessions visited
+    template <typename Matcher, typename... Actions>
+    int visitSessions(const Matcher& matcher, Actions&... actions);
 
 private:
-    // Toggle all sessions on `device` matching targetExeName
-    int toggleOnDevice(IMMDevice *device, const QString& targetExeName);
-    
-    // Toggle all sessions on `device` matching targetPID
-    int toggleOnDeviceByPID(IMMDevice *device, DWORD targetPID);
-    
-    // Adjust volume on all sessions on `device` matching targetExeName
-    // stepPercent: volume step as percentage (positive for increase, negative for decrease)
-    int adjustVolumeOnDevice(IMMDevice *device, const QString& targetExeName, float stepPercent);
-    
-    // Adjust volume on all sessions on `device` matching targetPID
-    // stepPercent: volume step as percentage (positive for increase, negative for decrease)
-    int adjustVolumeOnDeviceByPID(IMMDevice *device, DWORD targetPID, float stepPercent);
-    
-    // Helper: Adjust volume on a single session
-    // Returns new volume (0.0-1.0) on success, -1.0 on failure
-    float adjustVolumeOnSession(ISimpleAudioVolume *vol, float stepPercent);
+    // Apply one batch action to one session, recording the outcome in `result`
+    void applyBatchAction(const BatchAction& action, const AudioSessionEntry& session, BatchResult& result);
+
+    // Fold an adjustment's per-session results into a VolumeAdjustResult
+    static VolumeAdjustResult makeAdjustResult(const AdjustVolumeAction& adjust, int matched);
+
+    // Active devices that are not excluded by the user
+    QVector<AudioDeviceInfo> scanDevices();
+    // Scan path: snapshot of one device's sessions
+    QVector<AudioSessionEntry> scanSessions(const AudioDeviceInfo& device);
+
+    // Scan path for one device: fetch its sessions and apply the actions to the matching ones
+    template <typename Matcher, typename... Actions>
+    int visitDevice(const AudioDeviceInfo& device, const ExclusionSet& exclusions, const Matcher& matcher, Actions&... actions);
+
+    // Scan path across the scan pool: every device gets forked actions, merged back in device order
+    template <typename Matcher, typename... Actions>
+    int visitDevicesParallel(const QVector<AudioDeviceInfo>& devices, const ExclusionSet& exclusions, const Matcher& matcher, Actions&... actions);
+
+    // Session index fast path: resync if devices changed, then report whether lookups can be trusted
+    bool sessionIndexReady();
+
+    // rootPID followed by its descendants, from the process tree. Lists the
+    // processes again only when the tree may be missing a family member.
+    // Just rootPID for a shell or launcher without sessions of its own.
+    QVector<quint32> processFamily(quint32 rootPID, const QString& rootExeName);
+    bool processTreeNeedsSync(quint32 rootPID) const;
+    // Shells and launchers that start most other processes; `exeName` may carry ".exe" and any case
+    static bool isShellOrLauncher(const QString& exeName);
+    // Whether the process has an audio session; a full scan when the index is not live
+    bool hasOwnSessions(quint32 pid);
+
+    // Process exclusion check for a session (device exclusions are checked per device)
+    bool isProcessExcluded(const ExclusionSet& exclusions, const AudioSessionEntry& session);
+
+    // Device and process exclusion checks for an indexed session
+    bool isSessionExcluded(const ExclusionSet& exclusions, const AudioSessionEntry& session);
+
+    AudioBackend *backend_;
+
+    // Live session index kept current by the backend's notifications.
+    // When notifications are unavailable every call falls back to a full scan.
+    bool indexStarted_;
+    AudioSessionIndex sessionIndex_;
 
-    IMMDeviceEnumerator *enumerator_;
+    ScanMode scanMode_;
+    QThreadPool scanPool_;
+
+    // Parent/child index for family matching, built on first use. A new
+    // listing is applied as a diff when a session shows up from a process
+    // the tree does not know, at most once per PROCESS_TREE_RESYNC_MS.
+    ProcessTree processTree_;
+    bool processTreeBuilt_;
+    QElapsedTimer processTreeSynced_;
+    static constexpr qint64 PROCESS_TREE_RESYNC_MS = 1000;
+    // Catches a PID reused by a process that never opened a session
+    static constexpr qint64 PROCESS_TREE_MAX_AGE_MS = 30000;
 };
+
+template <typename Matcher, typename... Actions>
+int AudioMuter::visitSessions(const Matcher& matcher, Actions&... actions) {
+    static_assert(sizeof...(Actions) > 0, "visitSessions needs at least one action");
+
+    int visited = 0;
+    if (!backend_) {
+        LOG_ERROR(Audio, "Audio backend is null!");
+        return visited;
+    }
+
+    // One snapshot per call: settings changes apply from the next hotkey press
+    const std::shared_ptr<const ExclusionSet> exclusions = ExclusionSet::current();
+
+    if (sessionIndexReady()) {
+        QVector<AudioSessionEntry> sessions;
+        {
+            LatencySpan span(LatencyStage::SessionLookup);
+            sessions = matcher.lookup(sessionIndex_);
+        }
+        LOG_DEBUG(Audio, QString("Session index lookup for %1: %2 candidate sessions").arg(matcher.describe()).arg(sessions.size()));
+        for (const AudioSessionEntry& session : sessions) {
+            if (isSessionExcluded(*exclusions, session)) {
+                continue;
+            }
+            ++visited;
+            (actions.apply(*backend_, session), ...);
+        }
+        return visited;
+    }
+
+    const QVector<AudioDeviceInfo> devices = scanDevices();
+    if (scanMode_ == ScanMode::Parallel && devices.size() > 1) {
+        return visitDevicesParallel(devices, *exclusions, matcher, actions...);
+    }
+    for (const AudioDeviceInfo& device : devices) {
+        visited += visitDevice(device, *exclusions, matcher, actions...);
+    }
+    return visited;
+}
+
+template <typename Matcher, typename... Actions>
+int AudioMuter::visitDevice(const AudioDeviceInfo& device, const ExclusionSet& exclusions, const Matcher& matcher, Actions&... actions) {
+    int visited = 0;
+    const QVector<AudioSessionEntry> sessions = scanSessions(device);
+    LOG_DEBUG(Audio, QString("Device %1: scanning %2 sessions for %3").arg(device.name).arg(sessions.size()).arg(matcher.describe()));
+    for (const AudioSessionEntry& session : sessions) {
+        if (!matcher.matches(session) || isProcessExcluded(exclusions, session)) {
+            continue;
+        }
+        ++visited;
+        (actions.apply(*backend_, session), ...);
+    }
+    return visited;
+}
+
+template <typename Matcher, typename... Actions>
+int AudioMuter::visitDevicesParallel(const QVector<AudioDeviceInfo>& devices, const ExclusionSet& exclusions, const Matcher& matcher, Actions&... actions) {
+    struct DeviceResult {
+        std::tuple<Actions...> actions;
+        int visited = 0;
+    };
+
+    std::vector<DeviceResult> results;
+    results.reserve(devices.size());
+    for (int i = 0; i < devices.size(); ++i) {
+        results.push_back(DeviceResult{std::make_tuple(actions.fork()...)});
+    }
+
+    QSemaphore done;
+    for (int i = 0; i < devices.size(); ++i) {
+        DeviceResult *result = &results[i];
+        const AudioDeviceInfo *device = &devices[i];
+        scanPool_.start([this, result, device, &exclusions, &matcher, &done] {
+            result->visited = std::apply([&](auto&... forked) {
+                return visitDevice(*device, exclusions, matcher, forked...);
+            }, result->actions);
+            done.release();
+        });
+    }
+    done.acquire(devices.size());
+
+    // Merge in device order so results do not depend on which device finished first
+    int visited = 0;
+    for (DeviceResult& result : results) {
+        visited += result.visited;
+        std::apply([&](auto&... forked) { (actions.merge(forked), ...); }, result.actions);
+    }
+    return visited;
+}
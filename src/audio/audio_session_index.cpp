@@ -0,0 +1,103 @@
+#include "audio_session_index.h"
+#include "exclusion_set.h"
+#include <QReadLocker>
+#include <QWriteLocker>
+
+AudioSessionIndex::AudioSessionIndex() : live_(false) {
+}
+
+void AudioSessionIndex::sessionAdded(const AudioSessionEntry& entry) {
+    QWriteLocker lk(&lock_);
+    // A session can be reported twice (creation notification racing an enumeration)
+    removeLocked(entry.sessionId);
+    sessions_.insert(entry.sessionId, entry);
+    byPID_.insert(entry.pid, entry.sessionId);
+    byExe_.insert(entry.processKey, entry.sessionId);
+    byDevice_.insert(entry.deviceId, entry.sessionId);
+}
+
+void AudioSessionIndex::sessionRemoved(quint64 sessionId) {
+    QWriteLocker lk(&lock_);
+    removeLocked(sessionId);
+}
+
+void AudioSessionIndex::deviceRemoved(const QString& deviceId) {
+    QWriteLocker lk(&lock_);
+    const QList<quint64> ids = byDevice_.values(deviceId);
+    for (quint64 id : ids) {
+        removeLocked(id);
+    }
+}
+
+void AudioSessionIndex::invalidated() {
+    QWriteLocker lk(&lock_);
+    live_ = false;
+    sessions_.clear();
+    byPID_.clear();
+    byExe_.clear();
+    byDevice_.clear();
+}
+
+void AudioSessionIndex::synced() {
+    QWriteLocker lk(&lock_);
+    live_ = true;
+}
+
+bool AudioSessionIndex::isLive() const {
+    QReadLocker lk(&lock_);
+    return live_;
+}
+
+QVector<AudioSessionEntry> AudioSessionIndex::sessionsForPID(quint32 pid) const {
+    QReadLocker lk(&lock_);
+    return collectLocked(byPID_.values(pid));
+}
+
+QVector<AudioSessionEntry> AudioSessionIndex::sessionsForExeName(const QString& exeName) const {
+    const QString key = ExclusionSet::normalizeProcessName(exeName);
+    QReadLocker lk(&lock_);
+    return collectLocked(byExe_.values(key));
+}
+
+QVector<AudioSessionEntry> AudioSessionIndex::sessionsForDevice(const QString& deviceId) const {
+    QReadLocker lk(&lock_);
+    return collectLocked(byDevice_.values(deviceId));
+}
+
+QVector<quint32> AudioSessionIndex::pids() const {
+    QReadLocker lk(&lock_);
+    const QList<quint32> keys = byPID_.uniqueKeys();
+    return QVector<quint32>(keys.begin(), keys.end());
+}
+
+int AudioSessionIndex::sessionCount() const {
+    QReadLocker lk(&lock_);
+    return sessions_.size();
+}
+
+void AudioSessionIndex::clear() {
+    invalidated();
+}
+
+void AudioSessionIndex::removeLocked(quint64 sessionId) {
+    auto it = sessions_.find(sessionId);
+    if (it == sessions_.end()) {
+        return;
+    }
+    byPID_.remove(it->pid, sessionId);
+    byExe_.remove(it->processKey, sessionId);
+    byDevice_.remove(it->deviceId, sessionId);
+    sessions_.erase(it);
+}
+
+QVector<AudioSessionEntry> AudioSessionIndex::collectLocked(const QList<quint64>& ids) const {
+    QVector<AudioSessionEntry> result;
+    result.reserve(ids.size());
+    for (quint64 id : ids) {
+        auto it = sessions_.constFind(id);
+        if (it != sessions_.constEnd()) {
+            result.append(*it);
+        }
+    }
+    return result;
+}
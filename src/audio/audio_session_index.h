@@ -0,0 +1,46 @@
+#pragma once
+#include "audio_backend.h"
+#include <QString>
+#include <QHash>
+#include <QMultiHash>
+#include <QVector>
+#include <QReadWriteLock>
+
+// Live index of audio sessions keyed by PID, executable name and device.
+// Fed by an AudioBackend; safe to update from notification threads
+// while lookups run on the caller's thread.
+class AudioSessionIndex : public AudioBackend::Listener {
+public:
+    AudioSessionIndex();
+
+    void sessionAdded(const AudioSessionEntry& entry) override;
+    void sessionRemoved(quint64 sessionId) override;
+    void deviceRemoved(const QString& deviceId) override;
+    void invalidated() override;
+    void synced() override;
+
+    // True once the backend has reported a complete set and nothing invalidated it since
+    bool isLive() const;
+
+    QVector<AudioSessionEntry> sessionsForPID(quint32 pid) const;
+    // Match on ExclusionSet::normalizeProcessName() of the executable name,
+    // the same key the scan path compares
+    QVector<AudioSessionEntry> sessionsForExeName(const QString& exeName) const;
+    QVector<AudioSessionEntry> sessionsForDevice(const QString& deviceId) const;
+    // Every PID with at least one session
+    QVector<quint32> pids() const;
+
+    int sessionCount() const;
+    void clear();
+
+private:
+    void removeLocked(quint64 sessionId);
+    QVector<AudioSessionEntry> collectLocked(const QList<quint64>& ids) const;
+
+    mutable QReadWriteLock lock_;
+    QHash<quint64, AudioSessionEntry> sessions_;
+    QMultiHash<quint32, quint64> byPID_;
+    QMultiHash<QString, quint64> byExe_;
+    QMultiHash<QString, quint64> byDevice_;
+    bool live_;
+};
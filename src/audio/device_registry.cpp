@@ -0,0 +1,177 @@
+#include "device_registry.h"
+#include "logger.h"
+#include "trace_recorder.h"
+#include <functiondiscoverykeys_devpkey.h>
+#include <QMutexLocker>
+#include <utility>
+
+static QString readDeviceId(IMMDevice *device) {
+    QString id;
+    LPWSTR raw = nullptr;
+    if (SUCCEEDED(device->GetId(&raw))) {
+        id = QString::fromWCharArray(raw);
+        CoTaskMemFree(raw);
+    }
+    return id;
+}
+
+static QString readDeviceName(IMMDevice *device) {
+    QString deviceName = "(unknown)";
+    CComPtr<IPropertyStore> props;
+    if (SUCCEEDED(device->OpenPropertyStore(STGM_READ, &props))) {
+        PROPVARIANT var;
+        PropVariantInit(&var);
+        if (SUCCEEDED(props->GetValue(PKEY_Device_FriendlyName, &var))) {
+            deviceName = QString::fromWCharArray(var.pwszVal);
+        }
+        PropVariantClear(&var);
+    }
+    return deviceName;
+}
+
+DeviceRegistry::DeviceRegistry(IMMDeviceEnumerator *enumerator)
+    : enumerator_(enumerator), tracking_(false), stale_(true) {
+}
+
+DeviceRegistry::~DeviceRegistry() {
+    clear();
+}
+
+QVector<AudioDeviceInfo> DeviceRegistry::devices() {
+    refreshIfNeeded();
+
+    const std::shared_ptr<const ExclusionSet> exclusions = ExclusionSet::current();
+    QVector<AudioDeviceInfo> result;
+    QMutexLocker lk(&mutex_);
+    if (exclusions_ != exclusions) {
+        excluded_.clear();
+        for (const QString& id : std::as_const(order_)) {
+            excluded_.insert(id, exclusions->isDeviceExcluded(id, endpoints_.value(id).name));
+        }
+        exclusions_ = exclusions;
+    }
+
+    result.reserve(order_.size());
+    for (const QString& id : std::as_const(order_)) {
+        AudioDeviceInfo info;
+        info.id = id;
+        info.name = endpoints_.value(id).name;
+        info.excluded = excluded_.value(id);
+        result.append(info);
+    }
+    return result;
+}
+
+QVector<DeviceRegistry::Endpoint> DeviceRegistry::endpoints() {
+    refreshIfNeeded();
+
+    QVector<Endpoint> result;
+    QMutexLocker lk(&mutex_);
+    result.reserve(order_.size());
+    for (const QString& id : std::as_const(order_)) {
+        result.append(endpoints_.value(id));
+    }
+    return result;
+}
+
+bool DeviceRegistry::endpoint(const QString& deviceId, Endpoint* endpoint) {
+    refreshIfNeeded();
+
+    QMutexLocker lk(&mutex_);
+    auto it = endpoints_.constFind(deviceId);
+    if (it == endpoints_.constEnd()) {
+        return false;
+    }
+    *endpoint = it.value();
+    return true;
+}
+
+void DeviceRegistry::setTracking(bool tracking) {
+    tracking_ = tracking;
+    // Changes may have gone unseen while untracked
+    stale_ = true;
+}
+
+void DeviceRegistry::invalidate() {
+    stale_ = true;
+}
+
+void DeviceRegistry::clear() {
+    QMutexLocker refreshLock(&refreshMutex_);
+    QHash<QString, Endpoint> endpoints;
+    {
+        QMutexLocker lk(&mutex_);
+        endpoints.swap(endpoints_);
+        order_.clear();
+        excluded_.clear();
+        exclusions_.reset();
+    }
+    stale_ = true;
+}
+
+void DeviceRegistry::refreshIfNeeded() {
+    if (!enumerator_ || (tracking_ && !stale_)) {
+        return;
+    }
+
+    QMutexLocker refreshLock(&refreshMutex_);
+    // Another thread may have refreshed while we waited
+    if (tracking_ && !stale_) {
+        return;
+    }
+    TraceSpan span("DeviceRegistry::refresh", "audio");
+
+    // An untracked refresh keeps the managers of endpoints it already knows.
+    // After a notification every manager is re-activated, since the endpoint
+    // behind an ID may have been disabled and re-enabled in between.
+    const bool reuseManagers = !stale_.exchange(false);
+    QHash<QString, CComPtr<IAudioSessionManager2>> known;
+    if (reuseManagers) {
+        QMutexLocker lk(&mutex_);
+        for (auto it = endpoints_.constBegin(); it != endpoints_.constEnd(); ++it) {
+            known.insert(it.key(), it->manager);
+        }
+    }
+
+    CComPtr<IMMDeviceCollection> devs;
+    HRESULT hr = enumerator_->EnumAudioEndpoints(eRender, DEVICE_STATE_ACTIVE, &devs);
+    if (FAILED(hr)) {
+        LOG_WARNING(Audio, QString("Failed to enumerate audio endpoints. HRESULT: 0x%1").arg(hr, 0, 16));
+        stale_ = true;
+        return;
+    }
+
+    UINT n = 0;
+    devs->GetCount(&n);
+    QHash<QString, Endpoint> fresh;
+    QStringList order;
+    for (UINT i = 0; i < n; ++i) {
+        CComPtr<IMMDevice> dev;
+        if (FAILED(devs->Item(i, &dev))) {
+            LOG_WARNING(Audio, QString("Failed to get device %1").arg(i));
+            continue;
+        }
+        Endpoint endpoint;
+        endpoint.id = readDeviceId(dev);
+        endpoint.name = readDeviceName(dev);
+        endpoint.manager = known.value(endpoint.id);
+        if (!endpoint.manager
+            && FAILED(dev->Activate(__uuidof(IAudioSessionManager2), CLSCTX_ALL, nullptr, (void**)&endpoint.manager))) {
+            LOG_WARNING(Audio, QString("Failed to activate IAudioSessionManager2 for device %1").arg(endpoint.name));
+        }
+        order.append(endpoint.id);
+        fresh.insert(endpoint.id, endpoint);
+    }
+    known.clear();
+
+    // The previous endpoints are released after the lock is dropped
+    QHash<QString, Endpoint> previous;
+    {
+        QMutexLocker lk(&mutex_);
+        previous.swap(endpoints_);
+        endpoints_.swap(fresh);
+        order_ = order;
+        exclusions_.reset();
+    }
+    LOG_DEBUG(Audio, QString("Device registry refreshed: %1 active render devices").arg(order.size()));
+}
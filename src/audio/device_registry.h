@@ -0,0 +1,58 @@
+#pragma once
+#include "audio_backend.h"
+#include "exclusion_set.h"
+#include <Windows.h>
+#include <mmdeviceapi.h>
+#include <audiopolicy.h>
+#include <atlbase.h>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+// Active render endpoints keyed by endpoint ID, caching the friendly name,
+// exclusion status and activated session manager of each. While endpoint
+// notifications are tracked the cache is trusted until invalidate(); without
+// them every listing re-enumerates, reusing the managers of known endpoints.
+class DeviceRegistry {
+public:
+    struct Endpoint {
+        QString id;
+        QString name;
+        CComPtr<IAudioSessionManager2> manager;  // Null if activation failed
+    };
+
+    explicit DeviceRegistry(IMMDeviceEnumerator *enumerator);
+    ~DeviceRegistry();
+
+    // Active endpoints in enumeration order, with exclusion status against the current ExclusionSet
+    QVector<AudioDeviceInfo> devices();
+    QVector<Endpoint> endpoints();
+    bool endpoint(const QString& deviceId, Endpoint* endpoint);
+
+    void setTracking(bool tracking);
+    // Safe to call from notification callbacks: only flags the cache
+    void invalidate();
+    // Release every cached COM pointer
+    void clear();
+
+private:
+    void refreshIfNeeded();
+
+    IMMDeviceEnumerator *enumerator_;
+    std::atomic<bool> tracking_;
+    std::atomic<bool> stale_;
+
+    // Serializes refreshes, which call into COM; never taken by notification callbacks
+    QMutex refreshMutex_;
+
+    // Guards everything below
+    QMutex mutex_;
+    QHash<QString, Endpoint> endpoints_;
+    QStringList order_;
+    QHash<QString, bool> excluded_;
+    // Snapshot excluded_ was computed against
+    std::shared_ptr<const ExclusionSet> exclusions_;
+};
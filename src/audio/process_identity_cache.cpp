@@ -0,0 +1,112 @@
+#include "process_identity_cache.h"
+#include "exclusion_set.h"
+#include "latency_stats.h"
+#include <QDateTime>
+#include <QMutexLocker>
+#include <utility>
+
+ProcessIdentityCache::ProcessIdentityCache(std::unique_ptr<ProcessProbe> probe)
+    : probe_(std::move(probe)), hits_(0), misses_(0) {
+}
+
+ProcessIdentityCache::~ProcessIdentityCache() {
+    // Watch callbacks call back into this object; make sure none are left
+    probe_->cancelAllWatches();
+}
+
+ProcessIdentity ProcessIdentityCache::lookup(quint32 pid) {
+    LatencySpan span(LatencyStage::ProcessResolve);
+    ProcessIdentity candidate;
+    bool needsValidation = false;
+    {
+        QMutexLocker lk(&mutex_);
+        auto it = entries_.constFind(pid);
+        if (it != entries_.constEnd()) {
+            if (isFresh(*it)) {
+                ++hits_;
+                return it->identity;
+            }
+            if (it->identity.valid) {
+                candidate = it->identity;
+                needsValidation = true;
+            }
+        }
+    }
+
+    // Entry without an exit watch: one cheap start-time check instead of a full resolve
+    if (needsValidation && probe_->isSameProcess(pid, candidate.creationTime)) {
+        ++hits_;
+        return candidate;
+    }
+
+    ++misses_;
+    Entry entry;
+    entry.identity.pid = pid;
+    entry.identity.baseName = "(unknown)";
+    if (probe_->resolve(pid, &entry.identity)) {
+        entry.identity.valid = true;
+        const int slash = qMax(entry.identity.imagePath.lastIndexOf('\\'), entry.identity.imagePath.lastIndexOf('/'));
+        entry.identity.baseName = entry.identity.imagePath.mid(slash + 1);
+    } else {
+        entry.failedAtMs = QDateTime::currentMSecsSinceEpoch();
+    }
+    // Also for "(unknown)", so a session's processKey always matches its exeName
+    entry.identity.normalizedName = ExclusionSet::normalizeProcessName(entry.identity.baseName);
+
+    {
+        QMutexLocker lk(&mutex_);
+        if (entries_.size() >= MAX_ENTRIES) {
+            evictUnwatchedLocked();
+        }
+        entries_.insert(pid, entry);
+    }
+
+    // Registered after the insert so an exit that races the registration
+    // still finds (and drops) the entry
+    if (entry.identity.valid && probe_->watchExit(pid, entry.identity.creationTime, this)) {
+        QMutexLocker lk(&mutex_);
+        auto it = entries_.find(pid);
+        if (it != entries_.end() && it->identity.creationTime == entry.identity.creationTime) {
+            it->watched = true;
+        }
+    }
+    return entry.identity;
+}
+
+void ProcessIdentityCache::processExited(quint32 pid, quint64 creationTime) {
+    QMutexLocker lk(&mutex_);
+    auto it = entries_.find(pid);
+    if (it != entries_.end() && it->identity.creationTime == creationTime) {
+        entries_.erase(it);
+    }
+}
+
+void ProcessIdentityCache::clear() {
+    QMutexLocker lk(&mutex_);
+    entries_.clear();
+}
+
+int ProcessIdentityCache::size() const {
+    QMutexLocker lk(&mutex_);
+    return entries_.size();
+}
+
+void ProcessIdentityCache::evictUnwatchedLocked() {
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it->watched) {
+            ++it;
+        } else {
+            it = entries_.erase(it);
+        }
+    }
+}
+
+bool ProcessIdentityCache::isFresh(const Entry& entry) const {
+    if (entry.watched) {
+        return true;
+    }
+    if (!entry.identity.valid) {
+        return QDateTime::currentMSecsSinceEpoch() - entry.failedAtMs < NEGATIVE_TTL_MS;
+    }
+    return false;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+#include <memory>
+
+class ProcessIdentityCache;
+
+// What we know about a running process
+struct ProcessIdentity {
+    quint32 pid = 0;
+    quint64 creationTime = 0;   // Platform start-time stamp; (pid, creationTime) is unique
+    QString imagePath;          // Full image path
+    QString baseName;           // File name, e.g. "Chrome.exe", or "(unknown)"
+    QString normalizedName;     // ExclusionSet::normalizeProcessName(baseName), e.g. "chrome"
+    bool valid = false;         // False when the process could not be queried
+};
+
+// Platform access used by ProcessIdentityCache
+class ProcessProbe {
+public:
+    virtual ~ProcessProbe() = default;
+
+    // Full (expensive) resolution. Fills pid, creationTime and imagePath.
+    virtual bool resolve(quint32 pid, ProcessIdentity* identity) = 0;
+
+    // Cheap check that `pid` still names the process started at `creationTime`
+    virtual bool isSameProcess(quint32 pid, quint64 creationTime) = 0;
+
+    // Call cache->processExited(pid, creationTime) once that process exits.
+    // Returns false when exit notifications are unavailable; the cache then
+    // validates the entry with isSameProcess() on every hit instead.
+    virtual bool watchExit(quint32 pid, quint64 creationTime, ProcessIdentityCache* cache) = 0;
+
+    // Cancel all watches and wait for in-flight notifications to finish
+    virtual void cancelAllWatches() = 0;
+};
+
+// PID -> process identity cache keyed by (PID, creation time). Entries are
+// dropped when their process exits, so a hit needs no system call and a
+// reused PID is never served the previous owner's name. Thread-safe.
+class ProcessIdentityCache {
+public:
+    explicit ProcessIdentityCache(std::unique_ptr<ProcessProbe> probe);
+    ~ProcessIdentityCache();
+
+    // Identity of the process currently running as `pid`. Resolved on first
+    // use and served from the cache until the process exits.
+    ProcessIdentity lookup(quint32 pid);
+
+    // Exit notification from the probe
+    void processExited(quint32 pid, quint64 creationTime);
+
+    void clear();
+    int size() const;
+    quint64 hits() const { return hits_; }
+    quint64 misses() const { return misses_; }
+
+private:
+    struct Entry {
+        ProcessIdentity identity;
+        bool watched = false;       // Exit notification registered
+        qint64 failedAtMs = 0;      // For negative entries: when resolution failed
+    };
+
+    // Failed resolutions (protected processes, PID 0) are retried after this long
+    static const qint64 NEGATIVE_TTL_MS = 5000;
+    // Watched entries leave when their process exits, but unwatched and
+    // negative ones could pile up; past this size those are dropped
+    static const int MAX_ENTRIES = 4096;
+
+    bool isFresh(const Entry& entry) const;
+    // Drops every entry without an exit watch. Watched entries stay, as
+    // their processes are alive and their watches still point at them.
+    void evictUnwatchedLocked();
+
+    std::unique_ptr<ProcessProbe> probe_;
+    mutable QMutex mutex_;
+    QHash<quint32, Entry> entries_;
+    std::atomic<quint64> hits_;
+    std::atomic<quint64> misses_;
+};
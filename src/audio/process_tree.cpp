@@ -0,0 +1,148 @@
+#include "process_tree.h"
+
+void ProcessTree::reset(const QVector<ProcessTreeEntry>& processes) {
+    clear();
+    sync(processes);
+}
+
+int ProcessTree::sync(const QVector<ProcessTreeEntry>& processes) {
+    QHash<quint32, ProcessTreeEntry> listed;
+    listed.reserve(processes.size());
+    for (const ProcessTreeEntry& process : processes) {
+        listed.insert(process.pid, process);
+    }
+
+    // Gone, or the PID now belongs to another process
+    QVector<quint32> exited;
+    for (auto it = nodes_.constBegin(); it != nodes_.constEnd(); ++it) {
+        auto now = listed.constFind(it.key());
+        if (now == listed.constEnd() || now->creationTime != it->process.creationTime) {
+            exited.append(it.key());
+        }
+    }
+    for (quint32 pid : exited) {
+        processExited(pid);
+    }
+
+    // Insert every new process before linking any, so a child listed ahead
+    // of its parent still finds it
+    QVector<quint32> started;
+    for (const ProcessTreeEntry& process : processes) {
+        if (!nodes_.contains(process.pid)) {
+            insert(process);
+            started.append(process.pid);
+        }
+    }
+    for (quint32 pid : started) {
+        link(pid);
+    }
+    return exited.size() + started.size();
+}
+
+void ProcessTree::processStarted(const ProcessTreeEntry& process) {
+    auto existing = nodes_.constFind(process.pid);
+    if (existing != nodes_.constEnd()) {
+        if (existing->process.creationTime == process.creationTime && existing->process.parentPid == process.parentPid) {
+            return;
+        }
+        // The exit went unseen and the PID was reused
+        processExited(process.pid);
+    }
+    // A process that just started has no children yet, so only its own parent link is needed
+    insert(process);
+    link(process.pid);
+}
+
+void ProcessTree::processExited(quint32 pid) {
+    auto it = nodes_.find(pid);
+    if (it == nodes_.end()) {
+        return;
+    }
+    if (it->parent != 0) {
+        children_.remove(it->parent, pid);
+    }
+    nodes_.erase(it);
+
+    // Orphan the children: a later process with this PID is not their parent
+    const QList<quint32> orphans = children_.values(pid);
+    children_.remove(pid);
+    for (quint32 child : orphans) {
+        auto node = nodes_.find(child);
+        if (node != nodes_.end()) {
+            node->parent = 0;
+        }
+    }
+}
+
+void ProcessTree::clear() {
+    nodes_.clear();
+    children_.clear();
+}
+
+quint32 ProcessTree::parentOf(quint32 pid) const {
+    auto it = nodes_.constFind(pid);
+    return it == nodes_.constEnd() ? 0 : it->parent;
+}
+
+bool ProcessTree::isInFamily(quint32 pid, quint32 rootPid) const {
+    // link() never closes a loop, so this ends; the bound is only a guard
+    for (int hops = 0; hops <= nodes_.size(); ++hops) {
+        if (pid == rootPid) {
+            return true;
+        }
+        pid = parentOf(pid);
+        if (pid == 0) {
+            return false;
+        }
+    }
+    return false;
+}
+
+QVector<quint32> ProcessTree::family(quint32 rootPid) const {
+    QVector<quint32> members;
+    members.append(rootPid);
+    if (!nodes_.contains(rootPid)) {
+        return members;
+    }
+    for (int i = 0; i < members.size() && members.size() <= nodes_.size(); ++i) {
+        const quint32 parent = members[i];
+        for (auto it = children_.constFind(parent); it != children_.constEnd() && it.key() == parent; ++it) {
+            members.append(it.value());
+        }
+    }
+    return members;
+}
+
+void ProcessTree::insert(const ProcessTreeEntry& process) {
+    Node node;
+    node.process = process;
+    nodes_.insert(process.pid, node);
+}
+
+void ProcessTree::link(quint32 pid) {
+    auto it = nodes_.find(pid);
+    if (it == nodes_.end()) {
+        return;
+    }
+    const ProcessTreeEntry& process = it->process;
+    const quint32 parentPid = process.parentPid;
+    if (parentPid == 0 || parentPid == pid) {
+        return;
+    }
+    auto parent = nodes_.constFind(parentPid);
+    if (parent == nodes_.constEnd()) {
+        return;
+    }
+    // A parent younger than its child is a later process that reused the PID
+    const quint64 parentCreated = parent->process.creationTime;
+    if (parentCreated != 0 && process.creationTime != 0 && parentCreated > process.creationTime) {
+        return;
+    }
+    // Without creation times (OpenProcess failed) two processes can name
+    // each other as parent; the link that would close the loop is dropped
+    if (isInFamily(parentPid, pid)) {
+        return;
+    }
+    it->parent = parentPid;
+    children_.insert(parentPid, pid);
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <QHash>
+#include <QMultiHash>
+#include <QVector>
+#include <QtGlobal>
+
+// One running process as listed by the OS
+struct ProcessTreeEntry {
+    quint32 pid = 0;
+    quint32 parentPid = 0;      // As recorded at creation; that process may be gone
+    quint64 creationTime = 0;   // Same stamp as ProcessIdentity::creationTime; 0 when unknown
+};
+
+// Parent/child index over the running processes, for selecting a process
+// together with everything it started (a browser and its renderers). Built
+// once from a full listing, then kept current with single starts and exits
+// or by applying a later listing as a diff, so a lookup never needs a new
+// snapshot.
+//
+// A recorded parent PID is only trusted while that process is still alive
+// and did not start after the child; otherwise the parent exited and its
+// PID was reused. Children of an exited process stay orphans. A link that
+// would make a process its own ancestor is never made, so each family lists
+// a PID once. Not thread-safe; concurrent const calls are fine.
+class ProcessTree {
+public:
+    // Replace the index with a full listing
+    void reset(const QVector<ProcessTreeEntry>& processes);
+    // Bring the index in line with a newer full listing. Returns how many
+    // processes started or exited in between.
+    int sync(const QVector<ProcessTreeEntry>& processes);
+    void processStarted(const ProcessTreeEntry& process);
+    void processExited(quint32 pid);
+    void clear();
+
+    bool contains(quint32 pid) const { return nodes_.contains(pid); }
+    int size() const { return nodes_.size(); }
+    // Trusted parent, or 0
+    quint32 parentOf(quint32 pid) const;
+
+    // Whether `pid` is `rootPid` or descends from it
+    bool isInFamily(quint32 pid, quint32 rootPid) const;
+    // `rootPid` followed by its descendants, breadth-first. Just `rootPid`
+    // when it is not in the index.
+    QVector<quint32> family(quint32 rootPid) const;
+
+private:
+    struct Node {
+        ProcessTreeEntry process;
+        quint32 parent = 0;     // Trusted parent, or 0
+    };
+
+    void insert(const ProcessTreeEntry& process);
+    // Attach a node to its recorded parent if that parent can be trusted
+    void link(quint32 pid);
+
+    QHash<quint32, Node> nodes_;
+    QMultiHash<quint32, quint32> children_;
+};
@@ -0,0 +1,164 @@
+#pragma once
+#include "audio_backend.h"
+#include "audio_session_index.h"
+#include "exclusion_set.h"
+#include "latency_stats.h"
+#include "logger.h"
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+// Building blocks for AudioMuter::visitSessions(). A matcher selects sessions,
+// and every action passed alongside it runs on each selected session during
+// the same walk. Combining actions therefore costs one enumeration, not one
+// per action.
+//
+// Matcher: matches(entry) for the scan path, lookup(index) for the index path,
+//          describe() for logging.
+// Action:  apply(backend, entry). Actions run in argument order, so an action
+//          listed after an adjustment sees the adjusted state.
+//          fork() returns an empty action with the same parameters, and
+//          merge(other) folds a fork's results in. The parallel scan runs a
+//          fork per device and merges them back in device order.
+
+struct PidMatcher {
+    quint32 pid;
+
+    bool matches(const AudioSessionEntry& session) const { return session.pid == pid; }
+    QVector<AudioSessionEntry> lookup(const AudioSessionIndex& index) const { return index.sessionsForPID(pid); }
+    QString describe() const { return QString("PID=%1").arg(pid); }
+};
+
+// Compares normalized names, like the session index and the exclusions
+struct ExeMatcher {
+    explicit ExeMatcher(const QString& name) : exeName(name), key(ExclusionSet::normalizeProcessName(name)) {}
+
+    QString exeName;
+    QString key;
+
+    bool matches(const AudioSessionEntry& session) const { return session.processKey == key; }
+    QVector<AudioSessionEntry> lookup(const AudioSessionIndex& index) const { return index.sessionsForExeName(exeName); }
+    QString describe() const { return QString("exe=%1").arg(exeName); }
+};
+
+// A process and its descendants, as listed by ProcessTree::family()
+struct FamilyMatcher {
+    FamilyMatcher(quint32 root, const QVector<quint32>& family) : rootPid(root) {
+        // A PID listed twice would have its sessions looked up, and toggled, twice
+        for (quint32 pid : family) {
+            if (!memberSet.contains(pid)) {
+                memberSet.insert(pid);
+                members.append(pid);
+            }
+        }
+    }
+
+    quint32 rootPid;
+    QVector<quint32> members;   // Lookup order: the root first
+    QSet<quint32> memberSet;
+
+    bool matches(const AudioSessionEntry& session) const { return memberSet.contains(session.pid); }
+    QVector<AudioSessionEntry> lookup(const AudioSessionIndex& index) const {
+        QVector<AudioSessionEntry> sessions;
+        for (quint32 pid : members) {
+            sessions += index.sessionsForPID(pid);
+        }
+        return sessions;
+    }
+    QString describe() const { return QString("family of PID=%1 (%2 processes)").arg(rootPid).arg(members.size()); }
+};
+
+// Flip each session's mute state
+struct ToggleMuteAction {
+    int toggled = 0;
+
+    void apply(AudioBackend& backend, const AudioSessionEntry& session) {
+        LatencySpan span(LatencyStage::SetMute);
+        bool isMuted = false;
+        if (!backend.getMute(session.sessionId, &isMuted)) {
+            LOG_WARNING(Audio, QString("Session %1: Failed to get mute state for session pid=%2").arg(session.sessionId).arg(session.pid));
+            return;
+        }
+
+        bool newMuteState = !isMuted;
+        if (backend.setMute(session.sessionId, newMuteState)) {
+            ++toggled;
+            LOG_TRACE(Audio, QString("Session %1: Successfully toggled mute to %2 for session pid=%3").arg(session.sessionId).arg(newMuteState ? "Muted" : "Unmuted").arg(session.pid));
+        } else {
+            LOG_WARNING(Audio, QString("Session %1: Failed to toggle mute for session pid=%2").arg(session.sessionId).arg(session.pid));
+        }
+    }
+
+    ToggleMuteAction fork() const { return ToggleMuteAction(); }
+    void merge(const ToggleMuteAction& other) { toggled += other.toggled; }
+};
+
+// Volume of one session after an operation
+struct SessionVolume {
+    quint64 sessionId = 0;
+    quint32 pid = 0;
+    float volume = 0.0f;
+};
+
+// Move each session's volume by stepPercent (negative to decrease), clamped to [0.0, 1.0].
+// Records every new volume so callers can report it without reading it back.
+struct AdjustVolumeAction {
+    explicit AdjustVolumeAction(float step) : stepPercent(step) {}
+
+    float stepPercent;
+    int adjusted = 0;
+    QVector<SessionVolume> newVolumes;
+
+    void apply(AudioBackend& backend, const AudioSessionEntry& session) {
+        LatencySpan span(LatencyStage::SetVolume);
+        float currentVolume = 0.0f;
+        if (!backend.getVolume(session.sessionId, &currentVolume)) {
+            LOG_WARNING(Audio, QString("Session %1: Failed to get volume for session pid=%2").arg(session.sessionId).arg(session.pid));
+            return;
+        }
+
+        float newVolume = currentVolume + stepPercent / 100.0f;
+        if (newVolume > 1.0f) {
+            newVolume = 1.0f;
+        } else if (newVolume < 0.0f) {
+            newVolume = 0.0f;
+        }
+
+        if (backend.setVolume(session.sessionId, newVolume)) {
+            ++adjusted;
+            newVolumes.append(SessionVolume{session.sessionId, session.pid, newVolume});
+            LOG_TRACE(Audio, QString("Session %1: Adjusted volume from %2 to %3 for session pid=%4").arg(session.sessionId).arg(currentVolume).arg(newVolume).arg(session.pid));
+        } else {
+            LOG_WARNING(Audio, QString("Session %1: Failed to adjust volume for session pid=%2").arg(session.sessionId).arg(session.pid));
+        }
+    }
+
+    AdjustVolumeAction fork() const { return AdjustVolumeAction(stepPercent); }
+    void merge(const AdjustVolumeAction& other) {
+        adjusted += other.adjusted;
+        newVolumes += other.newVolumes;
+    }
+};
+
+// Accumulate session volumes
+struct ReadVolumeAction {
+    float totalVolume = 0.0f;
+    int sessionCount = 0;
+
+    void apply(AudioBackend& backend, const AudioSessionEntry& session) {
+        float volume = 0.0f;
+        if (backend.getVolume(session.sessionId, &volume)) {
+            totalVolume += volume;
+            ++sessionCount;
+        }
+    }
+
+    ReadVolumeAction fork() const { return ReadVolumeAction(); }
+    void merge(const ReadVolumeAction& other) {
+        totalVolume += other.totalVolume;
+        sessionCount += other.sessionCount;
+    }
+
+    // Average volume (0.0-1.0) of the sessions read, or -1.0 if none
+    float average() const { return sessionCount > 0 ? totalVolume / sessionCount : -1.0f; }
+};
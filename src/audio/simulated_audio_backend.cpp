@@ -0,0 +1,295 @@
+#include "simulated_audio_backend.h"
+#include "exclusion_set.h"
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QThread>
+#include <utility>
+
+SimulatedAudioBackend::SimulatedAudioBackend()
+    : processListings_(0), listener_(nullptr), nextId_(1), dirty_(false), latencyMicros_(0), blockingLatency_(false), notificationsAvailable_(true) {
+}
+
+QVector<AudioDeviceInfo> SimulatedAudioBackend::devices() {
+    simulateLatency();
+    QVector<AudioDeviceInfo> result;
+    {
+        QMutexLocker lk(&mutex_);
+        result = devices_;
+    }
+    const std::shared_ptr<const ExclusionSet> exclusions = ExclusionSet::current();
+    for (AudioDeviceInfo& device : result) {
+        device.excluded = exclusions->isDeviceExcluded(device.id, device.name);
+    }
+    return result;
+}
+
+QVector<AudioSessionEntry> SimulatedAudioBackend::sessions(const QString& deviceId) {
+    QVector<AudioSessionEntry> result;
+    {
+        QMutexLocker lk(&mutex_);
+        const QVector<quint64> ids = deviceSessions_.value(deviceId);
+        result.reserve(ids.size());
+        for (quint64 id : ids) {
+            auto it = sessions_.constFind(id);
+            if (it != sessions_.constEnd()) {
+                result.append(it->entry);
+            }
+        }
+    }
+    // Activation and enumerator setup, then the per-session calls
+    simulateLatency(1 + result.size());
+    return result;
+}
+
+QString SimulatedAudioBackend::processName(quint32 pid) {
+    simulateLatency();
+    QMutexLocker lk(&mutex_);
+    return processNames_.value(pid, "(unknown)");
+}
+
+bool SimulatedAudioBackend::processes(QVector<ProcessTreeEntry>* processes) {
+    ++processListings_;
+    {
+        QMutexLocker lk(&mutex_);
+        *processes = processes_;
+    }
+    // The snapshot, then a creation-time query per process
+    simulateLatency(1 + processes->size());
+    return true;
+}
+
+void SimulatedAudioBackend::setProcesses(const QVector<ProcessTreeEntry>& processes) {
+    QMutexLocker lk(&mutex_);
+    processes_ = processes;
+}
+
+bool SimulatedAudioBackend::start(Listener* listener) {
+    QMutexLocker lk(&mutex_);
+    if (!notificationsAvailable_) {
+        return false;
+    }
+    listener_ = listener;
+    dirty_ = false;
+    reportAllLocked();
+    return true;
+}
+
+void SimulatedAudioBackend::stop() {
+    QMutexLocker lk(&mutex_);
+    listener_ = nullptr;
+}
+
+void SimulatedAudioBackend::resyncIfNeeded() {
+    QMutexLocker lk(&mutex_);
+    if (!dirty_ || !listener_) {
+        return;
+    }
+    dirty_ = false;
+    // Drop whatever was reported while dirty, as the real backend does
+    listener_->invalidated();
+    reportAllLocked();
+}
+
+bool SimulatedAudioBackend::getMute(quint64 sessionId, bool* muted) {
+    simulateLatency();
+    QMutexLocker lk(&mutex_);
+    auto it = sessions_.constFind(sessionId);
+    if (it == sessions_.constEnd()) {
+        return false;
+    }
+    *muted = it->muted;
+    return true;
+}
+
+bool SimulatedAudioBackend::setMute(quint64 sessionId, bool muted) {
+    simulateLatency();
+    QMutexLocker lk(&mutex_);
+    auto it = sessions_.find(sessionId);
+    if (it == sessions_.end()) {
+        return false;
+    }
+    it->muted = muted;
+    return true;
+}
+
+bool SimulatedAudioBackend::getVolume(quint64 sessionId, float* volume) {
+    simulateLatency();
+    QMutexLocker lk(&mutex_);
+    auto it = sessions_.constFind(sessionId);
+    if (it == sessions_.constEnd()) {
+        return false;
+    }
+    *volume = it->volume;
+    return true;
+}
+
+bool SimulatedAudioBackend::setVolume(quint64 sessionId, float volume) {
+    simulateLatency();
+    QMutexLocker lk(&mutex_);
+    auto it = sessions_.find(sessionId);
+    if (it == sessions_.end()) {
+        return false;
+    }
+    it->volume = volume;
+    return true;
+}
+
+void SimulatedAudioBackend::setCallLatencyMicros(int micros) {
+    latencyMicros_ = micros;
+}
+
+void SimulatedAudioBackend::setBlockingLatency(bool blocking) {
+    blockingLatency_ = blocking;
+}
+
+void SimulatedAudioBackend::setNotificationsAvailable(bool available) {
+    QMutexLocker lk(&mutex_);
+    notificationsAvailable_ = available;
+}
+
+void SimulatedAudioBackend::populate(int deviceCount, int sessionsPerDevice, int processCount) {
+    QMutexLocker lk(&mutex_);
+    devices_.clear();
+    sessions_.clear();
+    deviceSessions_.clear();
+    processNames_.clear();
+
+    if (processCount < 1) {
+        processCount = 1;
+    }
+    for (int p = 0; p < processCount; ++p) {
+        processNames_.insert(1000 + p, QString("app%1.exe").arg(p));
+    }
+
+    int sessionIndex = 0;
+    for (int d = 0; d < deviceCount; ++d) {
+        AudioDeviceInfo device;
+        device.id = QString("{sim-device-%1}").arg(d);
+        device.name = QString("Simulated Device %1").arg(d);
+        devices_.append(device);
+
+        QVector<quint64>& ids = deviceSessions_[device.id];
+        ids.reserve(sessionsPerDevice);
+        for (int s = 0; s < sessionsPerDevice; ++s, ++sessionIndex) {
+            const quint32 pid = 1000 + sessionIndex % processCount;
+            SimulatedSession session;
+            session.entry.sessionId = nextId_++;
+            session.entry.deviceId = device.id;
+            session.entry.deviceName = device.name;
+            session.entry.pid = pid;
+            session.entry.exeName = processNames_.value(pid);
+            session.entry.processKey = ExclusionSet::normalizeProcessName(session.entry.exeName);
+            sessions_.insert(session.entry.sessionId, session);
+            ids.append(session.entry.sessionId);
+        }
+    }
+
+    if (listener_) {
+        listener_->invalidated();
+        reportAllLocked();
+    }
+}
+
+void SimulatedAudioBackend::addDevice(const QString& deviceId, const QString& deviceName) {
+    QMutexLocker lk(&mutex_);
+    for (const AudioDeviceInfo& device : std::as_const(devices_)) {
+        if (device.id == deviceId) {
+            return;
+        }
+    }
+    AudioDeviceInfo device;
+    device.id = deviceId;
+    device.name = deviceName;
+    devices_.append(device);
+    deviceSessions_.insert(deviceId, QVector<quint64>());
+}
+
+quint64 SimulatedAudioBackend::addSession(const QString& deviceId, quint32 pid, const QString& exeName, float volume) {
+    addDevice(deviceId, deviceId);
+
+    QMutexLocker lk(&mutex_);
+    SimulatedSession session;
+    session.entry.sessionId = nextId_++;
+    session.entry.deviceId = deviceId;
+    for (const AudioDeviceInfo& device : std::as_const(devices_)) {
+        if (device.id == deviceId) {
+            session.entry.deviceName = device.name;
+            break;
+        }
+    }
+    session.entry.pid = pid;
+    session.entry.exeName = exeName;
+    session.entry.processKey = ExclusionSet::normalizeProcessName(exeName);
+    session.volume = volume;
+    processNames_.insert(pid, exeName);
+    sessions_.insert(session.entry.sessionId, session);
+    deviceSessions_[deviceId].append(session.entry.sessionId);
+    if (listener_) {
+        listener_->sessionAdded(session.entry);
+    }
+    return session.entry.sessionId;
+}
+
+void SimulatedAudioBackend::removeSession(quint64 sessionId) {
+    QMutexLocker lk(&mutex_);
+    auto it = sessions_.find(sessionId);
+    if (it == sessions_.end()) {
+        return;
+    }
+    deviceSessions_[it->entry.deviceId].removeOne(sessionId);
+    sessions_.erase(it);
+    if (listener_) {
+        listener_->sessionRemoved(sessionId);
+    }
+}
+
+void SimulatedAudioBackend::removeDevice(const QString& deviceId) {
+    QMutexLocker lk(&mutex_);
+    const QVector<quint64> ids = deviceSessions_.take(deviceId);
+    for (quint64 id : ids) {
+        sessions_.remove(id);
+    }
+    for (int i = 0; i < devices_.size(); ++i) {
+        if (devices_[i].id == deviceId) {
+            devices_.removeAt(i);
+            break;
+        }
+    }
+    if (listener_) {
+        listener_->deviceRemoved(deviceId);
+    }
+}
+
+void SimulatedAudioBackend::invalidate() {
+    QMutexLocker lk(&mutex_);
+    dirty_ = true;
+    if (listener_) {
+        listener_->invalidated();
+    }
+}
+
+void SimulatedAudioBackend::simulateLatency(int calls) const {
+    const qint64 waitNs = qint64(latencyMicros_.load()) * 1000 * calls;
+    if (waitNs <= 0) {
+        return;
+    }
+    if (blockingLatency_.load()) {
+        QThread::usleep(static_cast<unsigned long>(waitNs / 1000));
+        return;
+    }
+    // Spin by default: sleeps are far coarser than a COM round trip
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.nsecsElapsed() < waitNs) {
+    }
+}
+
+void SimulatedAudioBackend::reportAllLocked() {
+    if (!listener_) {
+        return;
+    }
+    for (const SimulatedSession& session : std::as_const(sessions_)) {
+        listener_->sessionAdded(session.entry);
+    }
+    listener_->synced();
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "audio_backend.h"
+#include <QHash>
+#include <QMutex>
+#include <QVector>
+#include <atomic>
+
+// In-memory AudioBackend modelling N devices x M sessions. Every backend call
+// can be given an artificial latency so scan costs can be measured without
+// Windows audio (e.g. benchmarking on Linux).
+class SimulatedAudioBackend : public AudioBackend {
+public:
+    SimulatedAudioBackend();
+
+    QVector<AudioDeviceInfo> devices() override;
+    QVector<AudioSessionEntry> sessions(const QString& deviceId) override;
+    QString processName(quint32 pid) override;
+    bool processes(QVector<ProcessTreeEntry>* processes) override;
+
+    bool start(Listener* listener) override;
+    void stop() override;
+    void resyncIfNeeded() override;
+
+    bool getMute(quint64 sessionId, bool* muted) override;
+    bool setMute(quint64 sessionId, bool muted) override;
+    bool getVolume(quint64 sessionId, float* volume) override;
+    bool setVolume(quint64 sessionId, float volume) override;
+
+    // Busy-waits this long inside every backend call. sessions() pays it once
+    // per reported session, since the real backend makes several COM calls
+    // (and an OpenProcess) for each one.
+    void setCallLatencyMicros(int micros);
+    // Sleep through the latency instead of spinning, like a cross-process
+    // call that leaves the CPU to other threads. Sleeps round up to the
+    // system timer, so the per-call cost grows; compare runs of one kind.
+    void setBlockingLatency(bool blocking);
+
+    // When false, start() fails like a system without session notifications,
+    // so AudioMuter takes the scan path. Takes effect on the next start().
+    void setNotificationsAvailable(bool available);
+
+    // Replace the current model with `deviceCount` devices carrying
+    // `sessionsPerDevice` sessions each. Sessions are spread over
+    // `processCount` processes named "app<N>.exe" with PIDs 1000 + N.
+    void populate(int deviceCount, int sessionsPerDevice, int processCount);
+
+    void addDevice(const QString& deviceId, const QString& deviceName);
+    // Returns the new session's ID. Unknown devices are added on the fly.
+    quint64 addSession(const QString& deviceId, quint32 pid, const QString& exeName, float volume = 1.0f);
+    void removeSession(quint64 sessionId);
+    void removeDevice(const QString& deviceId);
+
+    // Behave like a device change: the listener is invalidated and re-fed on the next resyncIfNeeded()
+    void invalidate();
+
+    // Process table reported by processes(), e.g. a synthetic browser with
+    // renderer children. Empty until set.
+    void setProcesses(const QVector<ProcessTreeEntry>& processes);
+    // How many times processes() has been called
+    int processListings() const { return processListings_; }
+
+private:
+    struct SimulatedSession {
+        AudioSessionEntry entry;
+        bool muted = false;
+        float volume = 1.0f;
+    };
+
+    void simulateLatency(int calls = 1) const;
+    void reportAllLocked();
+
+    QMutex mutex_;
+    QVector<AudioDeviceInfo> devices_;
+    QHash<quint64, SimulatedSession> sessions_;
+    QHash<QString, QVector<quint64>> deviceSessions_;  // Enumeration order per device
+    QHash<quint32, QString> processNames_;
+    QVector<ProcessTreeEntry> processes_;
+    std::atomic<int> processListings_;
+    Listener* listener_;
+    quint64 nextId_;
+    bool dirty_;
+    std::atomic<int> latencyMicros_;
+    std::atomic<bool> blockingLatency_;
+    bool notificationsAvailable_;
+};
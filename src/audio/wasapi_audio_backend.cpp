@@ -0,0 +1,572 @@
+#include "wasapi_audio_backend.h"
+#include "logger.h"
+#include "windows_process_probe.h"
+#include <functiondiscoverykeys_devpkey.h>
+#include <QMutexLocker>
+#include <utility>
+
+// Endpoint add/remove/state/name changes invalidate the whole index
+class WasapiAudioBackend::DeviceNotifier : public IMMNotificationClient {
+public:
+    explicit DeviceNotifier(WasapiAudioBackend *owner) : refCount_(1), owner_(owner) {}
+
+    ULONG STDMETHODCALLTYPE AddRef() override { return ++refCount_; }
+    ULONG STDMETHODCALLTYPE Release() override {
+        ULONG count = --refCount_;
+        if (count == 0) {
+            delete this;
+        }
+        return count;
+    }
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppv) override {
+        if (riid == __uuidof(IUnknown) || riid == __uuidof(IMMNotificationClient)) {
+            *ppv = static_cast<IMMNotificationClient*>(this);
+            AddRef();
+            return S_OK;
+        }
+        *ppv = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnDeviceStateChanged(LPCWSTR, DWORD) override {
+        owner_->markDirty();
+        return S_OK;
+    }
+    HRESULT STDMETHODCALLTYPE OnDeviceAdded(LPCWSTR) override {
+        owner_->markDirty();
+        return S_OK;
+    }
+    HRESULT STDMETHODCALLTYPE OnDeviceRemoved(LPCWSTR) override {
+        owner_->markDirty();
+        return S_OK;
+    }
+    HRESULT STDMETHODCALLTYPE OnDefaultDeviceChanged(EDataFlow, ERole, LPCWSTR) override {
+        return S_OK;
+    }
+    HRESULT STDMETHODCALLTYPE OnPropertyValueChanged(LPCWSTR, const PROPERTYKEY key) override {
+        // Friendly names are cached by the device registry
+        if (key.fmtid == PKEY_Device_FriendlyName.fmtid && key.pid == PKEY_Device_FriendlyName.pid) {
+            owner_->markDirty();
+        }
+        return S_OK;
+    }
+
+private:
+    std::atomic<ULONG> refCount_;
+    WasapiAudioBackend *owner_;
+};
+
+// Session-created notifications for one endpoint
+class WasapiAudioBackend::SessionNotifier : public IAudioSessionNotification {
+public:
+    SessionNotifier(WasapiAudioBackend *owner, const QString& deviceId, const QString& deviceName)
+        : refCount_(1), owner_(owner), deviceId_(deviceId), deviceName_(deviceName) {}
+
+    ULONG STDMETHODCALLTYPE AddRef() override { return ++refCount_; }
+    ULONG STDMETHODCALLTYPE Release() override {
+        ULONG count = --refCount_;
+        if (count == 0) {
+            delete this;
+        }
+        return count;
+    }
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppv) override {
+        if (riid == __uuidof(IUnknown) || riid == __uuidof(IAudioSessionNotification)) {
+            *ppv = static_cast<IAudioSessionNotification*>(this);
+            AddRef();
+            return S_OK;
+        }
+        *ppv = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnSessionCreated(IAudioSessionControl *newSession) override {
+        if (newSession) {
+            owner_->addSession(deviceId_, deviceName_, newSession);
+        }
+        return S_OK;
+    }
+
+private:
+    std::atomic<ULONG> refCount_;
+    WasapiAudioBackend *owner_;
+    QString deviceId_;
+    QString deviceName_;
+};
+
+// Disconnect/expiry notifications for one session
+class WasapiAudioBackend::SessionEvents : public IAudioSessionEvents {
+public:
+    SessionEvents(WasapiAudioBackend *owner, quint64 sessionId)
+        : refCount_(1), owner_(owner), sessionId_(sessionId) {}
+
+    ULONG STDMETHODCALLTYPE AddRef() override { return ++refCount_; }
+    ULONG STDMETHODCALLTYPE Release() override {
+        ULONG count = --refCount_;
+        if (count == 0) {
+            delete this;
+        }
+        return count;
+    }
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppv) override {
+        if (riid == __uuidof(IUnknown) || riid == __uuidof(IAudioSessionEvents)) {
+            *ppv = static_cast<IAudioSessionEvents*>(this);
+            AddRef();
+            return S_OK;
+        }
+        *ppv = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnDisplayNameChanged(LPCWSTR, LPCGUID) override { return S_OK; }
+    HRESULT STDMETHODCALLTYPE OnIconPathChanged(LPCWSTR, LPCGUID) override { return S_OK; }
+    HRESULT STDMETHODCALLTYPE OnSimpleVolumeChanged(float, BOOL, LPCGUID) override { return S_OK; }
+    HRESULT STDMETHODCALLTYPE OnChannelVolumeChanged(DWORD, float[], DWORD, LPCGUID) override { return S_OK; }
+    HRESULT STDMETHODCALLTYPE OnGroupingParamChanged(LPCGUID, LPCGUID) override { return S_OK; }
+    HRESULT STDMETHODCALLTYPE OnStateChanged(AudioSessionState newState) override {
+        if (newState == AudioSessionStateExpired) {
+            owner_->removeSession(sessionId_);
+        }
+        return S_OK;
+    }
+    HRESULT STDMETHODCALLTYPE OnSessionDisconnected(AudioSessionDisconnectReason) override {
+        owner_->removeSession(sessionId_);
+        return S_OK;
+    }
+
+private:
+    std::atomic<ULONG> refCount_;
+    WasapiAudioBackend *owner_;
+    quint64 sessionId_;
+};
+
+WasapiAudioBackend::WasapiAudioBackend()
+    : enumerator_(nullptr), listener_(nullptr), dirty_(false),
+      processCache_(std::make_unique<WindowsProcessProbe>()), nextId_(1) {
+    CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    CoCreateInstance(__uuidof(MMDeviceEnumerator),
+                     nullptr,
+                     CLSCTX_ALL,
+                     IID_PPV_ARGS(&enumerator_));
+    if (!enumerator_) {
+        LOG_ERROR(Audio, "Failed to create IMMDeviceEnumerator");
+    }
+    registry_ = std::make_unique<DeviceRegistry>(enumerator_);
+}
+
+WasapiAudioBackend::~WasapiAudioBackend() {
+    stop();
+    QHash<quint64, ScannedSession> scanned;
+    {
+        QMutexLocker lk(&mutex_);
+        scanned.swap(scanned_);
+    }
+    scanned.clear();
+    registry_.reset();
+    if (enumerator_) enumerator_->Release();
+    CoUninitialize();
+}
+
+QVector<AudioDeviceInfo> WasapiAudioBackend::devices() {
+    if (!enumerator_) {
+        LOG_ERROR(Audio, "Audio enumerator is null!");
+        return QVector<AudioDeviceInfo>();
+    }
+    const QVector<AudioDeviceInfo> result = registry_->devices();
+
+    // Drop snapshot handles for endpoints that went away. They are released
+    // after the lock is dropped, like every other COM call here.
+    QVector<ScannedSession> stale;
+    QMutexLocker lk(&mutex_);
+    for (auto it = scanned_.begin(); it != scanned_.end();) {
+        bool present = false;
+        for (const AudioDeviceInfo& info : std::as_const(result)) {
+            if (info.id == it->deviceId) {
+                present = true;
+                break;
+            }
+        }
+        if (present) {
+            ++it;
+        } else {
+            stale.append(it.value());
+            it = scanned_.erase(it);
+        }
+    }
+    return result;
+}
+
+QVector<AudioSessionEntry> WasapiAudioBackend::sessions(const QString& deviceId) {
+    QVector<AudioSessionEntry> result;
+    if (!enumerator_) {
+        return result;
+    }
+
+    DeviceRegistry::Endpoint endpoint;
+    if (!registry_->endpoint(deviceId, &endpoint)) {
+        LOG_WARNING(Audio, QString("Failed to open device %1").arg(deviceId));
+        return result;
+    }
+    if (!endpoint.manager) {
+        LOG_WARNING(Audio, "No IAudioSessionManager2 for device");
+        return result;
+    }
+    const QString& deviceName = endpoint.name;
+
+    CComPtr<IAudioSessionEnumerator> sessEnum;
+    if (FAILED(endpoint.manager->GetSessionEnumerator(&sessEnum))) {
+        LOG_WARNING(Audio, "Failed to get session enumerator");
+        return result;
+    }
+
+    int n = 0;
+    sessEnum->GetCount(&n);
+    LOG_DEBUG(Audio, QString("Total audio sessions on device: %1").arg(n));
+
+    QHash<quint64, ScannedSession> snapshot;
+    for (int i = 0; i < n; ++i) {
+        CComPtr<IAudioSessionControl> ctl;
+        if (FAILED(sessEnum->GetSession(i, &ctl))) {
+            LOG_WARNING(Audio, QString("Failed to get session %1").arg(i));
+            continue;
+        }
+
+        CComPtr<IAudioSessionControl2> ctl2;
+        if (FAILED(ctl->QueryInterface(__uuidof(IAudioSessionControl2), (void**)&ctl2))) {
+            LOG_WARNING(Audio, QString("Failed to get IAudioSessionControl2 for session %1").arg(i));
+            continue;
+        }
+
+        DWORD pid = 0;
+        if (FAILED(ctl2->GetProcessId(&pid))) {
+            LOG_WARNING(Audio, QString("Failed to get process ID for session %1").arg(i));
+            continue;
+        }
+
+        ScannedSession scanned;
+        scanned.deviceId = deviceId;
+        if (FAILED(ctl2->QueryInterface(__uuidof(ISimpleAudioVolume), (void**)&scanned.volume))) {
+            LOG_WARNING(Audio, QString("Failed to get ISimpleAudioVolume for session %1").arg(i));
+            continue;
+        }
+
+        AudioSessionEntry entry;
+        entry.deviceId = deviceId;
+        entry.deviceName = deviceName;
+        entry.pid = pid;
+        const ProcessIdentity identity = processCache_.lookup(pid);
+        entry.exeName = identity.baseName;
+        entry.processKey = identity.normalizedName;
+        {
+            QMutexLocker lk(&mutex_);
+            entry.sessionId = nextId_++;
+        }
+        snapshot.insert(entry.sessionId, scanned);
+        result.append(entry);
+    }
+
+    QVector<ScannedSession> stale;
+    QMutexLocker lk(&mutex_);
+    for (auto it = scanned_.begin(); it != scanned_.end();) {
+        if (it->deviceId == deviceId) {
+            stale.append(it.value());
+            it = scanned_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = snapshot.constBegin(); it != snapshot.constEnd(); ++it) {
+        scanned_.insert(it.key(), it.value());
+    }
+    return result;
+}
+
+QString WasapiAudioBackend::processName(quint32 pid) {
+    return processCache_.lookup(pid).baseName;
+}
+
+bool WasapiAudioBackend::processes(QVector<ProcessTreeEntry>* processes) {
+    if (!WindowsProcessProbe::listProcesses(processes)) {
+        LOG_WARNING(Audio, QString("Failed to list processes. Error: %1").arg(GetLastError()));
+        return false;
+    }
+    return true;
+}
+
+bool WasapiAudioBackend::start(Listener* listener) {
+    if (!enumerator_) {
+        return false;
+    }
+
+    {
+        QMutexLocker lk(&mutex_);
+        listener_ = listener;
+    }
+
+    deviceNotifier_.Attach(new DeviceNotifier(this));
+    if (FAILED(enumerator_->RegisterEndpointNotificationCallback(deviceNotifier_))) {
+        LOG_WARNING(Audio, "Failed to register endpoint notifications, session index disabled");
+        deviceNotifier_.Release();
+        QMutexLocker lk(&mutex_);
+        listener_ = nullptr;
+        return false;
+    }
+
+    dirty_ = false;
+    registry_->setTracking(true);
+    if (!enumerateAll()) {
+        stop();
+        return false;
+    }
+    listener->synced();
+    return true;
+}
+
+void WasapiAudioBackend::stop() {
+    if (deviceNotifier_) {
+        enumerator_->UnregisterEndpointNotificationCallback(deviceNotifier_);
+        deviceNotifier_.Release();
+    }
+    detachAll();
+    if (registry_) {
+        registry_->setTracking(false);
+    }
+    QMutexLocker lk(&mutex_);
+    listener_ = nullptr;
+}
+
+void WasapiAudioBackend::resyncIfNeeded() {
+    releaseRetired();
+
+    if (!dirty_.exchange(false)) {
+        return;
+    }
+
+    LOG_INFO(Audio, "Audio devices changed, rebuilding session index");
+    detachAll();
+    enumerateAll();
+
+    QMutexLocker lk(&mutex_);
+    if (listener_) {
+        listener_->synced();
+    }
+}
+
+bool WasapiAudioBackend::getMute(quint64 sessionId, bool* muted) {
+    CComPtr<ISimpleAudioVolume> vol = volumeFor(sessionId);
+    BOOL isMuted = FALSE;
+    if (!vol || FAILED(vol->GetMute(&isMuted))) {
+        return false;
+    }
+    *muted = isMuted != FALSE;
+    return true;
+}
+
+bool WasapiAudioBackend::setMute(quint64 sessionId, bool muted) {
+    CComPtr<ISimpleAudioVolume> vol = volumeFor(sessionId);
+    return vol && SUCCEEDED(vol->SetMute(muted ? TRUE : FALSE, nullptr));
+}
+
+bool WasapiAudioBackend::getVolume(quint64 sessionId, float* volume) {
+    CComPtr<ISimpleAudioVolume> vol = volumeFor(sessionId);
+    return vol && SUCCEEDED(vol->GetMasterVolume(volume));
+}
+
+bool WasapiAudioBackend::setVolume(quint64 sessionId, float volume) {
+    CComPtr<ISimpleAudioVolume> vol = volumeFor(sessionId);
+    return vol && SUCCEEDED(vol->SetMasterVolume(volume, nullptr));
+}
+
+void WasapiAudioBackend::markDirty() {
+    registry_->invalidate();
+    dirty_ = true;
+    QMutexLocker lk(&mutex_);
+    if (listener_) {
+        listener_->invalidated();
+    }
+}
+
+void WasapiAudioBackend::addSession(const QString& deviceId, const QString& deviceName, IAudioSessionControl *control) {
+    SessionRecord record;
+    if (FAILED(control->QueryInterface(__uuidof(IAudioSessionControl2), (void**)&record.control))) {
+        return;
+    }
+
+    LPWSTR rawInstance = nullptr;
+    if (FAILED(record.control->GetSessionInstanceIdentifier(&rawInstance))) {
+        return;
+    }
+    record.instanceId = QString::fromWCharArray(rawInstance);
+    CoTaskMemFree(rawInstance);
+
+    {
+        QMutexLocker lk(&mutex_);
+        if (idsByInstance_.contains(record.instanceId)) {
+            return;
+        }
+    }
+
+    DWORD pid = 0;
+    if (FAILED(record.control->GetProcessId(&pid))) {
+        return;
+    }
+    if (FAILED(record.control->QueryInterface(__uuidof(ISimpleAudioVolume), (void**)&record.volume))) {
+        return;
+    }
+
+    AudioSessionEntry entry;
+    entry.deviceId = deviceId;
+    entry.deviceName = deviceName;
+    entry.pid = pid;
+    const ProcessIdentity identity = processCache_.lookup(pid);
+    entry.exeName = identity.baseName;
+    entry.processKey = identity.normalizedName;
+
+    {
+        QMutexLocker lk(&mutex_);
+        // Re-check: a creation notification may have raced an enumeration
+        if (idsByInstance_.contains(record.instanceId)) {
+            return;
+        }
+        entry.sessionId = nextId_++;
+    }
+
+    record.events.Attach(new SessionEvents(this, entry.sessionId));
+    if (FAILED(record.control->RegisterAudioSessionNotification(record.events))) {
+        record.events.Release();
+    }
+
+    QMutexLocker lk(&mutex_);
+    if (idsByInstance_.contains(record.instanceId)) {
+        retired_.append(record);
+        return;
+    }
+    idsByInstance_.insert(record.instanceId, entry.sessionId);
+    sessions_.insert(entry.sessionId, record);
+    if (listener_) {
+        listener_->sessionAdded(entry);
+    }
+}
+
+void WasapiAudioBackend::removeSession(quint64 sessionId) {
+    QMutexLocker lk(&mutex_);
+    auto it = sessions_.find(sessionId);
+    if (it == sessions_.end()) {
+        return;
+    }
+    idsByInstance_.remove(it->instanceId);
+    // Unregistering from inside the session's own callback is not allowed
+    retired_.append(*it);
+    sessions_.erase(it);
+    if (listener_) {
+        listener_->sessionRemoved(sessionId);
+    }
+}
+
+bool WasapiAudioBackend::enumerateAll() {
+    const QVector<DeviceRegistry::Endpoint> endpoints = registry_->endpoints();
+    for (const DeviceRegistry::Endpoint& endpoint : endpoints) {
+        attachDevice(endpoint);
+    }
+
+    QMutexLocker lk(&mutex_);
+    LOG_INFO(Audio, QString("Session index built: %1 devices, %2 sessions").arg(devices_.size()).arg(sessions_.size()));
+    return true;
+}
+
+void WasapiAudioBackend::attachDevice(const DeviceRegistry::Endpoint& endpoint) {
+    if (!endpoint.manager) {
+        return;
+    }
+    DeviceRecord record;
+    record.id = endpoint.id;
+    record.name = endpoint.name;
+    record.manager = endpoint.manager;
+
+    record.notifier.Attach(new SessionNotifier(this, record.id, record.name));
+    if (FAILED(record.manager->RegisterSessionNotification(record.notifier))) {
+        LOG_WARNING(Audio, QString("Failed to register session notifications for device %1").arg(record.name));
+        record.notifier.Release();
+    }
+
+    // Enumerating after registering both primes the notifications and
+    // catches sessions created before registration took effect
+    CComPtr<IAudioSessionEnumerator> sessEnum;
+    if (SUCCEEDED(record.manager->GetSessionEnumerator(&sessEnum))) {
+        int n = 0;
+        sessEnum->GetCount(&n);
+        for (int i = 0; i < n; ++i) {
+            CComPtr<IAudioSessionControl> ctl;
+            if (SUCCEEDED(sessEnum->GetSession(i, &ctl))) {
+                addSession(record.id, record.name, ctl);
+            }
+        }
+    }
+
+    QMutexLocker lk(&mutex_);
+    devices_.insert(record.id, record);
+}
+
+void WasapiAudioBackend::detachAll() {
+    QHash<QString, DeviceRecord> devices;
+    QHash<quint64, SessionRecord> sessions;
+    QVector<SessionRecord> retired;
+    {
+        QMutexLocker lk(&mutex_);
+        devices.swap(devices_);
+        sessions.swap(sessions_);
+        retired.swap(retired_);
+        idsByInstance_.clear();
+        // Start the index over in the same step. Sessions reported after
+        // markDirty() invalidated it carry IDs that die here, and the next
+        // enumeration reports every session again under a new ID.
+        if (listener_) {
+            listener_->invalidated();
+        }
+    }
+
+    for (const SessionRecord& record : std::as_const(sessions)) {
+        if (record.events) {
+            record.control->UnregisterAudioSessionNotification(record.events);
+        }
+    }
+    for (const SessionRecord& record : std::as_const(retired)) {
+        if (record.events) {
+            record.control->UnregisterAudioSessionNotification(record.events);
+        }
+    }
+    for (const DeviceRecord& record : std::as_const(devices)) {
+        if (record.notifier) {
+            record.manager->UnregisterSessionNotification(record.notifier);
+        }
+    }
+}
+
+void WasapiAudioBackend::releaseRetired() {
+    QVector<SessionRecord> retired;
+    {
+        QMutexLocker lk(&mutex_);
+        if (retired_.isEmpty()) {
+            return;
+        }
+        retired.swap(retired_);
+    }
+    for (const SessionRecord& record : std::as_const(retired)) {
+        if (record.events) {
+            record.control->UnregisterAudioSessionNotification(record.events);
+        }
+    }
+}
+
+CComPtr<ISimpleAudioVolume> WasapiAudioBackend::volumeFor(quint64 sessionId) {
+    QMutexLocker lk(&mutex_);
+    auto it = sessions_.constFind(sessionId);
+    if (it != sessions_.constEnd()) {
+        return it->volume;
+    }
+    auto scannedIt = scanned_.constFind(sessionId);
+    if (scannedIt != scanned_.constEnd()) {
+        return scannedIt->volume;
+    }
+    return CComPtr<ISimpleAudioVolume>();
+}
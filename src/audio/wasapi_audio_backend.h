@@ -0,0 +1,94 @@
+#pragma once
+#include "audio_backend.h"
+#include "device_registry.h"
+#include "process_identity_cache.h"
+#include <Windows.h>
+#include <mmdeviceapi.h>
+#include <audiopolicy.h>
+#include <atlbase.h>
+#include <QHash>
+#include <QMutex>
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+// AudioBackend on top of Windows Core Audio. Registers for endpoint,
+// session-created and session-disconnected notifications so the session index
+// stays current without re-enumerating on every hotkey press.
+// The scan path may be called from AudioMuter's scan pool: those threads do
+// not initialize COM and join the MTA that the owning thread keeps alive.
+class WasapiAudioBackend : public AudioBackend {
+public:
+    WasapiAudioBackend();
+    ~WasapiAudioBackend() override;
+
+    QVector<AudioDeviceInfo> devices() override;
+    QVector<AudioSessionEntry> sessions(const QString& deviceId) override;
+    QString processName(quint32 pid) override;
+    bool processes(QVector<ProcessTreeEntry>* processes) override;
+
+    bool start(Listener* listener) override;
+    void stop() override;
+    void resyncIfNeeded() override;
+
+    bool getMute(quint64 sessionId, bool* muted) override;
+    bool setMute(quint64 sessionId, bool muted) override;
+    bool getVolume(quint64 sessionId, float* volume) override;
+    bool setVolume(quint64 sessionId, float volume) override;
+
+private:
+    class DeviceNotifier;
+    class SessionNotifier;
+    class SessionEvents;
+
+    struct DeviceRecord {
+        QString id;
+        QString name;
+        CComPtr<IAudioSessionManager2> manager;
+        CComPtr<IAudioSessionNotification> notifier;
+    };
+
+    struct SessionRecord {
+        QString instanceId;
+        CComPtr<IAudioSessionControl2> control;
+        CComPtr<ISimpleAudioVolume> volume;
+        CComPtr<IAudioSessionEvents> events;
+    };
+
+    // Session seen by a sessions() snapshot; replaced by the next snapshot of its device
+    struct ScannedSession {
+        QString deviceId;
+        CComPtr<ISimpleAudioVolume> volume;
+    };
+
+    // Notification entry points (called on COM worker threads)
+    void markDirty();
+    void addSession(const QString& deviceId, const QString& deviceName, IAudioSessionControl *control);
+    void removeSession(quint64 sessionId);
+
+    bool enumerateAll();
+    void attachDevice(const DeviceRegistry::Endpoint& endpoint);
+    void detachAll();
+    void releaseRetired();
+    CComPtr<ISimpleAudioVolume> volumeFor(quint64 sessionId);
+
+    IMMDeviceEnumerator *enumerator_;
+    CComPtr<IMMNotificationClient> deviceNotifier_;
+    Listener* listener_;
+    std::atomic<bool> dirty_;
+    // Endpoint names and session managers, shared by the scan and live paths
+    std::unique_ptr<DeviceRegistry> registry_;
+    // PID -> executable name, so warm lookups skip OpenProcess entirely
+    ProcessIdentityCache processCache_;
+
+    // Guards everything below. Never held across COM calls: registration calls
+    // may wait for in-flight callbacks, which take this lock themselves.
+    QMutex mutex_;
+    QHash<QString, DeviceRecord> devices_;
+    QHash<quint64, SessionRecord> sessions_;
+    QHash<QString, quint64> idsByInstance_;
+    // Sessions that disconnected; unregistered outside the notification callback
+    QVector<SessionRecord> retired_;
+    QHash<quint64, ScannedSession> scanned_;
+    quint64 nextId_;
+};
@@ -0,0 +1,153 @@
+#include "windows_process_probe.h"
+#include <TlHelp32.h>
+#include <QMutexLocker>
+#include <utility>
+
+WindowsProcessProbe::WindowsProcessProbe() {
+}
+
+WindowsProcessProbe::~WindowsProcessProbe() {
+    cancelAllWatches();
+}
+
+bool WindowsProcessProbe::resolve(quint32 pid, ProcessIdentity* identity) {
+    HANDLE hProc = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if (!hProc) {
+        return false;
+    }
+
+    bool ok = false;
+    WCHAR buf[MAX_PATH];
+    DWORD len = MAX_PATH;
+    if (readCreationTime(hProc, &identity->creationTime) && QueryFullProcessImageNameW(hProc, 0, buf, &len)) {
+        identity->pid = pid;
+        identity->imagePath = QString::fromWCharArray(buf, len);
+        ok = true;
+    }
+    CloseHandle(hProc);
+    return ok;
+}
+
+bool WindowsProcessProbe::isSameProcess(quint32 pid, quint64 creationTime) {
+    HANDLE hProc = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if (!hProc) {
+        return false;
+    }
+    quint64 current = 0;
+    bool same = readCreationTime(hProc, &current) && current == creationTime;
+    CloseHandle(hProc);
+    return same;
+}
+
+bool WindowsProcessProbe::watchExit(quint32 pid, quint64 creationTime, ProcessIdentityCache* cache) {
+    const WatchKey key(pid, creationTime);
+    {
+        QMutexLocker lk(&mutex_);
+        if (watches_.contains(key)) {
+            return true;
+        }
+    }
+
+    HANDLE hProc = OpenProcess(SYNCHRONIZE | PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if (!hProc) {
+        return false;
+    }
+    // The PID may already belong to a different process than the one resolved
+    quint64 current = 0;
+    if (!readCreationTime(hProc, &current) || current != creationTime) {
+        CloseHandle(hProc);
+        return false;
+    }
+
+    Watch *watch = new Watch;
+    watch->probe = this;
+    watch->cache = cache;
+    watch->pid = pid;
+    watch->creationTime = creationTime;
+    watch->process = hProc;
+
+    // Registered under the lock: the callback takes it too, so it cannot run
+    // before the watch is in the table even if the process is already gone
+    QMutexLocker lk(&mutex_);
+    if (watches_.contains(key)) {
+        CloseHandle(hProc);
+        delete watch;
+        return true;
+    }
+    if (!RegisterWaitForSingleObject(&watch->wait, hProc, onProcessExited, watch, INFINITE, WT_EXECUTEONLYONCE)) {
+        CloseHandle(hProc);
+        delete watch;
+        return false;
+    }
+    watches_.insert(key, watch);
+    return true;
+}
+
+void WindowsProcessProbe::cancelAllWatches() {
+    QHash<WatchKey, Watch*> watches;
+    {
+        QMutexLocker lk(&mutex_);
+        watches.swap(watches_);
+    }
+    // Blocking unregister waits for running callbacks, which need mutex_
+    for (Watch *watch : std::as_const(watches)) {
+        UnregisterWaitEx(watch->wait, INVALID_HANDLE_VALUE);
+        CloseHandle(watch->process);
+        delete watch;
+    }
+}
+
+VOID CALLBACK WindowsProcessProbe::onProcessExited(PVOID context, BOOLEAN) {
+    Watch *watch = static_cast<Watch*>(context);
+    WindowsProcessProbe *probe = watch->probe;
+
+    {
+        QMutexLocker lk(&probe->mutex_);
+        // Missing means cancelAllWatches() owns the watch and will free it
+        if (probe->watches_.take(WatchKey(watch->pid, watch->creationTime)) != watch) {
+            return;
+        }
+        // Still under our lock, so cancelAllWatches() cannot return (and the
+        // cache cannot be destroyed) while this call is running
+        watch->cache->processExited(watch->pid, watch->creationTime);
+    }
+
+    // Non-blocking unregister is the only kind allowed inside the callback
+    UnregisterWait(watch->wait);
+    CloseHandle(watch->process);
+    delete watch;
+}
+
+bool WindowsProcessProbe::listProcesses(QVector<ProcessTreeEntry>* processes) {
+    HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+    if (snapshot == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    processes->clear();
+    PROCESSENTRY32W entry;
+    entry.dwSize = sizeof(entry);
+    for (BOOL more = Process32FirstW(snapshot, &entry); more; more = Process32NextW(snapshot, &entry)) {
+        ProcessTreeEntry process;
+        process.pid = entry.th32ProcessID;
+        process.parentPid = entry.th32ParentProcessID;
+        // Protected processes stay at 0, which ProcessTree treats as unknown
+        HANDLE hProc = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, process.pid);
+        if (hProc) {
+            readCreationTime(hProc, &process.creationTime);
+            CloseHandle(hProc);
+        }
+        processes->append(process);
+    }
+    CloseHandle(snapshot);
+    return true;
+}
+
+bool WindowsProcessProbe::readCreationTime(HANDLE process, quint64* creationTime) {
+    FILETIME created, exited, kernel, user;
+    if (!GetProcessTimes(process, &created, &exited, &kernel, &user)) {
+        return false;
+    }
+    *creationTime = (quint64(created.dwHighDateTime) << 32) | created.dwLowDateTime;
+    return true;
+}
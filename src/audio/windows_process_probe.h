@@ -0,0 +1,43 @@
+#pragma once
+#include "process_identity_cache.h"
+#include "process_tree.h"
+#include <Windows.h>
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QVector>
+
+// ProcessProbe backed by OpenProcess/GetProcessTimes. Exit watches hold a
+// SYNCHRONIZE handle, which also keeps the PID from being reused while the
+// cache entry is alive.
+class WindowsProcessProbe : public ProcessProbe {
+public:
+    WindowsProcessProbe();
+    ~WindowsProcessProbe() override;
+
+    bool resolve(quint32 pid, ProcessIdentity* identity) override;
+    bool isSameProcess(quint32 pid, quint64 creationTime) override;
+    bool watchExit(quint32 pid, quint64 creationTime, ProcessIdentityCache* cache) override;
+    void cancelAllWatches() override;
+
+    // Every running process from one Toolhelp snapshot, with creation times
+    // where the process can be opened
+    static bool listProcesses(QVector<ProcessTreeEntry>* processes);
+
+private:
+    struct Watch {
+        WindowsProcessProbe *probe = nullptr;
+        ProcessIdentityCache *cache = nullptr;
+        quint32 pid = 0;
+        quint64 creationTime = 0;
+        HANDLE process = nullptr;
+        HANDLE wait = nullptr;
+    };
+    typedef QPair<quint32, quint64> WatchKey;
+
+    static VOID CALLBACK onProcessExited(PVOID context, BOOLEAN timedOut);
+    static bool readCreationTime(HANDLE process, quint64* creationTime);
+
+    QMutex mutex_;
+    QHash<WatchKey, Watch*> watches_;
+};
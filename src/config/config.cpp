@@ -1,7 +1,9 @@
 #include "config.h"
+#include "exclusion_set.h"
 #include "logger.h"
 
 Config::Config() : settings_("TfourJ", "MuteActiveWindow") {
+    publishExclusions();
 }
 
 Config& Config::instance() {
@@ -19,11 +21,12 @@ void Config::setHotkey(const QString& hotkey) {
 }
 
 QStringList Config::getExcludedDevices() const {
-    return settings_.value("excludedDevices", QStringList()).toStringList();
+    return settings_.value("excludedDeviceIds", QStringList()).toStringList();
 }
 
 void Config::setExcludedDevices(const QStringList& devices) {
-    settings_.setValue("excludedDevices", devices);
+    settings_.setValue("excludedDeviceIds", devices);
+    publishExclusions();
     Logger::log(QString("Excluded devices saved: %1").arg(devices.join(", ")));
 }
 
@@ -45,7 +48,22 @@ void Config::removeExcludedDevice(const QString& device) {
 }
 
 bool Config::isDeviceExcluded(const QString& device) const {
-    return getExcludedDevices().contains(device, Qt::CaseInsensitive);
+    return ExclusionSet::current()->isDeviceExcluded(device);
+}
+
+QStringList Config::getLegacyExcludedDeviceNames() const {
+    return settings_.value("excludedDevices", QStringList()).toStringList();
+}
+
+void Config::setLegacyExcludedDeviceNames(const QStringList& names) {
+    if (names.isEmpty()) {
+        settings_.remove("excludedDevices");
+        Logger::log("Legacy excluded device names cleared");
+    } else {
+        settings_.setValue("excludedDevices", names);
+        Logger::log(QString("Legacy excluded device names pending migration: %1").arg(names.join(", ")));
+    }
+    publishExclusions();
 }
 
 QStringList Config::getExcludedProcesses() const {
@@ -54,36 +72,12 @@ QStringList Config::getExcludedProcesses() const {
 
 void Config::setExcludedProcesses(const QStringList& processes) {
     settings_.setValue("excludedProcesses", processes);
+    publishExclusions();
     Logger::log(QString("Excluded processes saved: %1").arg(processes.join(", ")));
 }
 
 bool Config::isProcessExcluded(const QString& process) const {
-    QStringList excludedProcesses = getExcludedProcesses();
-    
-    // Check exact match first
-    if (excludedProcesses.contains(process, Qt::CaseInsensitive)) {
-        return true;
-    }
-    
-    // Check normalized match (remove .exe extension if present)
-    QString normalizedProcess = process;
-    if (normalizedProcess.endsWith(".exe", Qt::CaseInsensitive)) {
-        normalizedProcess = normalizedProcess.left(normalizedProcess.length() - 4);
-    }
-    
-    // Check if normalized process name is in the exclusion list
-    for (const QString& excluded : excludedProcesses) {
-        QString normalizedExcluded = excluded;
-        if (normalizedExcluded.endsWith(".exe", Qt::CaseInsensitive)) {
-            normalizedExcluded = normalizedExcluded.left(normalizedExcluded.length() - 4);
-        }
-        
-        if (normalizedProcess.compare(normalizedExcluded, Qt::CaseInsensitive) == 0) {
-            return true;
-        }
-    }
-    
-    return false;
+    return ExclusionSet::current()->isProcessExcluded(process);
 }
 
 bool Config::getMainProcessOnly() const {
@@ -95,6 +89,15 @@ void Config::setMainProcessOnly(bool enabled) {
     Logger::log(QString("Main process only setting saved: %1").arg(enabled ? "enabled" : "disabled"));
 }
 
+bool Config::getMuteProcessFamily() const {
+    return settings_.value("muteProcessFamily", false).toBool();
+}
+
+void Config::setMuteProcessFamily(bool enabled) {
+    settings_.setValue("muteProcessFamily", enabled);
+    Logger::log(QString("Mute process family setting saved: %1").arg(enabled ? "enabled" : "disabled"));
+}
+
 bool Config::getStartupEnabled() const {
     return settings_.value("startupEnabled", false).toBool();
 }
@@ -248,6 +251,42 @@ void Config::setVolumeOSDCustomY(int y) {
     Logger::log(QString("Volume OSD custom Y saved: %1").arg(y));
 }
 
+QString Config::getScanMode() const {
+    return settings_.value("scanMode", "sequential").toString();
+}
+
+void Config::setScanMode(const QString& mode) {
+    settings_.setValue("scanMode", mode);
+    Logger::log(QString("Scan mode saved: %1").arg(mode));
+}
+
+int Config::getScanThreads() const {
+    return settings_.value("scanThreads", 4).toInt();
+}
+
+void Config::setScanThreads(int threads) {
+    settings_.setValue("scanThreads", threads);
+    Logger::log(QString("Scan threads saved: %1").arg(threads));
+}
+
+QString Config::getLogLevel() const {
+    return settings_.value("logLevel", "info").toString();
+}
+
+void Config::setLogLevel(const QString& level) {
+    settings_.setValue("logLevel", level);
+    Logger::log(QString("Log level saved: %1").arg(level));
+}
+
+QString Config::getLogOverflow() const {
+    return settings_.value("logOverflow", "drop-oldest").toString();
+}
+
+void Config::setLogOverflow(const QString& policy) {
+    settings_.setValue("logOverflow", policy);
+    Logger::log(QString("Log overflow policy saved: %1").arg(policy));
+}
+
 void Config::save() {
     settings_.sync();
     Logger::log("All settings saved to registry");
@@ -256,6 +295,7 @@ void Config::save() {
     Logger::log(QString("Current settings:"));
     Logger::log(QString("  Hotkey: %1").arg(getHotkey()));
     Logger::log(QString("  Main process only: %1").arg(getMainProcessOnly() ? "true" : "false"));
+    Logger::log(QString("  Mute process family: %1").arg(getMuteProcessFamily() ? "true" : "false"));
     Logger::log(QString("  Startup enabled: %1").arg(getStartupEnabled() ? "true" : "false"));
     Logger::log(QString("  Startup minimized: %1").arg(getStartupMinimized() ? "true" : "false"));
     Logger::log(QString("  Close to tray: %1").arg(getCloseToTray() ? "true" : "false"));
@@ -269,10 +309,17 @@ void Config::save() {
     Logger::log(QString("  Volume up hotkey: %1").arg(getVolumeUpHotkey()));
     Logger::log(QString("  Volume down hotkey: %1").arg(getVolumeDownHotkey()));
     Logger::log(QString("  Volume step percent: %1").arg(getVolumeStepPercent()));
+    Logger::log(QString("  Scan mode: %1 (%2 threads)").arg(getScanMode()).arg(getScanThreads()));
     Logger::log(QString("  Excluded devices: %1").arg(getExcludedDevices().join(", ")));
     Logger::log(QString("  Excluded processes: %1").arg(getExcludedProcesses().join(", ")));
 }
 
 bool Config::contains(const QString& key) const {
     return settings_.contains(key);
+}
+
+void Config::publishExclusions() {
+    // Legacy names keep excluding their device by name until the UI sees it and migrates the rule
+    ExclusionSet::publish(std::make_shared<const ExclusionSet>(getExcludedProcesses(), getExcludedDevices(),
+                                                               getLegacyExcludedDeviceNames()));
 } 
@@ -11,12 +11,16 @@ public:
     QString getHotkey() const;
     void setHotkey(const QString& hotkey);
     
-    // Device exclusion settings
+    // Device exclusion settings, by endpoint ID
     QStringList getExcludedDevices() const;
     void setExcludedDevices(const QStringList& devices);
     void addExcludedDevice(const QString& device);
     void removeExcludedDevice(const QString& device);
     bool isDeviceExcluded(const QString& device) const;
+    // Exclusions saved by friendly name before they were keyed by endpoint ID,
+    // kept until the device is seen again and its ID is known
+    QStringList getLegacyExcludedDeviceNames() const;
+    void setLegacyExcludedDeviceNames(const QStringList& names);
     
     // Process exclusion settings
     QStringList getExcludedProcesses() const;
@@ -27,6 +31,10 @@ public:
     bool getMainProcessOnly() const;
     void setMainProcessOnly(bool enabled);
     
+    // Process family setting
+    bool getMuteProcessFamily() const;
+    void setMuteProcessFamily(bool enabled);
+    
     // Startup behavior settings
     bool getStartupEnabled() const;
     void setStartupEnabled(bool enabled);
@@ -77,6 +85,20 @@ public:
     int getVolumeOSDCustomY() const;
     void setVolumeOSDCustomY(int y);
     
+    // Device scan settings (used when the session index is unavailable)
+    QString getScanMode() const;
+    void setScanMode(const QString& mode);
+    int getScanThreads() const;
+    void setScanThreads(int threads);
+    
+    // Logging threshold: "trace", "debug", "info", "warning", "error" or "off"
+    QString getLogLevel() const;
+    void setLogLevel(const QString& level);
+    
+    // What logging does when the writer falls behind: "drop-oldest" or "block"
+    QString getLogOverflow() const;
+    void setLogOverflow(const QString& policy);
+    
     // Check if setting exists
     bool contains(const QString& key) const;
     
@@ -88,6 +110,9 @@ private:
     ~Config() = default;
     Config(const Config&) = delete;
     Config& operator=(const Config&) = delete;
+
+    // Rebuilds the ExclusionSet snapshot; called whenever an exclusion list changes
+    void publishExclusions();
     
     QSettings settings_;
 }; 
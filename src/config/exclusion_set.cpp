@@ -0,0 +1,94 @@
+#include "exclusion_set.h"
+#include <atomic>
+#include <utility>
+
+static std::shared_ptr<const ExclusionSet>& currentSnapshot() {
+    static std::shared_ptr<const ExclusionSet> snapshot = std::make_shared<const ExclusionSet>();
+    return snapshot;
+}
+
+void ExclusionSet::FoldedSet::insert(QStringView value) {
+    QStringList& bucket = buckets_[foldedHash(value)];
+    for (const QString& existing : bucket) {
+        if (value.compare(existing, Qt::CaseInsensitive) == 0) {
+            return;
+        }
+    }
+    bucket.append(value.toString().toCaseFolded());
+}
+
+bool ExclusionSet::FoldedSet::contains(QStringView value) const {
+    const auto it = buckets_.constFind(foldedHash(value));
+    if (it == buckets_.constEnd()) {
+        return false;
+    }
+    for (const QString& existing : it.value()) {
+        if (value.compare(existing, Qt::CaseInsensitive) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+quint64 ExclusionSet::FoldedSet::foldedHash(QStringView value) {
+    // FNV-1a over case-folded code points, the folding compare() uses
+    quint64 hash = 14695981039346656037ull;
+    for (qsizetype i = 0; i < value.size(); ++i) {
+        char32_t ucs4 = value[i].unicode();
+        if (QChar::isHighSurrogate(ucs4) && i + 1 < value.size() && value[i + 1].isLowSurrogate()) {
+            ucs4 = QChar::surrogateToUcs4(value[i].unicode(), value[i + 1].unicode());
+            ++i;
+        }
+        hash = (hash ^ QChar::toCaseFolded(ucs4)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+ExclusionSet::ExclusionSet(const QStringList& processes, const QStringList& deviceIds,
+                           const QStringList& legacyDeviceNames) {
+    processes_.reserve(processes.size());
+    for (const QString& process : processes) {
+        const QStringView key = stripExe(QStringView(process).trimmed());
+        if (!key.isEmpty()) {
+            processes_.insert(key);
+        }
+    }
+    devices_.reserve(deviceIds.size());
+    for (const QString& deviceId : deviceIds) {
+        devices_.insert(deviceId);
+    }
+    deviceNames_.reserve(legacyDeviceNames.size());
+    for (const QString& name : legacyDeviceNames) {
+        deviceNames_.insert(name);
+    }
+}
+
+bool ExclusionSet::isProcessExcluded(const QString& name) const {
+    return !processes_.isEmpty() && processes_.contains(stripExe(name));
+}
+
+bool ExclusionSet::isDeviceExcluded(const QString& deviceId, const QString& deviceName) const {
+    if (!devices_.isEmpty() && devices_.contains(deviceId)) {
+        return true;
+    }
+    return !deviceNames_.isEmpty() && !deviceName.isEmpty() && deviceNames_.contains(deviceName);
+}
+
+QStringView ExclusionSet::stripExe(QStringView name) {
+    return name.endsWith(u".exe", Qt::CaseInsensitive) ? name.chopped(4) : name;
+}
+
+QString ExclusionSet::normalizeProcessName(const QString& name) {
+    return stripExe(name).toString().toCaseFolded();
+}
+
+std::shared_ptr<const ExclusionSet> ExclusionSet::current() {
+    return std::atomic_load(&currentSnapshot());
+}
+
+void ExclusionSet::publish(std::shared_ptr<const ExclusionSet> set) {
+    if (!set) {
+        set = std::make_shared<const ExclusionSet>();
+    }
+    std::atomic_store(&currentSnapshot(), std::move(set));
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <memory>
+
+// Precompiled view of the exclusion settings: case-insensitive hash sets built
+// once per settings change. Checks run for every session on every hotkey
+// press, so they fold case as they hash and compare rather than allocating a
+// folded copy. Snapshots are immutable, so any thread can check exclusions
+// against the one it holds while Config publishes a new one.
+class ExclusionSet {
+public:
+    ExclusionSet() = default;
+    // `legacyDeviceNames`: name-based device rules from before exclusions
+    // were kept by endpoint ID, matched by friendly name until migrated
+    ExclusionSet(const QStringList& processes, const QStringList& deviceIds,
+                 const QStringList& legacyDeviceNames = QStringList());
+
+    // `name` may carry ".exe" and any case
+    bool isProcessExcluded(const QString& name) const;
+    // `key` as produced by normalizeProcessName(); a single hash lookup
+    bool isProcessKeyExcluded(const QString& key) const { return processes_.contains(key); }
+    // `deviceName` is only consulted for legacy name-based rules
+    bool isDeviceExcluded(const QString& deviceId, const QString& deviceName = QString()) const;
+
+    bool hasProcesses() const { return !processes_.isEmpty(); }
+    bool hasDevices() const { return !devices_.isEmpty() || !deviceNames_.isEmpty(); }
+
+    // Lookup key for a process name: ".exe" stripped, case-folded
+    static QString normalizeProcessName(const QString& name);
+
+    // Snapshot in effect now; never null
+    static std::shared_ptr<const ExclusionSet> current();
+    // Replace the snapshot; readers holding the old one are unaffected
+    static void publish(std::shared_ptr<const ExclusionSet> set);
+
+private:
+    // Strings matched regardless of case
+    class FoldedSet {
+    public:
+        void reserve(int size) { buckets_.reserve(size); }
+        void insert(QStringView value);
+        bool contains(QStringView value) const;
+        bool isEmpty() const { return buckets_.isEmpty(); }
+
+    private:
+        // Equal for any two strings that compare equal case-insensitively
+        static quint64 foldedHash(QStringView value);
+
+        // By folded hash; more than one string only on a collision
+        QHash<quint64, QStringList> buckets_;
+    };
+
+    // `name` without a trailing ".exe"
+    static QStringView stripExe(QStringView name);
+
+    FoldedSet processes_;
+    FoldedSet devices_;
+    FoldedSet deviceNames_;
+};
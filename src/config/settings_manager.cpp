@@ -41,6 +41,12 @@ void SettingsManager::migrateSettings() {
         Logger::log("Added missing setting 'mainProcessOnly' with default value: false");
     }
     
+    if (!config_.contains("muteProcessFamily")) {
+        config_.setMuteProcessFamily(false);
+        needsSave = true;
+        Logger::log("Added missing setting 'muteProcessFamily' with default value: false");
+    }
+    
     if (!config_.contains("startupEnabled")) {
         config_.setStartupEnabled(false);
         needsSave = true;
@@ -59,10 +65,10 @@ void SettingsManager::migrateSettings() {
         Logger::log("Added missing setting 'closeToTray' with default value: true");
     }
     
-    if (!config_.contains("excludedDevices")) {
+    if (!config_.contains("excludedDeviceIds")) {
         config_.setExcludedDevices(QStringList());
         needsSave = true;
-        Logger::log("Added missing setting 'excludedDevices' with default value: empty list");
+        Logger::log("Added missing setting 'excludedDeviceIds' with default value: empty list");
     }
     
     if (!config_.contains("excludedProcesses")) {
@@ -155,6 +161,18 @@ void SettingsManager::migrateSettings() {
         Logger::log("Added missing setting 'volumeOSDCustomY' with default value: -1");
     }
     
+    if (!config_.contains("scanMode")) {
+        config_.setScanMode("sequential");
+        needsSave = true;
+        Logger::log("Added missing setting 'scanMode' with default value: sequential");
+    }
+    
+    if (!config_.contains("scanThreads")) {
+        config_.setScanThreads(4);
+        needsSave = true;
+        Logger::log("Added missing setting 'scanThreads' with default value: 4");
+    }
+    
     if (needsSave) {
         config_.save();
         Logger::log("Settings migration completed - new defaults applied");
@@ -171,6 +189,10 @@ bool SettingsManager::getMainProcessOnly() const {
     return config_.getMainProcessOnly();
 }
 
+bool SettingsManager::getMuteProcessFamily() const {
+    return config_.getMuteProcessFamily();
+}
+
 bool SettingsManager::getStartupEnabled() const {
     return config_.getStartupEnabled();
 }
@@ -239,10 +261,30 @@ int SettingsManager::getVolumeOSDCustomY() const {
     return config_.getVolumeOSDCustomY();
 }
 
+QString SettingsManager::getScanMode() const {
+    return config_.getScanMode();
+}
+
+int SettingsManager::getScanThreads() const {
+    return config_.getScanThreads();
+}
+
+QString SettingsManager::getLogLevel() const {
+    return config_.getLogLevel();
+}
+
+QString SettingsManager::getLogOverflow() const {
+    return config_.getLogOverflow();
+}
+
 QStringList SettingsManager::getExcludedDevices() const {
     return config_.getExcludedDevices();
 }
 
+QStringList SettingsManager::getLegacyExcludedDeviceNames() const {
+    return config_.getLegacyExcludedDeviceNames();
+}
+
 QStringList SettingsManager::getExcludedProcesses() const {
     return config_.getExcludedProcesses();
 }
@@ -257,6 +299,11 @@ void SettingsManager::setMainProcessOnly(bool enabled) {
     emit settingsChanged();
 }
 
+void SettingsManager::setMuteProcessFamily(bool enabled) {
+    config_.setMuteProcessFamily(enabled);
+    emit settingsChanged();
+}
+
 void SettingsManager::setStartupEnabled(bool enabled) {
     config_.setStartupEnabled(enabled);
     setupStartupRegistry();
@@ -343,6 +390,16 @@ void SettingsManager::setVolumeOSDCustomY(int y) {
     emit settingsChanged();
 }
 
+void SettingsManager::setScanMode(const QString& mode) {
+    config_.setScanMode(mode);
+    emit settingsChanged();
+}
+
+void SettingsManager::setScanThreads(int threads) {
+    config_.setScanThreads(threads);
+    emit settingsChanged();
+}
+
 void SettingsManager::setExcludedDevices(const QStringList& devices) {
     config_.setExcludedDevices(devices);
     emit settingsChanged();
@@ -358,6 +415,11 @@ void SettingsManager::removeExcludedDevice(const QString& device) {
     emit settingsChanged();
 }
 
+void SettingsManager::setLegacyExcludedDeviceNames(const QStringList& names) {
+    config_.setLegacyExcludedDeviceNames(names);
+    emit settingsChanged();
+}
+
 void SettingsManager::setExcludedProcesses(const QStringList& processes) {
     config_.setExcludedProcesses(processes);
     emit settingsChanged();
@@ -19,12 +19,14 @@ public:
     // Get current settings
     QString getHotkey() const;
     bool getMainProcessOnly() const;
+    bool getMuteProcessFamily() const;
     bool getStartupEnabled() const;
     bool getStartupMinimized() const;
     bool getCloseToTray() const;
     bool getDarkMode() const;
     bool getShowNotifications() const;
     QStringList getExcludedDevices() const;
+    QStringList getLegacyExcludedDeviceNames() const;
     QStringList getExcludedProcesses() const;
     bool getAutoUpdateCheck() const;
     bool getUseHook() const;
@@ -38,10 +40,15 @@ public:
     QString getVolumeOSDPosition() const;
     int getVolumeOSDCustomX() const;
     int getVolumeOSDCustomY() const;
+    QString getScanMode() const;
+    int getScanThreads() const;
+    QString getLogLevel() const;
+    QString getLogOverflow() const;
     
     // Set settings
     void setHotkey(const QString& hotkey);
     void setMainProcessOnly(bool enabled);
+    void setMuteProcessFamily(bool enabled);
     void setStartupEnabled(bool enabled);
     void setStartupMinimized(bool enabled);
     void setCloseToTray(bool enabled);
@@ -59,9 +66,12 @@ public:
     void setVolumeOSDPosition(const QString& position);
     void setVolumeOSDCustomX(int x);
     void setVolumeOSDCustomY(int y);
+    void setScanMode(const QString& mode);
+    void setScanThreads(int threads);
     void setExcludedDevices(const QStringList& devices);
     void addExcludedDevice(const QString& device);
     void removeExcludedDevice(const QString& device);
+    void setLegacyExcludedDeviceNames(const QStringList& names);
     void setExcludedProcesses(const QStringList& processes);
     
     // Registry operations
@@ -1,6 +1,8 @@
 #include "mainwindow.h"
 #include "settings_manager.h"
 #include "theme_manager.h"
+#include "logger.h"
+#include "flight_recorder.h"
 #include <QApplication>
 #include <QIcon>
 #include <QDir>
@@ -61,9 +63,17 @@ int main(int argc, char *argv[])
     
     a.setQuitOnLastWindowClosed(false);
     
-    MainWindow w;
+    int result = 0;
+    {
+        MainWindow w;
+        
+        // Don't show immediately - let MainWindow constructor handle it
+        // based on the startup minimized setting
+        result = a.exec();
+    }
     
-    // Don't show immediately - let MainWindow constructor handle it
-    // based on the startup minimized setting
-    return a.exec();
+    // Write out whatever the window logged while shutting down
+    Logger::shutdown();
+    FlightRecorder::close();
+    return result;
 }
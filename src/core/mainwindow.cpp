@@ -1,7 +1,13 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "logger.h"
+#include "flight_recorder.h"
+#include "foreground_tracker.h"
+#include "latency_dialog.h"
+#include "latency_stats.h"
+#include "trace_recorder.h"
 #include "process_selection_dialog.h"
+#include "wasapi_audio_backend.h"
 #include <Windows.h>
 #include <QSettings>
 #include <QLineEdit>
@@ -35,6 +41,7 @@
 #include <QFile>
 #include <QTextStream>
 #include <QTimer>
+#include <QDateTime>
 #include <QClipboard>
 #include <QSizePolicy>
 #include <QHeaderView>
@@ -51,6 +58,9 @@ static constexpr int HOTKEY_ID = 0xBEEF;
 static constexpr int VOLUME_UP_HOTKEY_ID = 0xBEE1;
 static constexpr int VOLUME_DOWN_HOTKEY_ID = 0xBEE2;
 static constexpr int ADMIN_RESTART_HOTKEY_ID = 0xBEE3;
+// Hook hotkeys sharing a key combination fire in this order of precedence,
+// as the old per-action checks did; the IDs above sort differently
+enum HookHotkeyPriority { MutePriority, VolumeUpPriority, VolumeDownPriority, AdminRestartPriority };
 
 MainWindow* MainWindow::clickDetectionInstance_ = nullptr;
 
@@ -98,8 +108,25 @@ static QString joinWindowsArguments(const QStringList& args) {
     return quoted.join(' ');
 }
 
+// Display names for excluded endpoint IDs; devices that are not connected show their ID
+static QStringList excludedDeviceNames(const QStringList& deviceIds, const QVector<AudioDeviceInfo>& devices) {
+    QStringList names;
+    names.reserve(deviceIds.size());
+    for (const QString& deviceId : deviceIds) {
+        QString name = QString("%1 (not connected)").arg(deviceId);
+        for (const AudioDeviceInfo& device : devices) {
+            if (device.id.compare(deviceId, Qt::CaseInsensitive) == 0) {
+                name = device.name;
+                break;
+            }
+        }
+        names.append(name);
+    }
+    return names;
+}
+
 MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent), ui(new Ui::MainWindow), hotkeyId_(HOTKEY_ID), volumeUpHotkeyId_(VOLUME_UP_HOTKEY_ID), volumeDownHotkeyId_(VOLUME_DOWN_HOTKEY_ID), adminRestartHotkeyId_(ADMIN_RESTART_HOTKEY_ID), settingsManager_(SettingsManager::instance()), trayIcon_(nullptr), trayMenu_(nullptr), mouseHookHandle_(nullptr), clickDetectionTimer_(nullptr), waitingForClick_(false), clickDetectionMessageBox_(nullptr), clickDetectionMessageBoxHandle_(nullptr) {
+    : QMainWindow(parent), ui(new Ui::MainWindow), audioEngine_([] { return std::unique_ptr<AudioBackend>(new WasapiAudioBackend()); }), hotkeyId_(HOTKEY_ID), volumeUpHotkeyId_(VOLUME_UP_HOTKEY_ID), volumeDownHotkeyId_(VOLUME_DOWN_HOTKEY_ID), adminRestartHotkeyId_(ADMIN_RESTART_HOTKEY_ID), settingsManager_(SettingsManager::instance()), trayIcon_(nullptr), trayMenu_(nullptr), mouseHookHandle_(nullptr), clickDetectionTimer_(nullptr), waitingForClick_(false), clickDetectionMessageBox_(nullptr), clickDetectionMessageBoxHandle_(nullptr), volumeStepTimer_(nullptr), pendingVolumeSteps_(0), volumeCommandInFlight_(0) {
     Logger::log("=== MainWindow Constructor ===");
     ui->setupUi(this);
     if (isRunningAsAdmin()) {
@@ -111,6 +138,16 @@ MainWindow::MainWindow(QWidget *parent)
 
     Logger::init(QCoreApplication::applicationDirPath() + "/app.log");
     Logger::log("=== App started ===");
+    // Hot-path logging is debug/trace level; "logLevel" in the registry turns it on
+    Logger::setLevel(Logger::levelFromString(settingsManager_.getLogLevel()));
+    Logger::setOverflowPolicy(Logger::overflowFromString(settingsManager_.getLogOverflow()));
+    // Unlike app.log, the flight recorder keeps the previous runs' events
+    if (FlightRecorder::open(QCoreApplication::applicationDirPath() + "/flight.bin")) {
+        FlightRecord started;
+        started.event = FlightEvent::AppStart;
+        started.pid = static_cast<quint32>(QCoreApplication::applicationPid());
+        FlightRecorder::record(started);
+    }
 
     // Initialize settings manager (handles defaults and migration)
     settingsManager_.initializeDefaults();
@@ -126,6 +163,8 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->refreshDevicesButton, &QPushButton::clicked, this, &MainWindow::refreshDevices);
     connect(ui->openApplicationFolderButton, &QPushButton::clicked, this, &MainWindow::openApplicationFolder);
     connect(ui->copyRegistryPathButton, &QPushButton::clicked, this, &MainWindow::copyRegistryPath);
+    connect(ui->latencyDiagnosticsButton, &QPushButton::clicked, this, &MainWindow::showLatencyDiagnostics);
+    connect(ui->traceCaptureButton, &QPushButton::clicked, this, &MainWindow::toggleTraceCapture);
     connect(ui->addProcessButton, &QPushButton::clicked, this, &MainWindow::addManualProcess);
     connect(ui->addCurrentProcessButton, &QPushButton::clicked, this, &MainWindow::addCurrentProcess);
     connect(ui->removeProcessButton, &QPushButton::clicked, this, &MainWindow::removeSelectedProcess);
@@ -144,15 +183,34 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->autoUpdateCheckBox, &QCheckBox::toggled, this, &MainWindow::saveSettings);
     connect(ui->darkModeCheck, &QCheckBox::toggled, this, &MainWindow::onDarkModeChanged);
     connect(ui->useHookCheck, &QCheckBox::toggled, this, &MainWindow::onUseHookChanged);
+    connect(ui->parallelScanCheck, &QCheckBox::toggled, this, [this](bool enabled) {
+        ui->scanThreadsSpinBox->setEnabled(enabled);
+        saveSettings();
+    });
+    connect(ui->scanThreadsSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &MainWindow::saveSettings);
     connect(ui->adminRestartHotkeyEnabledCheck, &QCheckBox::toggled, this, [this](bool enabled) {
         ui->adminRestartHotkeyEdit->setEnabled(enabled);
     });
     
-    // Connect keyboard hook signals
-    connect(&KeyboardHook::instance(), &KeyboardHook::hotkeyTriggered, this, &MainWindow::onHotkeyTriggered);
-    connect(&KeyboardHook::instance(), &KeyboardHook::volumeUpTriggered, this, &MainWindow::onVolumeUpTriggered);
-    connect(&KeyboardHook::instance(), &KeyboardHook::volumeDownTriggered, this, &MainWindow::onVolumeDownTriggered);
-    connect(&KeyboardHook::instance(), &KeyboardHook::adminRestartTriggered, this, &MainWindow::onAdminRestartTriggered);
+    // Both hotkey paths report the IDs registered below
+    hotkeyActions_.insert(hotkeyId_, &MainWindow::onHotkeyTriggered);
+    hotkeyActions_.insert(volumeUpHotkeyId_, &MainWindow::onVolumeUpTriggered);
+    hotkeyActions_.insert(volumeDownHotkeyId_, &MainWindow::onVolumeDownTriggered);
+    hotkeyActions_.insert(adminRestartHotkeyId_, &MainWindow::onAdminRestartTriggered);
+    connect(&KeyboardHook::instance(), &KeyboardHook::actionTriggered, this, &MainWindow::onHotkeyAction);
+    // Hotkeys read the target resolved when focus last changed
+    ForegroundTracker::instance().start();
+
+    // Audio work runs on the engine thread; results arrive as queued signals
+    connect(&audioEngine_, &AudioEngine::muteToggled, this, &MainWindow::onMuteToggled);
+    connect(&audioEngine_, &AudioEngine::volumeAdjusted, this, &MainWindow::onVolumeAdjusted);
+    connect(&audioEngine_, &AudioEngine::devicesListed, this, &MainWindow::onDevicesListed);
+    audioEngine_.start();
+    
+    // Volume hotkeys are applied in batches, at most once per interval
+    volumeStepTimer_ = new QTimer(this);
+    volumeStepTimer_->setSingleShot(true);
+    connect(volumeStepTimer_, &QTimer::timeout, this, &MainWindow::flushVolumeSteps);
     
     // Connect volume control checkboxes
     connect(ui->volumeControlEnabledCheck, &QCheckBox::toggled, this, &MainWindow::onVolumeControlEnabledChanged);
@@ -231,6 +289,12 @@ MainWindow::~MainWindow() {
     }
     cleanupClickDetection();
     unregisterHotkey();
+    ForegroundTracker::instance().stop();
+    audioEngine_.stop();
+    // Keep a capture left running at exit
+    if (TraceRecorder::isEnabled()) {
+        TraceRecorder::stop(traceCapturePath());
+    }
     
     // Clean up system tray
     if (trayIcon_) {
@@ -267,6 +331,11 @@ void MainWindow::loadSettings() {
     ui->mainProcessOnlyCheck->setChecked(mainProcessOnly);
     Logger::log(QString("Loaded PID-based muting setting: %1").arg(mainProcessOnly ? "enabled" : "disabled"));
     
+    // Load process family setting
+    bool muteProcessFamily = settingsManager_.getMuteProcessFamily();
+    ui->processFamilyCheck->setChecked(muteProcessFamily);
+    Logger::log(QString("Loaded process family muting setting: %1").arg(muteProcessFamily ? "enabled" : "disabled"));
+    
     // Load startup behavior settings
     bool startupEnabled = settingsManager_.getStartupEnabled();
     ui->startupCheck->setChecked(startupEnabled);
@@ -296,6 +365,15 @@ void MainWindow::loadSettings() {
     ui->useHookCheck->setChecked(useHook);
     Logger::log(QString("Loaded use hook setting: %1").arg(useHook ? "enabled" : "disabled"));
 
+    // Load device scan settings
+    AudioMuter::ScanMode scanMode = AudioMuter::scanModeFromString(settingsManager_.getScanMode());
+    int scanThreads = settingsManager_.getScanThreads();
+    ui->parallelScanCheck->setChecked(scanMode == AudioMuter::ScanMode::Parallel);
+    ui->scanThreadsSpinBox->setValue(scanThreads);
+    ui->scanThreadsSpinBox->setEnabled(scanMode == AudioMuter::ScanMode::Parallel);
+    audioEngine_.setScanMode(scanMode, scanThreads);
+    Logger::log(QString("Loaded scan mode setting: %1 (%2 threads)").arg(AudioMuter::scanModeToString(scanMode)).arg(scanThreads));
+
     bool adminRestartEnabled = settingsManager_.getAdminRestartHotkeyEnabled();
     ui->adminRestartHotkeyEnabledCheck->setChecked(adminRestartEnabled);
     ui->adminRestartHotkeyEdit->setEnabled(adminRestartEnabled);
@@ -389,6 +467,7 @@ void MainWindow::saveSettings() {
     
     // Save main process only setting
     settingsManager_.setMainProcessOnly(ui->mainProcessOnlyCheck->isChecked());
+    settingsManager_.setMuteProcessFamily(ui->processFamilyCheck->isChecked());
     
     // Save startup behavior settings
     settingsManager_.setStartupEnabled(ui->startupCheck->isChecked());
@@ -406,6 +485,12 @@ void MainWindow::saveSettings() {
     // Save use hook setting
     settingsManager_.setUseHook(ui->useHookCheck->isChecked());
 
+    // Save device scan settings
+    AudioMuter::ScanMode scanMode = ui->parallelScanCheck->isChecked() ? AudioMuter::ScanMode::Parallel : AudioMuter::ScanMode::Sequential;
+    settingsManager_.setScanMode(AudioMuter::scanModeToString(scanMode));
+    settingsManager_.setScanThreads(ui->scanThreadsSpinBox->value());
+    audioEngine_.setScanMode(scanMode, ui->scanThreadsSpinBox->value());
+
     // Save admin restart hotkey enabled setting
     settingsManager_.setAdminRestartHotkeyEnabled(ui->adminRestartHotkeyEnabledCheck->isChecked());
     
@@ -516,10 +601,12 @@ void MainWindow::applySettings() {
     QMessageBox::information(this, "Settings Saved", 
         QString("Hotkey '%1' has been saved successfully!\n\n"
                 "PID-based muting: %2\n"
-                "Excluded devices: %3")
+                "Process family muting: %3\n"
+                "Excluded devices: %4")
         .arg(currentSeq_.toString())
         .arg(ui->mainProcessOnlyCheck->isChecked() ? "Enabled" : "Disabled")
-        .arg(settingsManager_.getExcludedDevices().join(", ")));
+        .arg(ui->processFamilyCheck->isChecked() ? "Enabled" : "Disabled")
+        .arg(excludedDeviceNames(settingsManager_.getExcludedDevices(), knownDevices_).join(", ")));
     
     Logger::log(QString("Hotkey set to %1").arg(currentSeq_.toString()));
 }
@@ -536,22 +623,22 @@ void MainWindow::registerHotkey() {
     
     if (useHook) {
         Logger::log("Using hook-based hotkey detection");
-        KeyboardHook::instance().setHotkey(currentSeq_);
+        KeyboardHook::instance().setBinding(hotkeyId_, currentSeq_, HotkeyMatcher::Edge, MutePriority);
         
         // Also set volume hotkeys if enabled
         if (settingsManager_.getVolumeControlEnabled()) {
             if (!volumeUpSeq_.isEmpty()) {
-                KeyboardHook::instance().setVolumeUpHotkey(volumeUpSeq_);
+                KeyboardHook::instance().setBinding(volumeUpHotkeyId_, volumeUpSeq_, HotkeyMatcher::Repeat, VolumeUpPriority);
             }
             if (!volumeDownSeq_.isEmpty()) {
-                KeyboardHook::instance().setVolumeDownHotkey(volumeDownSeq_);
+                KeyboardHook::instance().setBinding(volumeDownHotkeyId_, volumeDownSeq_, HotkeyMatcher::Repeat, VolumeDownPriority);
             }
         }
         
         if (adminRestartEnabled && !adminRestartSeq_.isEmpty()) {
-            KeyboardHook::instance().setAdminRestartHotkey(adminRestartSeq_);
+            KeyboardHook::instance().setBinding(adminRestartHotkeyId_, adminRestartSeq_, HotkeyMatcher::Edge, AdminRestartPriority);
         } else {
-            KeyboardHook::instance().clearAdminRestartHotkey();
+            KeyboardHook::instance().clearBinding(adminRestartHotkeyId_);
         }
         
         if (KeyboardHook::instance().installHook()) {
@@ -663,6 +750,9 @@ void MainWindow::registerHotkeyNormal() {
         return;
     }
     
+    // Holding the hotkey toggles once, as in the hook path
+    mods |= MOD_NOREPEAT;
+    
     Logger::log(QString("Final registration: mods=0x%1, vk=0x%2, hotkeyId=%3").arg(mods, 0, 16).arg(winVk, 0, 16).arg(hotkeyId_));
     
     if (!RegisterHotKey(hwnd, hotkeyId_, mods, winVk)) {
@@ -716,172 +806,88 @@ bool MainWindow::nativeEvent(const QByteArray &eventType, void *message, qintptr
         
         // Log all Windows messages for debugging
         if (msg->message == WM_HOTKEY) {
-            Logger::log(QString("WM_HOTKEY received: wParam=0x%1, lParam=0x%2").arg(msg->wParam, 0, 16).arg(msg->lParam, 0, 16));
+            LOG_DEBUG(Hotkey, QString("WM_HOTKEY received: wParam=0x%1, lParam=0x%2").arg(msg->wParam, 0, 16).arg(msg->lParam, 0, 16));
             
-            if (msg->wParam == hotkeyId_) {
-                Logger::log("Hotkey ID matches! Triggering onHotkeyTriggered()");
-                onHotkeyTriggered();
-                *result = 0;
-                return true;
-            } else if (msg->wParam == volumeUpHotkeyId_) {
-                Logger::log("Volume up hotkey ID matches! Triggering onVolumeUpTriggered()");
-                onVolumeUpTriggered();
-                *result = 0;
-                return true;
-            } else if (msg->wParam == volumeDownHotkeyId_) {
-                Logger::log("Volume down hotkey ID matches! Triggering onVolumeDownTriggered()");
-                onVolumeDownTriggered();
-                *result = 0;
-                return true;
-            } else if (msg->wParam == adminRestartHotkeyId_) {
-                Logger::log("Admin restart hotkey ID matches! Triggering onAdminRestartTriggered()");
-                onAdminRestartTriggered();
+            if (onHotkeyAction(static_cast<int>(msg->wParam))) {
                 *result = 0;
                 return true;
-            } else {
-                Logger::log(QString("Hotkey ID mismatch: expected %1, %2, %3, or %4, got %5")
-                                .arg(hotkeyId_)
-                                .arg(volumeUpHotkeyId_)
-                                .arg(volumeDownHotkeyId_)
-                                .arg(adminRestartHotkeyId_)
-                                .arg(msg->wParam));
             }
+            LOG_WARNING(Hotkey, QString("Hotkey ID mismatch: expected %1, %2, %3, or %4, got %5")
+                            .arg(hotkeyId_)
+                            .arg(volumeUpHotkeyId_)
+                            .arg(volumeDownHotkeyId_)
+                            .arg(adminRestartHotkeyId_)
+                            .arg(msg->wParam));
         }
         
         // Log other interesting messages
         if (msg->message == WM_KEYDOWN || msg->message == WM_KEYUP) {
-            Logger::log(QString("Key event: message=0x%1, wParam=0x%2, lParam=0x%3").arg(msg->message, 0, 16).arg(msg->wParam, 0, 16).arg(msg->lParam, 0, 16));
+            LOG_TRACE(Hotkey, QString("Key event: message=0x%1, wParam=0x%2, lParam=0x%3").arg(msg->message, 0, 16).arg(msg->wParam, 0, 16).arg(msg->lParam, 0, 16));
         }
     }
     return QMainWindow::nativeEvent(eventType, message, result);
 }
 
-QString MainWindow::getMainProcessName(DWORD pid) {
-    QString exeName = "(unknown)";
-    HANDLE h = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
-    if (h != nullptr) {
-        WCHAR buf[MAX_PATH];
-        DWORD len = MAX_PATH;
-        if (QueryFullProcessImageNameW(h, 0, buf, &len)) {
-            exeName = QFileInfo(QString::fromWCharArray(buf)).fileName();
-            
-            // Check if this is ApplicationFrameHost.exe (UWP app)
-            if (exeName == "ApplicationFrameHost.exe") {
-                Logger::log("Detected ApplicationFrameHost.exe, attempting to get UWP app name");
-                // Try to get the actual UWP app name
-                QString uwpAppName = getUWPAppName(pid);
-                if (!uwpAppName.isEmpty()) {
-                    exeName = uwpAppName;
-                    Logger::log(QString("UWP app detected, using app name: %1").arg(exeName));
-                } else {
-                    Logger::log("Failed to get UWP app name, keeping ApplicationFrameHost.exe");
-                }
-            }
-        }
-        CloseHandle(h);
+bool MainWindow::onHotkeyAction(int actionId) {
+    const auto handler = hotkeyActions_.constFind(actionId);
+    if (handler == hotkeyActions_.constEnd()) {
+        return false;
     }
-    return exeName;
+    LOG_DEBUG(Hotkey, QString("Hotkey ID 0x%1 matches, dispatching").arg(actionId, 0, 16));
+    (this->*handler.value())();
+    return true;
 }
 
-QString MainWindow::getUWPAppName(DWORD pid) {
-    QString appName;
-    
-    // Get the foreground window
-    HWND fgWindow = GetForegroundWindow();
-    if (!fgWindow) {
-        Logger::log("Failed to get foreground window for UWP detection");
-        return appName;
-    }
-    
-    Logger::log(QString("Foreground window: 0x%1").arg((quintptr)fgWindow, 0, 16));
-    
-    // Enumerate child windows to find the actual UWP app process
-    Logger::log("Enumerating child windows to find UWP app process");
-    
-    // Callback function to enumerate child windows
-    struct EnumData {
-        DWORD mainPid;
-        QString* result;
-    };
-    
-    auto enumChildProc = [](HWND hwnd, LPARAM lParam) -> BOOL {
-        EnumData* data = reinterpret_cast<EnumData*>(lParam);
-        
-        DWORD childPid = 0;
-        if (GetWindowThreadProcessId(hwnd, &childPid)) {
-            if (childPid != data->mainPid) {
-                HANDLE h = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, childPid);
-                if (h != nullptr) {
-                    WCHAR buf[MAX_PATH];
-                    DWORD len = MAX_PATH;
-                    if (QueryFullProcessImageNameW(h, 0, buf, &len)) {
-                        QString childExeName = QFileInfo(QString::fromWCharArray(buf)).fileName();
-                        Logger::log(QString("Child window PID: %1, EXE: %2").arg(childPid).arg(childExeName));
-                        
-                        // If this is not ApplicationFrameHost and not a system process, use it
-                        if (childExeName != "ApplicationFrameHost.exe" && 
-                            !childExeName.contains("System") && 
-                            !childExeName.contains("svchost") &&
-                            !childExeName.contains("explorer")) {
-                            *data->result = childExeName;
-                            Logger::log(QString("Found UWP app process: %1").arg(*data->result));
-                            CloseHandle(h);
-                            return FALSE; // Stop enumeration
-                        }
-                    }
-                    CloseHandle(h);
-                }
-            }
-        }
-        return TRUE; // Continue enumeration
-    };
-    
-    EnumData enumData = { pid, &appName };
-    EnumChildWindows(fgWindow, enumChildProc, reinterpret_cast<LPARAM>(&enumData));
-    
-    if (appName.isEmpty()) {
-        Logger::log("No suitable child window process found");
+bool MainWindow::resolveForegroundTarget(AudioTarget* target) {
+    // Usually resolved when focus arrived; this only confirms it
+    ForegroundTracker::Target foreground;
+    if (!ForegroundTracker::instance().current(&foreground)) {
+        return false;
     }
-    
-    return appName;
+    target->pid = foreground.pid;
+    target->exeName = foreground.exeName;
+    // PID-based muting tries the specific PID first, falling back to the executable name
+    target->preferPid = ui->mainProcessOnlyCheck->isChecked();
+    // Family muting also takes the processes the target started, such as browser renderers
+    target->preferFamily = ui->processFamilyCheck->isChecked();
+    return true;
 }
 
 void MainWindow::onHotkeyTriggered() {
-    Logger::log("=== Hotkey Triggered ===");
-    HWND fg = GetForegroundWindow();
-    if (!fg) {
-        Logger::log("Failed to get foreground window");
+    TraceSpan span("MainWindow::onHotkeyTriggered", "gui");
+    LOG_DEBUG(Hotkey, "=== Hotkey Triggered ===");
+    QElapsedTimer hotkeyTimer;
+    hotkeyTimer.start();
+    AudioTarget target;
+    if (!resolveForegroundTarget(&target)) {
         return;
     }
-    
-    DWORD pid = 0;
-    if (!GetWindowThreadProcessId(fg, &pid)) {
-        Logger::log("Failed to get process ID");
-        return;
-    }
-
-    // Get the executable name of the foreground window
-    QString targetExe = getMainProcessName(pid);
-    Logger::log(QString("Hotkey pressed. Target executable: %1 (PID: %2)").arg(targetExe).arg(pid));
+    const qint64 resolveNs = hotkeyTimer.nsecsElapsed();
+    LOG_DEBUG(Hotkey, QString("Hotkey pressed. Target executable: %1 (PID: %2)").arg(target.exeName).arg(target.pid));
+    LOG_DEBUG(Hotkey, target.preferFamily
+        ? "Process family muting mode: Trying to mute the PID and its descendants"
+        : target.preferPid
+        ? "PID-based muting mode: Trying to mute specific PID only"
+        : "Executable-based muting mode: Muting all processes with same executable name");
+    const quint64 commandId = audioEngine_.toggleMute(target);
+    pendingHotkeys_.insert(commandId, hotkeyTimer);
+
+    FlightRecord record;
+    record.event = FlightEvent::HotkeyMute;
+    record.commandId = static_cast<quint32>(commandId);
+    record.pid = target.pid;
+    record.setExe(target.exeName);
+    record.setStage(FlightStage::Resolve, resolveNs);
+    FlightRecorder::record(record);
+}
 
-    int n = 0;
-    
-    // Check if PID-based muting is enabled
-    if (ui->mainProcessOnlyCheck->isChecked()) {
-        Logger::log("PID-based muting mode: Trying to mute specific PID only");
-        n = muter_.toggleMuteByPID(pid); // Don't include related processes
-        
-        // If no sessions were found for the specific PID, fall back to executable-based muting
-        if (n == 0) {
-            Logger::log("No audio sessions found for specific PID, falling back to executable-based muting");
-            n = muter_.toggleMuteByExeName(targetExe);
-        }
-    } else {
-        Logger::log("Executable-based muting mode: Muting all processes with same executable name");
-        n = muter_.toggleMuteByExeName(targetExe);
+void MainWindow::onMuteToggled(quint64 commandId, const AudioTarget& target, int sessions) {
+    TraceSpan span("MainWindow::onMuteToggled", "gui");
+    const QElapsedTimer pressed = pendingHotkeys_.take(commandId);
+    if (pressed.isValid()) {
+        LatencyStats::record(LatencyStage::MuteTotal, pressed.nsecsElapsed());
     }
-    
-    Logger::log(QString("Sessions toggled: %1").arg(n));
+    LOG_DEBUG(Hotkey, QString("Sessions toggled for %1 (command %2): %3").arg(target.exeName).arg(commandId).arg(sessions));
 }
 
 void MainWindow::testHotkey() {
@@ -1015,81 +1021,73 @@ void MainWindow::simulateHotkeyInSelectedApp() {
 }
 
 void MainWindow::populateDeviceList() {
+    // Filled in by onDevicesListed() once the audio engine has enumerated
+    audioEngine_.requestDevices();
+}
+
+void MainWindow::onDevicesListed(quint64, const QVector<AudioDeviceInfo>& devices) {
+    TraceSpan span("MainWindow::onDevicesListed", "gui");
+    knownDevices_ = devices;
+    migrateLegacyDeviceExclusions(devices);
+
     // Populate all devices list
     ui->allDevicesList->clear();
-    QStringList allDevices = getAvailableAudioDevices();
-    for (const QString& device : allDevices) {
-        ui->allDevicesList->addItem(device);
+    for (const AudioDeviceInfo& device : devices) {
+        QListWidgetItem* item = new QListWidgetItem(device.name);
+        item->setData(Qt::UserRole, device.id);
+        ui->allDevicesList->addItem(item);
     }
     
-    // Populate excluded devices list
+    // Populate excluded devices list. Rules are kept by endpoint ID, so
+    // disconnected devices stay listed.
     ui->excludedDevicesList->clear();
-    QStringList excludedDevices = settingsManager_.getExcludedDevices();
-    for (const QString& device : excludedDevices) {
-        ui->excludedDevicesList->addItem(device);
-    }
-}
-
-QStringList MainWindow::getAvailableAudioDevices() {
-    QStringList devices;
-    
-    // Initialize COM if needed
-    HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
-    if (FAILED(hr) && hr != RPC_E_CHANGED_MODE) {
-        Logger::log("Failed to initialize COM");
-        return devices;
-    }
-    
-    // Create device enumerator
-    CComPtr<IMMDeviceEnumerator> enumerator;
-    hr = CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_ALL, 
-                         IID_PPV_ARGS(&enumerator));
-    if (FAILED(hr)) {
-        Logger::log("Failed to create device enumerator");
-        CoUninitialize();
-        return devices;
-    }
-    
-    // Enumerate audio endpoints
-    CComPtr<IMMDeviceCollection> devs;
-    hr = enumerator->EnumAudioEndpoints(eRender, DEVICE_STATE_ACTIVE, &devs);
-    if (FAILED(hr)) {
-        Logger::log("Failed to enumerate audio endpoints");
-        CoUninitialize();
-        return devices;
-    }
-    
-    UINT n;
-    devs->GetCount(&n);
-    Logger::log(QString("Found %1 active audio render devices").arg(n));
-    
-    for (UINT i = 0; i < n; ++i) {
-        CComPtr<IMMDevice> dev;
-        if (SUCCEEDED(devs->Item(i, &dev))) {
-            // Get device friendly name
-            CComPtr<IPropertyStore> props;
-            if (SUCCEEDED(dev->OpenPropertyStore(STGM_READ, &props))) {
-                PROPVARIANT var; 
-                PropVariantInit(&var);
-                if (SUCCEEDED(props->GetValue(PKEY_Device_FriendlyName, &var))) {
-                    QString deviceName = QString::fromWCharArray(var.pwszVal);
-                    devices.append(deviceName);
-                    Logger::log(QString("Found device: %1").arg(deviceName));
-                }
-                PropVariantClear(&var);
+    const QStringList excludedIds = settingsManager_.getExcludedDevices();
+    const QStringList excludedNames = excludedDeviceNames(excludedIds, devices);
+    for (int i = 0; i < excludedIds.size(); ++i) {
+        QListWidgetItem* item = new QListWidgetItem(excludedNames[i]);
+        item->setData(Qt::UserRole, excludedIds[i]);
+        ui->excludedDevicesList->addItem(item);
+    }
+
+    // Name-based rules whose device has not been seen since upgrading
+    const QStringList legacyNames = settingsManager_.getLegacyExcludedDeviceNames();
+    for (const QString& name : legacyNames) {
+        QListWidgetItem* item = new QListWidgetItem(QString("%1 (not connected)").arg(name));
+        item->setData(Qt::UserRole + 1, name);
+        ui->excludedDevicesList->addItem(item);
+    }
+}
+
+void MainWindow::migrateLegacyDeviceExclusions(const QVector<AudioDeviceInfo>& devices) {
+    const QStringList legacyNames = settingsManager_.getLegacyExcludedDeviceNames();
+    if (legacyNames.isEmpty()) {
+        return;
+    }
+
+    QStringList pending;
+    for (const QString& name : legacyNames) {
+        bool migrated = false;
+        for (const AudioDeviceInfo& device : devices) {
+            if (device.name.compare(name, Qt::CaseInsensitive) == 0) {
+                settingsManager_.addExcludedDevice(device.id);
+                Logger::log(QString("Migrated device exclusion '%1' to endpoint ID %2").arg(name, device.id));
+                migrated = true;
             }
         }
+        if (!migrated) {
+            pending.append(name);
+        }
+    }
+    if (pending.size() != legacyNames.size()) {
+        settingsManager_.setLegacyExcludedDeviceNames(pending);
     }
-    
-    CoUninitialize();
-    return devices;
 }
 
 void MainWindow::addExcludedDevice() {
     QListWidgetItem* currentItem = ui->allDevicesList->currentItem();
     if (currentItem) {
         QString device = currentItem->text();
-        settingsManager_.addExcludedDevice(device);
+        settingsManager_.addExcludedDevice(currentItem->data(Qt::UserRole).toString());
         populateDeviceList();
         saveSettings();
         QMessageBox::information(this, "Device Added", 
@@ -1104,7 +1102,14 @@ void MainWindow::removeExcludedDevice() {
     QListWidgetItem* currentItem = ui->excludedDevicesList->currentItem();
     if (currentItem) {
         QString device = currentItem->text();
-        settingsManager_.removeExcludedDevice(device);
+        const QString legacyName = currentItem->data(Qt::UserRole + 1).toString();
+        if (legacyName.isEmpty()) {
+            settingsManager_.removeExcludedDevice(currentItem->data(Qt::UserRole).toString());
+        } else {
+            QStringList legacyNames = settingsManager_.getLegacyExcludedDeviceNames();
+            legacyNames.removeAll(legacyName);
+            settingsManager_.setLegacyExcludedDeviceNames(legacyNames);
+        }
         populateDeviceList();
         saveSettings();
         QMessageBox::information(this, "Device Removed", 
@@ -1139,6 +1144,35 @@ void MainWindow::copyRegistryPath() {
     Logger::log(QString("Registry path copied to clipboard: %1").arg(registryPath));
 }
 
+void MainWindow::showLatencyDiagnostics() {
+    LatencyDialog *dialog = new LatencyDialog(this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->show();
+}
+
+void MainWindow::toggleTraceCapture() {
+    if (!TraceRecorder::isEnabled()) {
+        TraceRecorder::start();
+        ui->traceCaptureButton->setText("Stop Trace Capture");
+        return;
+    }
+
+    ui->traceCaptureButton->setText("Start Trace Capture");
+    const QString path = traceCapturePath();
+    QString error;
+    if (TraceRecorder::stop(path, &error)) {
+        QMessageBox::information(this, "Trace Capture Saved",
+            QString("Trace written to:\n\n%1\n\nOpen it in ui.perfetto.dev or chrome://tracing.").arg(path));
+    } else {
+        QMessageBox::warning(this, "Trace Capture Failed", QString("Could not write %1:\n%2").arg(path, error));
+    }
+}
+
+QString MainWindow::traceCapturePath() {
+    return QCoreApplication::applicationDirPath()
+        + QString("/trace-%1.json").arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"));
+}
+
 void MainWindow::closeEvent(QCloseEvent *event) {
     if (ui->closeToTrayCheck->isChecked() && trayIcon_ && trayIcon_->isSystemTrayAvailable()) {
         // Hide the window instead of closing
@@ -1669,140 +1703,112 @@ void MainWindow::onVolumeControlEnabledChanged() {
 }
 
 void MainWindow::onVolumeUpTriggered() {
-    Logger::log("=== Volume Up Hotkey Triggered ===");
-    
+    LOG_DEBUG(Hotkey, "=== Volume Up Hotkey Triggered ===");
+    queueVolumeSteps(1);
+}
+
+void MainWindow::onVolumeDownTriggered() {
+    LOG_DEBUG(Hotkey, "=== Volume Down Hotkey Triggered ===");
+    queueVolumeSteps(-1);
+}
+
+void MainWindow::queueVolumeSteps(int steps) {
     if (!settingsManager_.getVolumeControlEnabled()) {
-        Logger::log("Volume control is disabled, ignoring");
+        LOG_DEBUG(Hotkey, "Volume control is disabled, ignoring");
         return;
     }
-    
-    // Debounce: Check if enough time has passed since last adjustment
-    if (lastVolumeAdjustTime_.isValid() && lastVolumeAdjustTime_.elapsed() < VOLUME_DEBOUNCE_MS) {
-        Logger::log(QString("Volume adjustment debounced: only %1ms since last adjustment (need %2ms)").arg(lastVolumeAdjustTime_.elapsed()).arg(VOLUME_DEBOUNCE_MS));
-        return;
-    }
-    
-    // Start or restart the timer
-    lastVolumeAdjustTime_.restart();
-    
-    HWND fg = GetForegroundWindow();
-    if (!fg) {
-        Logger::log("Failed to get foreground window");
-        return;
+
+    // Presses add up until the next flush; the oldest one times the batch
+    if (!pendingVolumeSince_.isValid()) {
+        pendingVolumeSince_.start();
     }
-    
-    DWORD pid = 0;
-    if (!GetWindowThreadProcessId(fg, &pid)) {
-        Logger::log("Failed to get process ID");
+    pendingVolumeSteps_ += steps;
+    LOG_DEBUG(Hotkey, QString("Volume steps pending: %1").arg(pendingVolumeSteps_));
+
+    scheduleVolumeFlush();
+}
+
+void MainWindow::scheduleVolumeFlush() {
+    // While an adjustment is in flight, onVolumeAdjusted() schedules the next flush
+    if (volumeCommandInFlight_ != 0 || volumeStepTimer_->isActive()) {
         return;
     }
-    
-    QString targetExe = getMainProcessName(pid);
-    Logger::log(QString("Volume up pressed. Target executable: %1 (PID: %2)").arg(targetExe).arg(pid));
-    
-    float stepPercent = settingsManager_.getVolumeStepPercent();
-    int n = 0;
-    
-    // Check if PID-based muting is enabled (reuse the same setting)
-    if (ui->mainProcessOnlyCheck->isChecked()) {
-        Logger::log("PID-based mode: Adjusting volume for specific PID");
-        n = muter_.increaseVolumeByPID(pid, stepPercent);
-        if (n == 0) {
-            Logger::log("No audio sessions found for specific PID, falling back to executable-based");
-            n = muter_.increaseVolumeByExeName(targetExe, stepPercent);
-        }
+    // A lone press goes out at once; presses that follow it wait out the interval
+    const qint64 sinceFlushMs = lastVolumeFlush_.isValid() ? lastVolumeFlush_.elapsed() : VOLUME_STEP_INTERVAL_MS;
+    if (sinceFlushMs >= VOLUME_STEP_INTERVAL_MS) {
+        flushVolumeSteps();
     } else {
-        Logger::log("Executable-based mode: Adjusting volume for all processes with same executable name");
-        n = muter_.increaseVolumeByExeName(targetExe, stepPercent);
-    }
-    
-    Logger::log(QString("Volume increased for %1 sessions").arg(n));
-    
-    // Show OSD if enabled
-    if (settingsManager_.getVolumeControlShowOSD() && n > 0) {
-        float currentVolume = -1.0f;
-        if (ui->mainProcessOnlyCheck->isChecked()) {
-            currentVolume = muter_.getVolumeByPID(pid);
-            if (currentVolume < 0.0f) {
-                currentVolume = muter_.getVolumeByExeName(targetExe);
-            }
-        } else {
-            currentVolume = muter_.getVolumeByExeName(targetExe);
-        }
-        
-        if (currentVolume >= 0.0f) {
-            positionVolumeOSD();
-            VolumeOSD::instance().showVolumeOSD(targetExe, currentVolume);
-        }
+        volumeStepTimer_->start(VOLUME_STEP_INTERVAL_MS - static_cast<int>(sinceFlushMs));
     }
 }
 
-void MainWindow::onVolumeDownTriggered() {
-    Logger::log("=== Volume Down Hotkey Triggered ===");
-    
-    if (!settingsManager_.getVolumeControlEnabled()) {
-        Logger::log("Volume control is disabled, ignoring");
+void MainWindow::flushVolumeSteps() {
+    TraceSpan span("MainWindow::flushVolumeSteps", "gui");
+    if (volumeCommandInFlight_ != 0) {
         return;
     }
-    
-    // Debounce: Check if enough time has passed since last adjustment
-    if (lastVolumeAdjustTime_.isValid() && lastVolumeAdjustTime_.elapsed() < VOLUME_DEBOUNCE_MS) {
-        Logger::log(QString("Volume adjustment debounced: only %1ms since last adjustment (need %2ms)").arg(lastVolumeAdjustTime_.elapsed()).arg(VOLUME_DEBOUNCE_MS));
+
+    lastVolumeFlush_.start();
+    const int steps = pendingVolumeSteps_;
+    const QElapsedTimer hotkeyTimer = pendingVolumeSince_;
+    pendingVolumeSteps_ = 0;
+    pendingVolumeSince_.invalidate();
+    if (steps == 0) {
+        LOG_DEBUG(Hotkey, "Volume up and down presses cancelled out, nothing to apply");
         return;
     }
-    
-    // Start or restart the timer
-    lastVolumeAdjustTime_.restart();
-    
-    HWND fg = GetForegroundWindow();
-    if (!fg) {
-        Logger::log("Failed to get foreground window");
+    if (!settingsManager_.getVolumeControlEnabled()) {
+        LOG_DEBUG(Hotkey, "Volume control is disabled, dropping pending volume steps");
         return;
     }
-    
-    DWORD pid = 0;
-    if (!GetWindowThreadProcessId(fg, &pid)) {
-        Logger::log("Failed to get process ID");
+
+    QElapsedTimer resolveTimer;
+    resolveTimer.start();
+    AudioTarget target;
+    if (!resolveForegroundTarget(&target)) {
         return;
     }
-    
-    QString targetExe = getMainProcessName(pid);
-    Logger::log(QString("Volume down pressed. Target executable: %1 (PID: %2)").arg(targetExe).arg(pid));
-    
-    float stepPercent = settingsManager_.getVolumeStepPercent();
-    int n = 0;
-    
-    // Check if PID-based muting is enabled (reuse the same setting)
-    if (ui->mainProcessOnlyCheck->isChecked()) {
-        Logger::log("PID-based mode: Adjusting volume for specific PID");
-        n = muter_.decreaseVolumeByPID(pid, stepPercent);
-        if (n == 0) {
-            Logger::log("No audio sessions found for specific PID, falling back to executable-based");
-            n = muter_.decreaseVolumeByExeName(targetExe, stepPercent);
+    const qint64 resolveNs = resolveTimer.nsecsElapsed();
+    LOG_DEBUG(Hotkey, QString("Applying %1 volume steps. Target executable: %2 (PID: %3)").arg(steps).arg(target.exeName).arg(target.pid));
+
+    const float stepPercent = steps * settingsManager_.getVolumeStepPercent();
+    const quint64 commandId = audioEngine_.adjustVolume(target, stepPercent);
+    volumeCommandInFlight_ = commandId;
+    pendingHotkeys_.insert(commandId, hotkeyTimer);
+    recordVolumeHotkey(commandId, target, stepPercent, resolveNs);
+}
+
+void MainWindow::recordVolumeHotkey(quint64 commandId, const AudioTarget& target, float stepPercent, qint64 resolveNs) {
+    FlightRecord record;
+    record.event = FlightEvent::HotkeyVolume;
+    record.commandId = static_cast<quint32>(commandId);
+    record.pid = target.pid;
+    record.value = qRound(stepPercent);
+    record.setExe(target.exeName);
+    record.setStage(FlightStage::Resolve, resolveNs);
+    FlightRecorder::record(record);
+}
+
+void MainWindow::onVolumeAdjusted(quint64 commandId, const AudioTarget& target, const VolumeAdjustResult& result) {
+    TraceSpan span("MainWindow::onVolumeAdjusted", "gui");
+    const QElapsedTimer pressed = pendingHotkeys_.take(commandId);
+    if (pressed.isValid()) {
+        LatencyStats::record(LatencyStage::VolumeTotal, pressed.nsecsElapsed());
+    }
+    int n = result.adjustedCount();
+    LOG_DEBUG(Hotkey, QString("Volume adjusted for %1 sessions (command %2)").arg(n).arg(commandId));
+    if (commandId == volumeCommandInFlight_) {
+        volumeCommandInFlight_ = 0;
+        // Steps pressed meanwhile go out as the next batch
+        if (pendingVolumeSince_.isValid()) {
+            scheduleVolumeFlush();
         }
-    } else {
-        Logger::log("Executable-based mode: Adjusting volume for all processes with same executable name");
-        n = muter_.decreaseVolumeByExeName(targetExe, stepPercent);
     }
     
-    Logger::log(QString("Volume decreased for %1 sessions").arg(n));
-    
-    // Show OSD if enabled
+    // Show OSD if enabled; the adjustment already reported the new volume
     if (settingsManager_.getVolumeControlShowOSD() && n > 0) {
-        float currentVolume = -1.0f;
-        if (ui->mainProcessOnlyCheck->isChecked()) {
-            currentVolume = muter_.getVolumeByPID(pid);
-            if (currentVolume < 0.0f) {
-                currentVolume = muter_.getVolumeByExeName(targetExe);
-            }
-        } else {
-            currentVolume = muter_.getVolumeByExeName(targetExe);
-        }
-        
-        if (currentVolume >= 0.0f) {
-            positionVolumeOSD();
-            VolumeOSD::instance().showVolumeOSD(targetExe, currentVolume);
-        }
+        positionVolumeOSD();
+        VolumeOSD::instance().showVolumeOSD(target.exeName, result.averageVolume);
     }
 }
 
@@ -1876,10 +1882,10 @@ void MainWindow::registerVolumeHotkeys() {
     if (useHook) {
         Logger::log("Using hook-based volume hotkey detection");
         if (!volumeUpSeq_.isEmpty()) {
-            KeyboardHook::instance().setVolumeUpHotkey(volumeUpSeq_);
+            KeyboardHook::instance().setBinding(volumeUpHotkeyId_, volumeUpSeq_, HotkeyMatcher::Repeat, VolumeUpPriority);
         }
         if (!volumeDownSeq_.isEmpty()) {
-            KeyboardHook::instance().setVolumeDownHotkey(volumeDownSeq_);
+            KeyboardHook::instance().setBinding(volumeDownHotkeyId_, volumeDownSeq_, HotkeyMatcher::Repeat, VolumeDownPriority);
         }
         if (!KeyboardHook::instance().isHookInstalled()) {
             if (KeyboardHook::instance().installHook()) {
@@ -1901,7 +1907,8 @@ void MainWindow::registerVolumeHotkeys() {
 
 void MainWindow::unregisterVolumeHotkeys() {
     // Clear hook-based hotkeys
-    KeyboardHook::instance().clearVolumeHotkeys();
+    KeyboardHook::instance().clearBinding(volumeUpHotkeyId_);
+    KeyboardHook::instance().clearBinding(volumeDownHotkeyId_);
     
     // Unregister normal hotkeys
     HWND hwnd = (HWND)winId();
@@ -2115,6 +2122,7 @@ void MainWindow::registerAdminRestartHotkeyNormal(const QKeySequence& sequence,
         return;
     }
     
+    mods |= MOD_NOREPEAT;
     if (!RegisterHotKey(hwnd, hotkeyId, mods, winVk)) {
         DWORD error = GetLastError();
         Logger::log(QString("Failed to register admin restart hotkey. Error: %1 (0x%2)").arg(error).arg(error, 0, 16));
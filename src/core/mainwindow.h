@@ -8,10 +8,11 @@
 #include <QMenu>
 #include <QTimer>
 #include <QElapsedTimer>
+#include <QHash>
 #include <atlbase.h>
 #include <mmdeviceapi.h>
 #include <functiondiscoverykeys_devpkey.h>
-#include "audio_muter.h"
+#include "audio_engine.h"
 #include "settings_manager.h"
 #include "theme_manager.h"
 #include "update_manager.h"
@@ -26,6 +27,7 @@
 #include <QDialogButtonBox>
 #include <Windows.h>
 #include <TlHelp32.h>
+#include <memory>
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -53,6 +55,8 @@ private slots:
     void saveSettings();
     void openApplicationFolder();
     void copyRegistryPath();
+    void showLatencyDiagnostics();
+    void toggleTraceCapture();
     void showMainWindow();
     void quitApplication();
     void addManualProcess();
@@ -69,6 +73,11 @@ private slots:
     void onVolumeUpTriggered();
     void onVolumeDownTriggered();
     void onAdminRestartTriggered();
+    bool onHotkeyAction(int actionId);
+    void flushVolumeSteps();
+    void onMuteToggled(quint64 commandId, const AudioTarget& target, int sessions);
+    void onVolumeAdjusted(quint64 commandId, const AudioTarget& target, const VolumeAdjustResult& result);
+    void onDevicesListed(quint64 commandId, const QVector<AudioDeviceInfo>& devices);
     void setOSDPositionToCursor();
     void onMouseClickDetected(int x, int y);
 
@@ -81,18 +90,26 @@ private:
     void registerVolumeHotkeys();
     void unregisterVolumeHotkeys();
     void registerVolumeHotkeyNormal(const QKeySequence& sequence, int hotkeyId);
+    void queueVolumeSteps(int steps);
+    void scheduleVolumeFlush();
     void positionVolumeOSD();
     void populateDeviceList();
-    QString getMainProcessName(DWORD pid);
-    QString getUWPAppName(DWORD pid);
-    QStringList getAvailableAudioDevices();
+    bool resolveForegroundTarget(AudioTarget* target);
+    static QString traceCapturePath();
+    void recordVolumeHotkey(quint64 commandId, const AudioTarget& target, float stepPercent, qint64 resolveNs);
+    void migrateLegacyDeviceExclusions(const QVector<AudioDeviceInfo>& devices);
     void setupSystemTray();
     void populateExcludedProcessesTable(const QStringList& processes);
     void addProcessRow(const QString& processName);
     QStringList collectExcludedProcesses() const;
 
     Ui::MainWindow *ui;
-    AudioMuter muter_;
+    // Runs all mute/volume work off the GUI thread
+    AudioEngine audioEngine_;
+    // Last device list reported by the audio engine
+    QVector<AudioDeviceInfo> knownDevices_;
+    // Command ID -> time since its hotkey was pressed, for the end-to-end latency
+    QHash<quint64, QElapsedTimer> pendingHotkeys_;
     int hotkeyId_;
     QKeySequence currentSeq_;
     int volumeUpHotkeyId_;
@@ -104,6 +121,8 @@ private:
     SettingsManager& settingsManager_;
     QSystemTrayIcon* trayIcon_;
     QMenu* trayMenu_;
+    // Hotkey ID -> handler, shared by the keyboard hook and WM_HOTKEY
+    QHash<int, void (MainWindow::*)()> hotkeyActions_;
     
     // For mouse click detection
     HHOOK mouseHookHandle_;
@@ -115,7 +134,11 @@ private:
     static LRESULT CALLBACK mouseHookProc(int nCode, WPARAM wParam, LPARAM lParam);
     void cleanupClickDetection();
     
-    // For volume adjustment debouncing
-    QElapsedTimer lastVolumeAdjustTime_;
-    static const int VOLUME_DEBOUNCE_MS = 150; // Debounce delay in milliseconds
+    // Volume hotkey presses accumulate into one adjustment per interval
+    QTimer* volumeStepTimer_;
+    int pendingVolumeSteps_;  // Net steps, up minus down
+    QElapsedTimer pendingVolumeSince_;  // First press of the pending batch
+    quint64 volumeCommandInFlight_;  // 0 when no adjustment is running
+    QElapsedTimer lastVolumeFlush_;
+    static const int VOLUME_STEP_INTERVAL_MS = 16; // About one frame
 };
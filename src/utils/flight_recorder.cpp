@@ -0,0 +1,247 @@
+#include "flight_recorder.h"
+#include "logger.h"
+#include <QDateTime>
+#include <QFile>
+#include <QMutex>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr quint64 MAGIC = 0x3130544c4657414dull;   // "MAWFLT01" on disk
+constexpr quint32 VERSION = 1;
+
+// Everything in the file is 64-byte aligned: one header, then the slots
+struct FileHeader {
+    quint64 magic;
+    quint32 version;
+    quint32 slotSize;
+    quint32 capacity;
+    quint32 reserved;
+    std::atomic<quint64> next;  // Total records ever claimed; next slot is next % capacity
+    char padding[32];
+};
+
+// A slot's sequence is zeroed while its record is being written and set to
+// the claim index + 1 afterwards, so a record torn by a crash is skipped
+struct Slot {
+    std::atomic<quint64> sequence;
+    FlightRecord record;
+};
+
+static_assert(sizeof(FlightRecord) == 56, "FlightRecord is the on-disk layout");
+static_assert(sizeof(Slot) == 64, "Slot is the on-disk layout");
+static_assert(sizeof(FileHeader) == 64, "FileHeader is the on-disk layout");
+static_assert(std::atomic<quint64>::is_always_lock_free, "Mapped atomics must be lock-free");
+
+QMutex g_mutex;                 // Serializes open() and close()
+QFile *g_file = nullptr;
+uchar *g_map = nullptr;
+std::atomic<FileHeader*> g_header(nullptr);
+Slot *g_slots = nullptr;
+
+// 64-bit throughout: a capacity read from a corrupt header may be anything
+qint64 fileSize(quint32 capacity) {
+    return static_cast<qint64>(sizeof(FileHeader)) + static_cast<qint64>(capacity) * static_cast<qint64>(sizeof(Slot));
+}
+
+} // namespace
+
+void FlightRecord::setExe(const QString& name) {
+    const int n = std::min<int>(name.size(), static_cast<int>(sizeof(exe)) - 1);
+    for (int i = 0; i < n; ++i) {
+        const ushort c = name.at(i).unicode();
+        exe[i] = c < 0x100 ? static_cast<char>(c) : '?';
+    }
+    exe[n] = '\0';
+}
+
+void FlightRecord::setStage(FlightStage stage, qint64 nsecs) {
+    stageUs[static_cast<int>(stage)] = static_cast<quint32>(std::clamp<qint64>(nsecs / 1000, 0, 0xffffffffll));
+}
+
+bool FlightRecorder::open(const QString &path, int capacity) {
+    close();
+    if (capacity <= 0) {
+        Logger::log(QString("Flight recorder: invalid capacity %1").arg(capacity));
+        return false;
+    }
+
+    QMutexLocker lk(&g_mutex);
+    QFile *file = new QFile(path);
+    if (!file->open(QIODevice::ReadWrite)) {
+        Logger::log(QString("Flight recorder: cannot open %1: %2").arg(path, file->errorString()));
+        delete file;
+        return false;
+    }
+
+    const qint64 size = fileSize(static_cast<quint32>(capacity));
+    bool reinitialize = file->size() != size;
+    if (reinitialize && !file->resize(size)) {
+        Logger::log(QString("Flight recorder: cannot resize %1: %2").arg(path, file->errorString()));
+        delete file;
+        return false;
+    }
+    uchar *map = file->map(0, size);
+    if (!map) {
+        Logger::log(QString("Flight recorder: cannot map %1: %2").arg(path, file->errorString()));
+        delete file;
+        return false;
+    }
+
+    FileHeader *header = reinterpret_cast<FileHeader*>(map);
+    if (!reinitialize) {
+        reinitialize = header->magic != MAGIC || header->version != VERSION
+            || header->slotSize != sizeof(Slot) || header->capacity != static_cast<quint32>(capacity);
+    }
+    if (reinitialize) {
+        std::memset(map, 0, static_cast<size_t>(size));
+        header->version = VERSION;
+        header->slotSize = sizeof(Slot);
+        header->capacity = static_cast<quint32>(capacity);
+        // Written last, so a file cut short during initialization is redone next time
+        header->magic = MAGIC;
+    }
+
+    g_file = file;
+    g_map = map;
+    g_slots = reinterpret_cast<Slot*>(map + sizeof(FileHeader));
+    g_header.store(header, std::memory_order_release);
+    Logger::log(QString("Flight recorder: %1 (%2 records%3)").arg(path).arg(capacity).arg(reinitialize ? ", new" : ""));
+    return true;
+}
+
+void FlightRecorder::close() {
+    QMutexLocker lk(&g_mutex);
+    if (!g_file) {
+        return;
+    }
+    g_header.store(nullptr, std::memory_order_release);
+    // Unmapping leaves the written pages with the OS, which writes them out
+    g_file->unmap(g_map);
+    g_file->close();
+    delete g_file;
+    g_file = nullptr;
+    g_map = nullptr;
+    g_slots = nullptr;
+}
+
+bool FlightRecorder::isOpen() {
+    return g_header.load(std::memory_order_acquire) != nullptr;
+}
+
+void FlightRecorder::record(FlightRecord record) {
+    FileHeader *header = g_header.load(std::memory_order_acquire);
+    if (!header) {
+        return;
+    }
+    record.timeMs = QDateTime::currentMSecsSinceEpoch();
+
+    const quint64 index = header->next.fetch_add(1, std::memory_order_relaxed);
+    Slot &slot = g_slots[index % header->capacity];
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.record = record;
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+QStringList FlightRecorder::decode(const QString &path, QString *error) {
+    QStringList lines;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = file.errorString();
+        return lines;
+    }
+    const QByteArray data = file.readAll();
+
+    // Read field by field; the structs hold atomics and are only ever used in place
+    auto readAt = [&data](size_t offset, void *out, size_t size) {
+        std::memcpy(out, data.constData() + offset, size);
+    };
+    if (data.size() < static_cast<qint64>(sizeof(FileHeader))) {
+        if (error) *error = "File too short for a flight recorder header";
+        return lines;
+    }
+    quint64 magic = 0;
+    quint32 version = 0, slotSize = 0, capacity = 0;
+    readAt(offsetof(FileHeader, magic), &magic, sizeof(magic));
+    readAt(offsetof(FileHeader, version), &version, sizeof(version));
+    readAt(offsetof(FileHeader, slotSize), &slotSize, sizeof(slotSize));
+    readAt(offsetof(FileHeader, capacity), &capacity, sizeof(capacity));
+    if (magic != MAGIC || version != VERSION || slotSize != sizeof(Slot)
+        || capacity == 0 || data.size() < fileSize(capacity)) {
+        if (error) *error = "Not a flight recorder file, or written by an incompatible version";
+        return lines;
+    }
+
+    struct Entry {
+        quint64 sequence;
+        FlightRecord record;
+    };
+    std::vector<Entry> entries;
+    entries.reserve(capacity);
+    for (quint32 i = 0; i < capacity; ++i) {
+        const size_t slotOffset = sizeof(FileHeader) + static_cast<size_t>(i) * sizeof(Slot);
+        Entry entry;
+        readAt(slotOffset + offsetof(Slot, sequence), &entry.sequence, sizeof(entry.sequence));
+        // Never written, torn by a crash, or corrupt
+        if (entry.sequence == 0 || (entry.sequence - 1) % capacity != i) {
+            continue;
+        }
+        readAt(slotOffset + offsetof(Slot, record), &entry.record, sizeof(entry.record));
+        entries.push_back(entry);
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.sequence < b.sequence; });
+
+    lines.reserve(static_cast<int>(entries.size()));
+    for (const Entry& entry : entries) {
+        const FlightRecord& r = entry.record;
+        QString line = QString("#%1 %2 %3")
+            .arg(entry.sequence)
+            .arg(QDateTime::fromMSecsSinceEpoch(r.timeMs).toString("yyyy-MM-dd hh:mm:ss.zzz"))
+            .arg(QString::fromLatin1(eventName(r.event)));
+        if (r.event != FlightEvent::AppStart) {
+            line += QString(" cmd=%1 pid=%2 exe=%3")
+                .arg(r.commandId)
+                .arg(r.pid)
+                .arg(QString::fromLatin1(r.exe, static_cast<int>(qstrnlen(r.exe, sizeof(r.exe)))));
+        } else {
+            line += QString(" pid=%1").arg(r.pid);
+        }
+        switch (r.event) {
+        case FlightEvent::HotkeyVolume:
+            line += QString(" step=%1%").arg(r.value);
+            break;
+        case FlightEvent::MuteApplied:
+            line += QString(" sessions=%1").arg(r.matched);
+            break;
+        case FlightEvent::VolumeApplied:
+            line += QString(" sessions=%1 volume=%2%").arg(r.matched).arg(r.value);
+            break;
+        default:
+            break;
+        }
+        static const char *stageNames[] = { "resolve", "queue", "apply" };
+        for (int s = 0; s < static_cast<int>(FlightStage::Count); ++s) {
+            if (r.stageUs[s] != 0) {
+                line += QString(" %1=%2us").arg(QString::fromLatin1(stageNames[s])).arg(r.stageUs[s]);
+            }
+        }
+        lines.append(line);
+    }
+    return lines;
+}
+
+const char* FlightRecorder::eventName(FlightEvent event) {
+    switch (event) {
+    case FlightEvent::AppStart: return "app-start";
+    case FlightEvent::HotkeyMute: return "hotkey-mute";
+    case FlightEvent::HotkeyVolume: return "hotkey-volume";
+    case FlightEvent::MuteApplied: return "mute-applied";
+    case FlightEvent::VolumeApplied: return "volume-applied";
+    }
+    return "unknown";
+}
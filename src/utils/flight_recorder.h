@@ -0,0 +1,55 @@
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+enum class FlightEvent : quint16 {
+    AppStart = 1,       // value: 0
+    HotkeyMute,         // A mute hotkey was resolved to its target and queued
+    HotkeyVolume,       // A volume hotkey was resolved and queued; value: step percent
+    MuteApplied,        // The engine toggled the target's sessions
+    VolumeApplied,      // The engine adjusted the target's sessions; value: new volume percent
+};
+
+// Per-event timings, in microseconds
+enum class FlightStage { Resolve, Queue, Apply, Count };
+
+// One event as stored in the flight recorder file. The layout is the file
+// format, so fields only ever get appended within the spare bytes.
+struct FlightRecord {
+    qint64 timeMs = 0;          // Milliseconds since the epoch; filled in by record()
+    quint32 commandId = 0;      // Pairs a Hotkey* event with its *Applied event
+    quint32 pid = 0;
+    FlightEvent event = FlightEvent::AppStart;
+    quint16 matched = 0;        // Sessions changed
+    qint32 value = 0;           // See FlightEvent
+    quint32 stageUs[static_cast<int>(FlightStage::Count)] = {};
+    char exe[20] = {};          // Latin-1, truncated, NUL-terminated
+
+    // Copies without allocating; non-Latin-1 characters become '?'
+    void setExe(const QString& name);
+    void setStage(FlightStage stage, qint64 nsecs);
+};
+
+// Fixed-size, memory-mapped ring of the most recent events. Records are
+// written straight into the mapping, so they reach the file even if the
+// process crashes or hangs and is killed; the file never grows, and it is
+// kept across restarts, unlike app.log. Recording is a single atomic
+// increment and a 64-byte copy, safe from any thread.
+class FlightRecorder {
+public:
+    static constexpr int DEFAULT_CAPACITY = 16384;  // 1 MiB file
+
+    // Maps `path`, reinitializing it if it has a different layout or capacity
+    static bool open(const QString &path, int capacity = DEFAULT_CAPACITY);
+    static void close();
+    static bool isOpen();
+
+    // No-op while closed
+    static void record(FlightRecord record);
+
+    // Every complete record in the file, oldest first, one line each.
+    // Works on a file a running or crashed instance left behind.
+    static QStringList decode(const QString &path, QString *error = nullptr);
+    static const char* eventName(FlightEvent event);
+};
@@ -0,0 +1,213 @@
+#include "foreground_tracker.h"
+#include "latency_stats.h"
+#include "logger.h"
+#include "trace_recorder.h"
+#include <QFileInfo>
+
+ForegroundTracker* ForegroundTracker::instance_ = nullptr;
+
+static const QString UWP_HOST_EXE = "ApplicationFrameHost.exe";
+
+ForegroundTracker::ForegroundTracker()
+    : eventHook_(nullptr), cachedComplete_(false) {
+    instance_ = this;
+}
+
+ForegroundTracker::~ForegroundTracker() {
+    stop();
+    instance_ = nullptr;
+}
+
+ForegroundTracker& ForegroundTracker::instance() {
+    static ForegroundTracker instance;
+    return instance;
+}
+
+bool ForegroundTracker::start() {
+    if (eventHook_) {
+        return true;
+    }
+    // Out of context: delivered through this thread's message loop
+    eventHook_ = SetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, nullptr,
+                                 winEventProc, 0, 0, WINEVENT_OUTOFCONTEXT);
+    if (!eventHook_) {
+        DWORD error = GetLastError();
+        LOG_WARNING(Hotkey, QString("Failed to follow foreground changes, hotkeys resolve on press. Error: %1").arg(error));
+        return false;
+    }
+    // Start from the window that already has focus
+    if (HWND window = GetForegroundWindow()) {
+        resolve(window);
+    }
+    LOG_INFO(Hotkey, "Foreground tracker started");
+    return true;
+}
+
+void ForegroundTracker::stop() {
+    if (!eventHook_) {
+        return;
+    }
+    UnhookWinEvent(eventHook_);
+    eventHook_ = nullptr;
+    cached_ = Target();
+    cachedComplete_ = false;
+    hostedApps_.clear();
+    LOG_INFO(Hotkey, "Foreground tracker stopped");
+}
+
+void CALLBACK ForegroundTracker::winEventProc(HWINEVENTHOOK, DWORD event, HWND window, LONG objectId,
+                                              LONG childId, DWORD, DWORD) {
+    if (event != EVENT_SYSTEM_FOREGROUND || objectId != OBJID_WINDOW || childId != CHILDID_SELF
+        || !window || !instance_) {
+        return;
+    }
+    TraceSpan span("ForegroundTracker::foregroundChanged", "gui");
+    instance_->resolve(window);
+}
+
+bool ForegroundTracker::current(Target* target) {
+    LatencySpan span(LatencyStage::ForegroundTarget);
+    HWND window = GetForegroundWindow();
+    if (!window) {
+        LOG_WARNING(Hotkey, "Failed to get foreground window");
+        return false;
+    }
+
+    // A window's PID never changes, so a matching pair also rules out a recycled handle
+    DWORD pid = 0;
+    if (cachedComplete_ && window == cached_.window
+        && GetWindowThreadProcessId(window, &pid) && pid == cached_.pid) {
+        *target = cached_;
+        return true;
+    }
+
+    LOG_DEBUG(Hotkey, "Foreground target not resolved ahead, resolving now");
+    if (!resolve(window)) {
+        return false;
+    }
+    *target = cached_;
+    return true;
+}
+
+bool ForegroundTracker::resolve(HWND window) {
+    Target resolved;
+    resolved.window = window;
+    {
+        LatencySpan span(LatencyStage::ForegroundLookup);
+        if (!GetWindowThreadProcessId(window, &resolved.pid)) {
+            LOG_WARNING(Hotkey, "Failed to get process ID");
+            return false;
+        }
+    }
+    {
+        LatencySpan span(LatencyStage::ProcessName);
+        resolved.exeName = processName(resolved.pid, window);
+    }
+    LOG_DEBUG(Hotkey, QString("Foreground is now %1 (PID: %2)").arg(resolved.exeName).arg(resolved.pid));
+
+    cached_ = resolved;
+    cachedComplete_ = resolved.exeName != UWP_HOST_EXE;
+    return true;
+}
+
+QString ForegroundTracker::processName(DWORD pid, HWND window) {
+    QString exeName = imageName(pid);
+    if (exeName.isEmpty()) {
+        return "(unknown)";
+    }
+
+    // Check if this is ApplicationFrameHost.exe (UWP app)
+    if (exeName == UWP_HOST_EXE) {
+        LOG_DEBUG(Hotkey, "Detected ApplicationFrameHost.exe, attempting to get UWP app name");
+        // Try to get the actual UWP app name
+        const QString appName = uwpAppName(pid, window);
+        if (!appName.isEmpty()) {
+            exeName = appName;
+            LOG_DEBUG(Hotkey, QString("UWP app detected, using app name: %1").arg(exeName));
+        } else {
+            LOG_DEBUG(Hotkey, "Failed to get UWP app name, keeping ApplicationFrameHost.exe");
+        }
+    }
+    return exeName;
+}
+
+QString ForegroundTracker::imageName(DWORD pid) {
+    QString exeName;
+    HANDLE h = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if (h != nullptr) {
+        WCHAR buf[MAX_PATH];
+        DWORD len = MAX_PATH;
+        if (QueryFullProcessImageNameW(h, 0, buf, &len)) {
+            exeName = QFileInfo(QString::fromWCharArray(buf)).fileName();
+        }
+        CloseHandle(h);
+    }
+    return exeName;
+}
+
+QString ForegroundTracker::uwpAppName(DWORD hostPid, HWND window) {
+    auto cached = hostedApps_.constFind(window);
+    if (cached != hostedApps_.constEnd()) {
+        DWORD pid = 0;
+        if (IsWindow(cached->window) && GetAncestor(cached->window, GA_ROOT) == window
+            && GetWindowThreadProcessId(cached->window, &pid) && pid == cached->pid) {
+            LOG_TRACE(Hotkey, QString("UWP host 0x%1 still hosts %2").arg((quintptr)window, 0, 16).arg(cached->exeName));
+            return cached->exeName;
+        }
+        LOG_DEBUG(Hotkey, QString("UWP host 0x%1 no longer hosts %2").arg((quintptr)window, 0, 16).arg(cached->exeName));
+        hostedApps_.erase(cached);
+    }
+
+    LOG_TRACE(Hotkey, QString("Enumerating child windows of 0x%1 to find UWP app process").arg((quintptr)window, 0, 16));
+
+    struct EnumData {
+        DWORD hostPid;
+        HostedApp* result;
+    };
+
+    auto enumChildProc = [](HWND hwnd, LPARAM lParam) -> BOOL {
+        EnumData* data = reinterpret_cast<EnumData*>(lParam);
+
+        DWORD childPid = 0;
+        if (GetWindowThreadProcessId(hwnd, &childPid) && childPid != data->hostPid) {
+            const QString childExeName = imageName(childPid);
+            LOG_TRACE(Hotkey, QString("Child window PID: %1, EXE: %2").arg(childPid).arg(childExeName));
+
+            // If this is not ApplicationFrameHost and not a system process, use it
+            if (!childExeName.isEmpty() &&
+                childExeName != UWP_HOST_EXE &&
+                !childExeName.contains("System") &&
+                !childExeName.contains("svchost") &&
+                !childExeName.contains("explorer")) {
+                data->result->window = hwnd;
+                data->result->pid = childPid;
+                data->result->exeName = childExeName;
+                LOG_DEBUG(Hotkey, QString("Found UWP app process: %1").arg(childExeName));
+                return FALSE; // Stop enumeration
+            }
+        }
+        return TRUE; // Continue enumeration
+    };
+
+    HostedApp app;
+    EnumData enumData = { hostPid, &app };
+    EnumChildWindows(window, enumChildProc, reinterpret_cast<LPARAM>(&enumData));
+
+    if (app.exeName.isEmpty()) {
+        LOG_DEBUG(Hotkey, "No suitable child window process found");
+        return QString();
+    }
+    pruneHostedApps();
+    hostedApps_.insert(window, app);
+    return app.exeName;
+}
+
+void ForegroundTracker::pruneHostedApps() {
+    for (auto it = hostedApps_.begin(); it != hostedApps_.end();) {
+        if (IsWindow(it.key())) {
+            ++it;
+        } else {
+            it = hostedApps_.erase(it);
+        }
+    }
+}
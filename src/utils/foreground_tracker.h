@@ -0,0 +1,65 @@
+#pragma once
+#include <QHash>
+#include <QString>
+#include <Windows.h>
+
+// Keeps the foreground window's process resolved ahead of the hotkey. A
+// WinEvent hook reports every foreground change, and the tracker looks up
+// the PID and executable name (through ApplicationFrameHost to the UWP app)
+// right then, so a hotkey press only checks that the answer still holds.
+// Everything runs on the GUI thread, which receives the events.
+class ForegroundTracker {
+public:
+    struct Target {
+        HWND window = nullptr;
+        DWORD pid = 0;
+        QString exeName;
+    };
+
+    static ForegroundTracker& instance();
+
+    // Start/stop following foreground changes
+    bool start();
+    void stop();
+    bool isRunning() const { return eventHook_ != nullptr; }
+
+    // The foreground window's process: the cached answer when the window
+    // and its PID are the ones last resolved, otherwise resolved on the spot
+    bool current(Target* target);
+
+    // Executable name of a process; for ApplicationFrameHost, the UWP app hosted in `window`
+    QString processName(DWORD pid, HWND window);
+
+private:
+    ForegroundTracker();
+    ~ForegroundTracker();
+    ForegroundTracker(const ForegroundTracker&) = delete;
+    ForegroundTracker& operator=(const ForegroundTracker&) = delete;
+
+    static void CALLBACK winEventProc(HWINEVENTHOOK hook, DWORD event, HWND window, LONG objectId,
+                                      LONG childId, DWORD eventThread, DWORD eventTime);
+    // Resolves `window` into the cache
+    bool resolve(HWND window);
+    static QString imageName(DWORD pid);
+    QString uwpAppName(DWORD hostPid, HWND window);
+    // Forgets hosts whose window is gone
+    void pruneHostedApps();
+
+    HWINEVENTHOOK eventHook_;
+    Target cached_;
+    // False while a UWP host's app could not be found yet; its window may
+    // not be attached when focus arrives, so the next press looks again
+    bool cachedComplete_;
+
+    // The app found in a UWP host window, by host window. An entry holds
+    // while the app's window is still inside that host and owned by the
+    // same process; checking that costs a few calls, not an enumeration.
+    struct HostedApp {
+        HWND window = nullptr;
+        DWORD pid = 0;
+        QString exeName;
+    };
+    QHash<HWND, HostedApp> hostedApps_;
+
+    static ForegroundTracker* instance_;
+};
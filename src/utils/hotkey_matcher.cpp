@@ -0,0 +1,158 @@
+#include "hotkey_matcher.h"
+#include <cstring>
+
+namespace {
+
+// Windows virtual-key codes of the modifier keys
+constexpr int VK_SHIFT_KEY = 0x10;
+constexpr int VK_CONTROL_KEY = 0x11;
+constexpr int VK_MENU_KEY = 0x12;
+constexpr int VK_LWIN_KEY = 0x5B;
+constexpr int VK_RWIN_KEY = 0x5C;
+constexpr int VK_LSHIFT_KEY = 0xA0;
+constexpr int VK_RSHIFT_KEY = 0xA1;
+constexpr int VK_LCONTROL_KEY = 0xA2;
+constexpr int VK_RCONTROL_KEY = 0xA3;
+constexpr int VK_LMENU_KEY = 0xA4;
+constexpr int VK_RMENU_KEY = 0xA5;
+
+enum HeldKey : quint8 {
+    LeftCtrl = 0x01, RightCtrl = 0x02,
+    LeftAlt = 0x04, RightAlt = 0x08,
+    LeftShift = 0x10, RightShift = 0x20,
+    LeftWin = 0x40, RightWin = 0x80,
+};
+
+// Bits a key sets when pressed and clears when released. The generic codes
+// (sent by some injected input) release both sides, as no side is known.
+void modifierKeyBits(int vk, quint8* pressBits, quint8* releaseBits) {
+    switch (vk) {
+    case VK_LCONTROL_KEY: *pressBits = *releaseBits = LeftCtrl; break;
+    case VK_RCONTROL_KEY: *pressBits = *releaseBits = RightCtrl; break;
+    case VK_CONTROL_KEY: *pressBits = LeftCtrl; *releaseBits = LeftCtrl | RightCtrl; break;
+    case VK_LMENU_KEY: *pressBits = *releaseBits = LeftAlt; break;
+    case VK_RMENU_KEY: *pressBits = *releaseBits = RightAlt; break;
+    case VK_MENU_KEY: *pressBits = LeftAlt; *releaseBits = LeftAlt | RightAlt; break;
+    case VK_LSHIFT_KEY: *pressBits = *releaseBits = LeftShift; break;
+    case VK_RSHIFT_KEY: *pressBits = *releaseBits = RightShift; break;
+    case VK_SHIFT_KEY: *pressBits = LeftShift; *releaseBits = LeftShift | RightShift; break;
+    case VK_LWIN_KEY: *pressBits = *releaseBits = LeftWin; break;
+    case VK_RWIN_KEY: *pressBits = *releaseBits = RightWin; break;
+    default: *pressBits = *releaseBits = 0; break;
+    }
+}
+
+int modifiersForKeys(quint8 heldKeys) {
+    int mods = 0;
+    if (heldKeys & (LeftCtrl | RightCtrl)) mods |= HotkeyMatcher::ModControl;
+    if (heldKeys & (LeftAlt | RightAlt)) mods |= HotkeyMatcher::ModAlt;
+    if (heldKeys & (LeftShift | RightShift)) mods |= HotkeyMatcher::ModShift;
+    if (heldKeys & (LeftWin | RightWin)) mods |= HotkeyMatcher::ModWin;
+    return mods;
+}
+
+} // namespace
+
+HotkeyMatcher::HotkeyMatcher() : heldModifierKeys_(0), modifiers_(0) {
+    memset(table_, 0, sizeof(table_));
+    memset(repeatSlots_, 0, sizeof(repeatSlots_));
+    memset(keysDown_, 0, sizeof(keysDown_));
+}
+
+bool HotkeyMatcher::isBindable(int actionId, const Binding& binding) {
+    if (actionId <= 0 || actionId > MAX_ACTION_ID) {
+        return false;
+    }
+    return !binding.isValid
+        || (binding.virtualKey > 0 && binding.virtualKey < VIRTUAL_KEYS
+            && binding.modifiers >= 0 && binding.modifiers < MODIFIER_COMBINATIONS);
+}
+
+bool HotkeyMatcher::setBinding(int actionId, const Binding& binding) {
+    if (!isBindable(actionId, binding)) {
+        return false;
+    }
+    if (!binding.isValid) {
+        clearBinding(actionId);
+        return true;
+    }
+
+    const Binding previous = bindings_.value(actionId);
+    bindings_.insert(actionId, binding);
+    if (previous.isValid) {
+        refreshSlot(previous.virtualKey, previous.modifiers);
+    }
+    refreshSlot(binding.virtualKey, binding.modifiers);
+    return true;
+}
+
+void HotkeyMatcher::clearBinding(int actionId) {
+    auto it = bindings_.find(actionId);
+    if (it == bindings_.end()) {
+        return;
+    }
+    const Binding previous = it.value();
+    bindings_.erase(it);
+    refreshSlot(previous.virtualKey, previous.modifiers);
+}
+
+void HotkeyMatcher::clearBindings() {
+    bindings_.clear();
+    memset(table_, 0, sizeof(table_));
+    memset(repeatSlots_, 0, sizeof(repeatSlots_));
+}
+
+void HotkeyMatcher::refreshSlot(int virtualKey, int modifiers) {
+    // Bindings change rarely, so a pass over all of them is fine. They are
+    // visited in ID order, so only a strictly lower priority takes over.
+    quint16 actionId = 0;
+    int priority = 0;
+    bool repeats = false;
+    for (auto it = bindings_.constBegin(); it != bindings_.constEnd(); ++it) {
+        if (it->virtualKey == virtualKey && it->modifiers == modifiers
+            && (actionId == 0 || it->priority < priority)) {
+            actionId = static_cast<quint16>(it.key());
+            priority = it->priority;
+            repeats = it->trigger == Repeat;
+        }
+    }
+    table_[virtualKey][modifiers] = actionId;
+    const quint16 bit = static_cast<quint16>(1u << modifiers);
+    repeatSlots_[virtualKey] = repeats ? (repeatSlots_[virtualKey] | bit) : (repeatSlots_[virtualKey] & ~bit);
+}
+
+int HotkeyMatcher::onKey(int vk, bool isKeyDown) {
+    // Track modifier key states
+    quint8 pressBits = 0;
+    quint8 releaseBits = 0;
+    modifierKeyBits(vk, &pressBits, &releaseBits);
+    if (pressBits | releaseBits) {
+        heldModifierKeys_ = isKeyDown ? (heldModifierKeys_ | pressBits) : (heldModifierKeys_ & ~releaseBits);
+        modifiers_ = modifiersForKeys(heldModifierKeys_);
+    }
+
+    if (vk < 0 || vk >= VIRTUAL_KEYS) {
+        return 0;
+    }
+    quint64& word = keysDown_[vk >> 6];
+    const quint64 bit = quint64(1) << (vk & 63);
+    const bool wasDown = (word & bit) != 0;
+
+    // Hotkeys fire on key down only
+    if (!isKeyDown) {
+        word &= ~bit;
+        return 0;
+    }
+    word |= bit;
+    // A down while already down is an auto-repeat
+    if (wasDown && !(repeatSlots_[vk] & (1u << modifiers_))) {
+        return 0;
+    }
+    return table_[vk][modifiers_];
+}
+
+void HotkeyMatcher::reset() {
+    heldModifierKeys_ = 0;
+    modifiers_ = 0;
+    memset(keysDown_, 0, sizeof(keysDown_));
+}
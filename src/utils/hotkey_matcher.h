@@ -0,0 +1,74 @@
+#pragma once
+#include <QList>
+#include <QMap>
+#include <QtGlobal>
+
+// Hotkey matching for the low-level keyboard hook, kept free of Windows
+// headers: KeyboardHook feeds it every key event it sees, and the benchmark
+// replays recorded or synthetic key streams through it on any platform.
+//
+// Bindings map a (virtual key, modifiers) pair to an action ID. They are
+// compiled into a table indexed by exactly that pair, so matching a key
+// costs one lookup however many bindings there are. A held key repeats its
+// key-down event; each binding says whether those repeats fire it again.
+class HotkeyMatcher {
+public:
+    // Same bit values as RegisterHotKey's MOD_* flags
+    enum Modifier { ModAlt = 0x1, ModControl = 0x2, ModShift = 0x4, ModWin = 0x8 };
+
+    static constexpr int VIRTUAL_KEYS = 256;
+    static constexpr int MODIFIER_COMBINATIONS = 16;
+    // Action IDs are 1..MAX_ACTION_ID; 0 means no action
+    static constexpr int MAX_ACTION_ID = 0xffff;
+
+    enum Trigger {
+        Edge,    // Fires once per press
+        Repeat,  // Also fires on every auto-repeat while held
+    };
+
+    struct Binding {
+        int virtualKey = 0;
+        int modifiers = 0;  // Combination of Modifier flags
+        Trigger trigger = Edge;
+        // Where bindings share a key combination, the lowest priority wins,
+        // then the lowest ID
+        int priority = 0;
+        bool isValid = false;
+    };
+
+    HotkeyMatcher();
+
+    // Binds or rebinds an action; an invalid binding removes it. Returns
+    // false for an ID or key outside the table.
+    bool setBinding(int actionId, const Binding& binding);
+    // Whether setBinding() would accept this ID and key
+    static bool isBindable(int actionId, const Binding& binding);
+    void clearBinding(int actionId);
+    void clearBindings();
+    Binding binding(int actionId) const { return bindings_.value(actionId); }
+    // Bound action IDs in ascending order
+    QList<int> actions() const { return bindings_.keys(); }
+
+    // Updates the modifier state and returns the action the event triggers, or 0
+    int onKey(int vk, bool isKeyDown);
+
+    // Modifier flags currently held
+    int modifiers() const { return modifiers_; }
+    // Forgets all held keys
+    void reset();
+
+private:
+    // Recomputes the table entry for one key combination from the bindings
+    void refreshSlot(int virtualKey, int modifiers);
+
+    QMap<int, Binding> bindings_;
+    quint16 table_[VIRTUAL_KEYS][MODIFIER_COMBINATIONS];
+    // Per key, one bit per modifier combination whose action fires on repeat
+    quint16 repeatSlots_[VIRTUAL_KEYS];
+    // One bit per virtual key currently down, to tell a press from a repeat
+    quint64 keysDown_[VIRTUAL_KEYS / 64];
+    // One bit per physical modifier key, so releasing left Ctrl while right
+    // Ctrl is still down keeps Ctrl held
+    quint8 heldModifierKeys_;
+    int modifiers_;
+};
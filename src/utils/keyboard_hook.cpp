@@ -1,24 +1,39 @@
 #include "keyboard_hook.h"
+#include "latency_stats.h"
 #include "logger.h"
+#include "trace_recorder.h"
 #include <QKeyCombination>
+#include <QSemaphore>
+#include <utility>
 
 KeyboardHook* KeyboardHook::instance_ = nullptr;
 
+// The dispatcher re-checks the queue at least this often, even without a wakeup
+static const DWORD DISPATCHER_IDLE_MS = 250;
+// Posted to the hook thread with a heap-allocated MatcherUpdate in lParam
+static const UINT WM_UPDATE_MATCHER = WM_APP + 1;
+
+static_assert(HotkeyMatcher::ModAlt == MOD_ALT && HotkeyMatcher::ModControl == MOD_CONTROL
+              && HotkeyMatcher::ModShift == MOD_SHIFT && HotkeyMatcher::ModWin == MOD_WIN,
+              "HotkeyMatcher modifier flags must match MOD_*");
+
 KeyboardHook::KeyboardHook() 
-    : hookHandle_(nullptr), 
-      ctrlPressed_(false),
-      altPressed_(false), 
-      shiftPressed_(false),
-      winPressed_(false) {
+    : hookHandle_(nullptr),
+      hookThread_(nullptr),
+      hookThreadId_(0),
+      dispatcher_(nullptr),
+      wakeDispatcher_(CreateEvent(nullptr, FALSE, FALSE, nullptr)),
+      dispatcherIdle_(false),
+      stopping_(false),
+      droppedEvents_(0) {
     instance_ = this;
-    hotkeyData_.isValid = false;
-    volumeUpHotkeyData_.isValid = false;
-    volumeDownHotkeyData_.isValid = false;
-    adminRestartHotkeyData_.isValid = false;
 }
 
 KeyboardHook::~KeyboardHook() {
     uninstallHook();
+    if (wakeDispatcher_) {
+        CloseHandle(wakeDispatcher_);
+    }
     instance_ = nullptr;
 }
 
@@ -28,17 +43,30 @@ KeyboardHook& KeyboardHook::instance() {
 }
 
 bool KeyboardHook::installHook() {
-    if (hookHandle_) {
+    if (hookThread_) {
         Logger::log("Keyboard hook already installed");
         return true;
     }
     
     Logger::log("Installing low-level keyboard hook");
     
-    hookHandle_ = SetWindowsHookEx(WH_KEYBOARD_LL, hookProc, GetModuleHandle(nullptr), 0);
+    // Matches may arrive as soon as the hook is in
+    startDispatcher();
     
-    if (!hookHandle_) {
-        DWORD error = GetLastError();
+    QSemaphore ready;
+    DWORD error = 0;
+    hookThread_ = QThread::create([this, &ready, &error] { runHookThread(&ready, &error); });
+    hookThread_->setObjectName("KeyboardHook");
+    hookThread_->start(QThread::TimeCriticalPriority);
+    ready.acquire();
+    
+    if (!hookHandle_.load()) {
+        hookThread_->wait();
+        delete hookThread_;
+        hookThread_ = nullptr;
+        // Bindings go straight to the matcher again
+        hookThreadId_ = 0;
+        stopDispatcher();
         Logger::log(QString("Failed to install keyboard hook. Error: %1 (0x%2)").arg(error).arg(error, 0, 16));
         return false;
     }
@@ -48,89 +76,117 @@ bool KeyboardHook::installHook() {
 }
 
 void KeyboardHook::uninstallHook() {
-    if (hookHandle_) {
+    if (hookThread_) {
         Logger::log("Uninstalling keyboard hook");
-        UnhookWindowsHookEx(hookHandle_);
-        hookHandle_ = nullptr;
+        // The hook thread unhooks itself once its loop sees WM_QUIT
+        PostThreadMessage(hookThreadId_.load(), WM_QUIT, 0, 0);
+        hookThread_->wait();
+        delete hookThread_;
+        hookThread_ = nullptr;
+        hookThreadId_ = 0;
+        // Events already queued are still dispatched
+        stopDispatcher();
     }
 }
 
-void KeyboardHook::setHotkey(const QKeySequence& sequence) {
-    currentHotkey_ = sequence;
-    hotkeyData_ = convertKeySequence(sequence);
+void KeyboardHook::runHookThread(QSemaphore* ready, DWORD* error) {
+    MSG msg;
+    // Creates this thread's message queue, so that uninstallHook() and
+    // updateMatcher() can post to it as soon as the hook is in
+    PeekMessage(&msg, nullptr, WM_USER, WM_USER, PM_NOREMOVE);
+    hookThreadId_ = GetCurrentThreadId();
+    // Keys pressed while no hook was installed were never seen going up
+    matcher_.reset();
     
-    if (hotkeyData_.isValid) {
-        Logger::log(QString("Hook hotkey set: %1 (VK: 0x%2, Modifiers: 0x%3)")
-                    .arg(sequence.toString())
-                    .arg(hotkeyData_.virtualKey, 0, 16)
-                    .arg(hotkeyData_.modifiers, 0, 16));
-        
-        // Log which modifiers are detected
-        QString modifierList;
-        if (hotkeyData_.modifiers & MOD_CONTROL) modifierList += "CTRL ";
-        if (hotkeyData_.modifiers & MOD_ALT) modifierList += "ALT ";
-        if (hotkeyData_.modifiers & MOD_SHIFT) modifierList += "SHIFT ";
-        if (hotkeyData_.modifiers & MOD_WIN) modifierList += "WIN ";
-        Logger::log(QString("Hook modifiers detected: %1").arg(modifierList.trimmed()));
-    } else {
-        Logger::log(QString("Invalid hotkey for hook: %1").arg(sequence.toString()));
+    HHOOK hook = SetWindowsHookEx(WH_KEYBOARD_LL, hookProc, GetModuleHandle(nullptr), 0);
+    if (!hook) {
+        *error = GetLastError();
+    }
+    hookHandle_ = hook;
+    ready->release();
+    if (!hook) {
+        return;
     }
-}
-
-void KeyboardHook::setVolumeUpHotkey(const QKeySequence& sequence) {
-    volumeUpHotkey_ = sequence;
-    volumeUpHotkeyData_ = convertKeySequence(sequence);
     
-    if (volumeUpHotkeyData_.isValid) {
-        Logger::log(QString("Volume up hotkey set: %1 (VK: 0x%2, Modifiers: 0x%3)")
-                    .arg(sequence.toString())
-                    .arg(volumeUpHotkeyData_.virtualKey, 0, 16)
-                    .arg(volumeUpHotkeyData_.modifiers, 0, 16));
-    } else {
-        Logger::log(QString("Invalid volume up hotkey: %1").arg(sequence.toString()));
+    // Windows calls the hook from inside GetMessage on this thread, so it
+    // keeps running whatever the GUI thread is doing. Matcher updates arrive
+    // through the same loop and never overlap a callback.
+    while (GetMessage(&msg, nullptr, 0, 0) > 0) {
+        if (msg.message == WM_UPDATE_MATCHER) {
+            MatcherUpdate *update = reinterpret_cast<MatcherUpdate*>(msg.lParam);
+            (*update)(matcher_);
+            delete update;
+            continue;
+        }
+        TranslateMessage(&msg);
+        DispatchMessage(&msg);
     }
+    
+    UnhookWindowsHookEx(hook);
+    hookHandle_ = nullptr;
 }
 
-void KeyboardHook::setVolumeDownHotkey(const QKeySequence& sequence) {
-    volumeDownHotkey_ = sequence;
-    volumeDownHotkeyData_ = convertKeySequence(sequence);
-    
-    if (volumeDownHotkeyData_.isValid) {
-        Logger::log(QString("Volume down hotkey set: %1 (VK: 0x%2, Modifiers: 0x%3)")
-                    .arg(sequence.toString())
-                    .arg(volumeDownHotkeyData_.virtualKey, 0, 16)
-                    .arg(volumeDownHotkeyData_.modifiers, 0, 16));
-    } else {
-        Logger::log(QString("Invalid volume down hotkey: %1").arg(sequence.toString()));
+bool KeyboardHook::updateMatcher(MatcherUpdate update) {
+    // The hook thread owns the matcher while it runs
+    const DWORD threadId = hookThreadId_.load();
+    if (threadId != 0) {
+        MatcherUpdate *posted = new MatcherUpdate(std::move(update));
+        if (!PostThreadMessage(threadId, WM_UPDATE_MATCHER, 0, reinterpret_cast<LPARAM>(posted))) {
+            LOG_WARNING(Hotkey, QString("Failed to post hotkey update to the hook thread. Error: %1").arg(GetLastError()));
+            delete posted;
+            return false;
+        }
+        return true;
     }
+    update(matcher_);
+    return true;
 }
 
-void KeyboardHook::clearVolumeHotkeys() {
-    volumeUpHotkey_ = QKeySequence();
-    volumeDownHotkey_ = QKeySequence();
-    volumeUpHotkeyData_.isValid = false;
-    volumeDownHotkeyData_.isValid = false;
-    Logger::log("Volume hotkeys cleared");
-}
+bool KeyboardHook::setBinding(int actionId, const QKeySequence& sequence, HotkeyMatcher::Trigger trigger, int priority) {
+    if (sequence.isEmpty()) {
+        clearBinding(actionId);
+        return true;
+    }
+
+    HotkeyData data = convertKeySequence(sequence);
+    data.trigger = trigger;
+    data.priority = priority;
+    if (!data.isValid || !HotkeyMatcher::isBindable(actionId, data)) {
+        Logger::log(QString("Invalid hotkey for hook: %1").arg(sequence.toString()));
+        return false;
+    }
+    if (!updateMatcher([actionId, data](HotkeyMatcher& matcher) { matcher.setBinding(actionId, data); })) {
+        Logger::log(QString("Failed to set hook hotkey 0x%1: %2").arg(actionId, 0, 16).arg(sequence.toString()));
+        return false;
+    }
 
-void KeyboardHook::setAdminRestartHotkey(const QKeySequence& sequence) {
-    adminRestartHotkey_ = sequence;
-    adminRestartHotkeyData_ = convertKeySequence(sequence);
+    Logger::log(QString("Hook hotkey 0x%1 set: %2 (VK: 0x%3, Modifiers: 0x%4, %5)")
+                .arg(actionId, 0, 16)
+                .arg(sequence.toString())
+                .arg(data.virtualKey, 0, 16)
+                .arg(data.modifiers, 0, 16)
+                .arg(trigger == HotkeyMatcher::Repeat ? "repeats while held" : "once per press"));
     
-    if (adminRestartHotkeyData_.isValid) {
-        Logger::log(QString("Admin restart hotkey set: %1 (VK: 0x%2, Modifiers: 0x%3)")
-                    .arg(sequence.toString())
-                    .arg(adminRestartHotkeyData_.virtualKey, 0, 16)
-                    .arg(adminRestartHotkeyData_.modifiers, 0, 16));
-    } else {
-        Logger::log(QString("Invalid admin restart hotkey: %1").arg(sequence.toString()));
+    // Log which modifiers are detected
+    QString modifierList;
+    if (data.modifiers & MOD_CONTROL) modifierList += "CTRL ";
+    if (data.modifiers & MOD_ALT) modifierList += "ALT ";
+    if (data.modifiers & MOD_SHIFT) modifierList += "SHIFT ";
+    if (data.modifiers & MOD_WIN) modifierList += "WIN ";
+    LOG_DEBUG(Hotkey, QString("Hook modifiers detected: %1").arg(modifierList.trimmed()));
+    return true;
+}
+
+void KeyboardHook::clearBinding(int actionId) {
+    if (updateMatcher([actionId](HotkeyMatcher& matcher) { matcher.clearBinding(actionId); })) {
+        LOG_DEBUG(Hotkey, QString("Hook hotkey 0x%1 cleared").arg(actionId, 0, 16));
     }
 }
 
-void KeyboardHook::clearAdminRestartHotkey() {
-    adminRestartHotkey_ = QKeySequence();
-    adminRestartHotkeyData_.isValid = false;
-    Logger::log("Admin restart hotkey cleared");
+void KeyboardHook::clearBindings() {
+    if (updateMatcher([](HotkeyMatcher& matcher) { matcher.clearBindings(); })) {
+        Logger::log("Hook hotkeys cleared");
+    }
 }
 
 LRESULT CALLBACK KeyboardHook::hookProc(int nCode, WPARAM wParam, LPARAM lParam) {
@@ -141,56 +197,95 @@ LRESULT CALLBACK KeyboardHook::hookProc(int nCode, WPARAM wParam, LPARAM lParam)
 }
 
 LRESULT KeyboardHook::processHook(int nCode, WPARAM wParam, LPARAM lParam) {
+    // Runs for every keystroke system-wide, and Windows drops hooks that
+    // exceed LowLevelHooksTimeout: no logging, signals or locks in here
     if (nCode >= 0) {
+        QElapsedTimer callbackTimer;
+        callbackTimer.start();
         KBDLLHOOKSTRUCT* kbd = reinterpret_cast<KBDLLHOOKSTRUCT*>(lParam);
         bool isKeyDown = (wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN);
         bool isKeyUp = (wParam == WM_KEYUP || wParam == WM_SYSKEYUP);
         
         if (isKeyDown || isKeyUp) {
-            int vk = kbd->vkCode;
-            
-            // Track modifier key states
-            if (vk == VK_CONTROL || vk == VK_LCONTROL || vk == VK_RCONTROL) {
-                ctrlPressed_ = isKeyDown;
-            } else if (vk == VK_MENU || vk == VK_LMENU || vk == VK_RMENU) {
-                altPressed_ = isKeyDown;
-            } else if (vk == VK_SHIFT || vk == VK_LSHIFT || vk == VK_RSHIFT) {
-                shiftPressed_ = isKeyDown;
-            } else if (vk == VK_LWIN || vk == VK_RWIN) {
-                winPressed_ = isKeyDown;
-            }
-            
-            // Check if this key matches any of our hotkeys (only on key down)
-            if (isKeyDown) {
-                // Check main hotkey
-                if (hotkeyData_.isValid && isHotkeyMatch(vk, true, hotkeyData_)) {
-                    Logger::log("Hook detected main hotkey match! Emitting signal");
-                    emit hotkeyTriggered();
-                    // Don't suppress the key - let it pass through
-                }
-                // Check volume up hotkey
-                else if (volumeUpHotkeyData_.isValid && isHotkeyMatch(vk, true, volumeUpHotkeyData_)) {
-                    Logger::log("Hook detected volume up hotkey match! Emitting signal");
-                    emit volumeUpTriggered();
-                    // Don't suppress the key - let it pass through
-                }
-                // Check volume down hotkey
-                else if (volumeDownHotkeyData_.isValid && isHotkeyMatch(vk, true, volumeDownHotkeyData_)) {
-                    Logger::log("Hook detected volume down hotkey match! Emitting signal");
-                    emit volumeDownTriggered();
-                    // Don't suppress the key - let it pass through
-                }
-                // Check admin restart hotkey
-                else if (adminRestartHotkeyData_.isValid && isHotkeyMatch(vk, true, adminRestartHotkeyData_)) {
-                    Logger::log("Hook detected admin restart hotkey match! Emitting signal");
-                    emit adminRestartTriggered();
-                    // Don't suppress the key - let it pass through
+            // Hotkeys are let through rather than suppressed
+            const int vk = static_cast<int>(kbd->vkCode);
+            const int actionId = matcher_.onKey(vk, isKeyDown);
+            if (actionId != 0) {
+                HookEvent event;
+                event.actionId = actionId;
+                event.virtualKey = vk;
+                event.received = callbackTimer;
+                if (!events_.tryPush(event)) {
+                    droppedEvents_.fetch_add(1, std::memory_order_relaxed);
+                } else if (dispatcherIdle_.exchange(false)) {
+                    SetEvent(wakeDispatcher_);
                 }
             }
         }
+        LatencyStats::record(LatencyStage::HookCallback, callbackTimer.nsecsElapsed());
     }
     
-    return CallNextHookEx(hookHandle_, nCode, wParam, lParam);
+    return CallNextHookEx(hookHandle_.load(std::memory_order_relaxed), nCode, wParam, lParam);
+}
+
+void KeyboardHook::startDispatcher() {
+    if (dispatcher_) {
+        return;
+    }
+    stopping_ = false;
+    dispatcher_ = QThread::create([this] { runDispatcher(); });
+    dispatcher_->setObjectName("HookDispatcher");
+    dispatcher_->start(QThread::HighPriority);
+}
+
+void KeyboardHook::stopDispatcher() {
+    if (!dispatcher_) {
+        return;
+    }
+    stopping_ = true;
+    SetEvent(wakeDispatcher_);
+    dispatcher_->wait();
+    delete dispatcher_;
+    dispatcher_ = nullptr;
+}
+
+void KeyboardHook::runDispatcher() {
+    for (;;) {
+        const bool stopping = stopping_.load();
+
+        HookEvent event;
+        while (events_.tryPop(&event)) {
+            dispatch(event);
+        }
+        const quint64 dropped = droppedEvents_.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0) {
+            LOG_WARNING(Hotkey, QString("Hook event queue overflowed, %1 hotkey presses dropped").arg(dropped));
+        }
+
+        if (stopping) {
+            break;
+        }
+
+        dispatcherIdle_.store(true);
+        // An event pushed before the callback saw the idle flag is caught here
+        if (events_.isEmpty() && !stopping_.load()) {
+            WaitForSingleObject(wakeDispatcher_, DISPATCHER_IDLE_MS);
+        }
+        dispatcherIdle_.store(false);
+    }
+}
+
+void KeyboardHook::dispatch(const HookEvent& event) {
+    const qint64 queueNs = event.received.nsecsElapsed();
+    LatencyStats::record(LatencyStage::HookQueue, queueNs);
+    if (TraceRecorder::isEnabled()) {
+        TraceRecorder::complete("hookQueue", "stage", TraceRecorder::now() - queueNs);
+    }
+    TraceSpan span("KeyboardHook::dispatch", "hook");
+    LOG_DEBUG(Hotkey, QString("Hook detected hotkey 0x%1 match (VK: 0x%2)! Emitting signal")
+                          .arg(event.actionId, 0, 16)
+                          .arg(event.virtualKey, 0, 16));
+    emit actionTriggered(event.actionId);
 }
 
 KeyboardHook::HotkeyData KeyboardHook::convertKeySequence(const QKeySequence& sequence) {
@@ -261,27 +356,3 @@ KeyboardHook::HotkeyData KeyboardHook::convertKeySequence(const QKeySequence& se
     
     return data;
 }
-
-bool KeyboardHook::isHotkeyMatch(int vk, bool isKeyDown, const HotkeyData& data) {
-    if (!data.isValid || !isKeyDown) {
-        return false;
-    }
-    
-    // Check if the main key matches
-    if (vk != data.virtualKey) {
-        return false;
-    }
-    
-    // Check if modifier states match
-    bool needsCtrl = (data.modifiers & MOD_CONTROL) != 0;
-    bool needsAlt = (data.modifiers & MOD_ALT) != 0;
-    bool needsShift = (data.modifiers & MOD_SHIFT) != 0;
-    bool needsWin = (data.modifiers & MOD_WIN) != 0;
-    
-    bool ctrlOk = needsCtrl ? ctrlPressed_ : !ctrlPressed_;
-    bool altOk = needsAlt ? altPressed_ : !altPressed_;
-    bool shiftOk = needsShift ? shiftPressed_ : !shiftPressed_;
-    bool winOk = needsWin ? winPressed_ : !winPressed_;
-    
-    return ctrlOk && altOk && shiftOk && winOk;
-}
@@ -1,7 +1,15 @@
 #pragma once
+#include "hotkey_matcher.h"
+#include "spsc_queue.h"
 #include <QObject>
+#include <QElapsedTimer>
 #include <QKeySequence>
+#include <QThread>
 #include <Windows.h>
+#include <atomic>
+#include <functional>
+
+class QSemaphore;
 
 class KeyboardHook : public QObject {
     Q_OBJECT
@@ -9,30 +17,28 @@ class KeyboardHook : public QObject {
 public:
     static KeyboardHook& instance();
     
-    // Install/uninstall the hook
+    // Install/uninstall the hook. It runs on its own thread with its own
+    // message loop, so keyboard input never waits for the GUI thread.
+    // These and the binding setters are for the GUI thread only.
     bool installHook();
     void uninstallHook();
     
-    // Set the hotkey to monitor
-    void setHotkey(const QKeySequence& sequence);
-    
-    // Set volume control hotkeys
-    void setVolumeUpHotkey(const QKeySequence& sequence);
-    void setVolumeDownHotkey(const QKeySequence& sequence);
-    void clearVolumeHotkeys();
-
-    // Set admin restart hotkey
-    void setAdminRestartHotkey(const QKeySequence& sequence);
-    void clearAdminRestartHotkey();
+    // Bind an action ID (1..HotkeyMatcher::MAX_ACTION_ID) to a key
+    // sequence, replacing its previous binding; an empty sequence unbinds it.
+    // Holding the keys fires the action once unless the trigger is Repeat.
+    // Of two actions on the same keys, the one with lower priority fires.
+    bool setBinding(int actionId, const QKeySequence& sequence,
+                    HotkeyMatcher::Trigger trigger = HotkeyMatcher::Edge, int priority = 0);
+    void clearBinding(int actionId);
+    void clearBindings();
     
     // Check if hook is installed
-    bool isHookInstalled() const { return hookHandle_ != nullptr; }
+    bool isHookInstalled() const { return hookHandle_.load() != nullptr; }
 
 signals:
-    void hotkeyTriggered();
-    void volumeUpTriggered();
-    void volumeDownTriggered();
-    void adminRestartTriggered();
+    // A bound hotkey was pressed. Emitted from the dispatcher thread, so
+    // receivers in other threads get it queued.
+    void actionTriggered(int actionId);
 
 private:
     KeyboardHook();
@@ -43,39 +49,48 @@ private:
     // Static hook procedure
     static LRESULT CALLBACK hookProc(int nCode, WPARAM wParam, LPARAM lParam);
     
-    // Instance method for processing hook messages
+    // Instance method for processing hook messages. Only matches and
+    // queues; everything else happens on the dispatcher thread.
     LRESULT processHook(int nCode, WPARAM wParam, LPARAM lParam);
     
-    // Convert QKeySequence to Windows virtual key codes
-    struct HotkeyData {
+    // A matched key event, handed from the hook callback to the dispatcher
+    struct HookEvent {
+        int actionId;
         int virtualKey;
-        int modifiers;  // Combination of MOD_ALT, MOD_CONTROL, MOD_SHIFT, MOD_WIN
-        bool isValid;
+        QElapsedTimer received;
     };
-    HotkeyData convertKeySequence(const QKeySequence& sequence);
+    void startDispatcher();
+    void stopDispatcher();
+    void runDispatcher();
+    void dispatch(const HookEvent& event);
     
-    // Check if current key state matches our hotkey
-    bool isHotkeyMatch(int vk, bool isKeyDown, const HotkeyData& data);
+    // Installs the hook and pumps messages until WM_QUIT
+    void runHookThread(QSemaphore* ready, DWORD* error);
+    // Applies a change to the matcher on whichever thread owns it. Returns
+    // false if the change could not be handed to the hook thread.
+    using MatcherUpdate = std::function<void(HotkeyMatcher&)>;
+    bool updateMatcher(MatcherUpdate update);
     
-    HHOOK hookHandle_;
-    QKeySequence currentHotkey_;
-    HotkeyData hotkeyData_;
+    // Convert QKeySequence to Windows virtual key codes
+    using HotkeyData = HotkeyMatcher::Binding;
+    HotkeyData convertKeySequence(const QKeySequence& sequence);
     
-    // Volume control hotkeys
-    QKeySequence volumeUpHotkey_;
-    QKeySequence volumeDownHotkey_;
-    HotkeyData volumeUpHotkeyData_;
-    HotkeyData volumeDownHotkeyData_;
-
-    // Admin restart hotkey
-    QKeySequence adminRestartHotkey_;
-    HotkeyData adminRestartHotkeyData_;
+    std::atomic<HHOOK> hookHandle_;
+    QThread* hookThread_;
+    // Set by the hook thread, read by the GUI thread; 0 while no hook thread runs
+    std::atomic<DWORD> hookThreadId_;
+    
+    // Bindings and modifier state; matched on every keystroke. Owned by the
+    // hook thread while it runs, changed only through updateMatcher().
+    HotkeyMatcher matcher_;
     
-    // Track modifier states
-    bool ctrlPressed_;
-    bool altPressed_;
-    bool shiftPressed_;
-    bool winPressed_;
+    // The hook callback is the only producer, the dispatcher the only consumer
+    SpscQueue<HookEvent, 256> events_;
+    QThread* dispatcher_;
+    HANDLE wakeDispatcher_;     // Auto-reset event, set only while the dispatcher sleeps
+    std::atomic<bool> dispatcherIdle_;
+    std::atomic<bool> stopping_;
+    std::atomic<quint64> droppedEvents_;
     
     static KeyboardHook* instance_;
 };
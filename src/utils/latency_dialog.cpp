@@ -0,0 +1,129 @@
+#include "latency_dialog.h"
+#include "latency_stats.h"
+#include "logger.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QPushButton>
+#include <QLabel>
+#include <QDialogButtonBox>
+#include <QHeaderView>
+#include <QFileDialog>
+#include <QFile>
+#include <QMessageBox>
+#include <QDateTime>
+
+// Refresh interval while the dialog is open
+static const int REFRESH_MS = 1000;
+
+static QString formatNs(qint64 nsecs) {
+    if (nsecs >= 1000000) {
+        return QString("%1 ms").arg(nsecs / 1e6, 0, 'f', 2);
+    }
+    if (nsecs >= 1000) {
+        return QString("%1 us").arg(nsecs / 1e3, 0, 'f', 1);
+    }
+    return QString("%1 ns").arg(nsecs);
+}
+
+LatencyDialog::LatencyDialog(QWidget *parent)
+    : QDialog(parent) {
+    setWindowTitle("Latency Diagnostics");
+    resize(640, 400);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+
+    QLabel *label = new QLabel("Time spent in each stage of a hotkey press since startup or the last reset:", this);
+    mainLayout->addWidget(label);
+
+    statsTable = new QTableWidget(static_cast<int>(LatencyStage::Count), 7, this);
+    statsTable->setHorizontalHeaderLabels({"Stage", "Count", "p50", "p95", "p99", "Max", "Mean"});
+    statsTable->verticalHeader()->setVisible(false);
+    statsTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    statsTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    statsTable->setSelectionMode(QAbstractItemView::NoSelection);
+    mainLayout->addWidget(statsTable);
+
+    QLabel *hookNote = new QLabel("hookCallback covers every key event while the keyboard hook is installed; "
+                                  "its Max is the longest any keystroke was held up by the hook.", this);
+    hookNote->setWordWrap(true);
+    mainLayout->addWidget(hookNote);
+
+    QLabel *targetNote = new QLabel("foregroundTarget is what a press spends finding its target. foregroundLookup and "
+                                    "processName mostly run when focus changes, so their means add up to the time "
+                                    "taken off each press.", this);
+    targetNote->setWordWrap(true);
+    mainLayout->addWidget(targetNote);
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+
+    QPushButton *resetButton = new QPushButton("Reset", this);
+    connect(resetButton, &QPushButton::clicked, this, &LatencyDialog::resetStats);
+    buttonLayout->addWidget(resetButton);
+
+    QPushButton *exportButton = new QPushButton("Export JSON...", this);
+    connect(exportButton, &QPushButton::clicked, this, &LatencyDialog::exportJson);
+    buttonLayout->addWidget(exportButton);
+
+    buttonLayout->addStretch();
+
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Close, this);
+    connect(buttonBox, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    buttonLayout->addWidget(buttonBox);
+
+    mainLayout->addLayout(buttonLayout);
+
+    connect(&refreshTimer_, &QTimer::timeout, this, &LatencyDialog::refreshStats);
+    refreshTimer_.start(REFRESH_MS);
+    refreshStats();
+}
+
+void LatencyDialog::refreshStats() {
+    for (int row = 0; row < static_cast<int>(LatencyStage::Count); ++row) {
+        const LatencyStage stage = static_cast<LatencyStage>(row);
+        const LatencyHistogram::Summary s = LatencyStats::summary(stage);
+        const bool empty = s.count == 0;
+        const QString none("-");
+        const QStringList cells = {
+            QString::fromLatin1(LatencyStats::stageName(stage)),
+            QString::number(s.count),
+            empty ? none : formatNs(s.p50Ns),
+            empty ? none : formatNs(s.p95Ns),
+            empty ? none : formatNs(s.p99Ns),
+            empty ? none : formatNs(s.maxNs),
+            empty ? none : formatNs(s.meanNs),
+        };
+        for (int column = 0; column < cells.size(); ++column) {
+            QTableWidgetItem *item = statsTable->item(row, column);
+            if (!item) {
+                item = new QTableWidgetItem();
+                if (column > 0) {
+                    item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+                }
+                statsTable->setItem(row, column, item);
+            }
+            item->setText(cells[column]);
+        }
+    }
+}
+
+void LatencyDialog::resetStats() {
+    LatencyStats::reset();
+    Logger::log("Latency statistics reset");
+    refreshStats();
+}
+
+void LatencyDialog::exportJson() {
+    const QString defaultName = QString("latency-%1.json").arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"));
+    const QString path = QFileDialog::getSaveFileName(this, "Export Latency Statistics", defaultName, "JSON files (*.json)");
+    if (path.isEmpty()) {
+        return;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        QMessageBox::warning(this, "Export Latency Statistics", QString("Could not write %1:\n%2").arg(path, file.errorString()));
+        return;
+    }
+    file.write(LatencyStats::toJson());
+    Logger::log(QString("Latency statistics exported to %1").arg(path));
+}
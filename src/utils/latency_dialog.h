@@ -0,0 +1,21 @@
+#pragma once
+#include <QDialog>
+#include <QTableWidget>
+#include <QTimer>
+
+// Live view of the LatencyStats histograms, with reset and JSON export
+class LatencyDialog : public QDialog {
+    Q_OBJECT
+
+public:
+    explicit LatencyDialog(QWidget *parent = nullptr);
+
+private slots:
+    void refreshStats();
+    void resetStats();
+    void exportJson();
+
+private:
+    QTableWidget *statsTable;
+    QTimer refreshTimer_;
+};
@@ -0,0 +1,193 @@
+#include "latency_stats.h"
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtAlgorithms>
+#include <limits>
+
+namespace {
+
+constexpr qint64 MAX_VALUE = (qint64(1) << 62) - 1;
+
+LatencyHistogram g_histograms[static_cast<int>(LatencyStage::Count)];
+
+// Highest value of the bucket holding the value at rank `fraction` of `total`
+qint64 valueAtFraction(const quint64 *counts, quint64 total, double fraction) {
+    if (total == 0) {
+        return 0;
+    }
+    const quint64 rank = qMax<quint64>(1, static_cast<quint64>(fraction * static_cast<double>(total) + 0.5));
+    quint64 seen = 0;
+    for (int i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return LatencyHistogram::bucketHighest(i);
+        }
+    }
+    return LatencyHistogram::bucketHighest(LatencyHistogram::BUCKET_COUNT - 1);
+}
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+int LatencyHistogram::bucketIndex(qint64 nsecs) {
+    const quint64 value = static_cast<quint64>(qBound<qint64>(0, nsecs, MAX_VALUE));
+    if (value < SUB_BUCKETS) {
+        return static_cast<int>(value);
+    }
+    // value >> shift lands in [SUB_BUCKETS, 2 * SUB_BUCKETS)
+    const int msb = 63 - qCountLeadingZeroBits(value);
+    const int shift = msb - SUB_BUCKET_BITS;
+    const int sub = static_cast<int>(value >> shift) - SUB_BUCKETS;
+    return SUB_BUCKETS + shift * SUB_BUCKETS + sub;
+}
+
+qint64 LatencyHistogram::bucketLowest(int index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    const int shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+    const int sub = (index - SUB_BUCKETS) % SUB_BUCKETS;
+    return static_cast<qint64>(SUB_BUCKETS + sub) << shift;
+}
+
+qint64 LatencyHistogram::bucketHighest(int index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    const int shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+    return bucketLowest(index) + (qint64(1) << shift) - 1;
+}
+
+void LatencyHistogram::record(qint64 nsecs) {
+    nsecs = qBound<qint64>(0, nsecs, MAX_VALUE);
+    counts_[bucketIndex(nsecs)].fetch_add(1, std::memory_order_relaxed);
+    total_.fetch_add(1, std::memory_order_relaxed);
+    sumNs_.fetch_add(nsecs, std::memory_order_relaxed);
+
+    qint64 seen = minNs_.load(std::memory_order_relaxed);
+    while (nsecs < seen && !minNs_.compare_exchange_weak(seen, nsecs, std::memory_order_relaxed)) {
+    }
+    seen = maxNs_.load(std::memory_order_relaxed);
+    while (nsecs > seen && !maxNs_.compare_exchange_weak(seen, nsecs, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset() {
+    for (std::atomic<quint64>& count : counts_) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    total_.store(0, std::memory_order_relaxed);
+    sumNs_.store(0, std::memory_order_relaxed);
+    minNs_.store(std::numeric_limits<qint64>::max(), std::memory_order_relaxed);
+    maxNs_.store(0, std::memory_order_relaxed);
+}
+
+LatencyHistogram::Summary LatencyHistogram::summary() const {
+    // Recording may continue meanwhile; the copy is consistent enough for percentiles
+    quint64 counts[BUCKET_COUNT];
+    quint64 total = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        counts[i] = counts_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    Summary summary;
+    summary.count = total;
+    if (total == 0) {
+        return summary;
+    }
+    summary.minNs = minNs_.load(std::memory_order_relaxed);
+    summary.maxNs = maxNs_.load(std::memory_order_relaxed);
+    summary.meanNs = sumNs_.load(std::memory_order_relaxed) / static_cast<qint64>(qMax<quint64>(1, total_.load(std::memory_order_relaxed)));
+    // A bucket's highest value can overshoot the true maximum
+    summary.p50Ns = qMin(valueAtFraction(counts, total, 0.50), summary.maxNs);
+    summary.p95Ns = qMin(valueAtFraction(counts, total, 0.95), summary.maxNs);
+    summary.p99Ns = qMin(valueAtFraction(counts, total, 0.99), summary.maxNs);
+    return summary;
+}
+
+QVector<QPair<qint64, quint64>> LatencyHistogram::buckets() const {
+    QVector<QPair<qint64, quint64>> result;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        const quint64 count = counts_[i].load(std::memory_order_relaxed);
+        if (count > 0) {
+            result.append(qMakePair(bucketHighest(i), count));
+        }
+    }
+    return result;
+}
+
+void LatencyStats::record(LatencyStage stage, qint64 nsecs) {
+    g_histograms[static_cast<int>(stage)].record(nsecs);
+}
+
+LatencyHistogram::Summary LatencyStats::summary(LatencyStage stage) {
+    return g_histograms[static_cast<int>(stage)].summary();
+}
+
+void LatencyStats::reset() {
+    for (LatencyHistogram& histogram : g_histograms) {
+        histogram.reset();
+    }
+}
+
+QByteArray LatencyStats::toJson() {
+    QJsonArray stages;
+    for (int i = 0; i < static_cast<int>(LatencyStage::Count); ++i) {
+        const LatencyStage stage = static_cast<LatencyStage>(i);
+        const LatencyHistogram::Summary s = summary(stage);
+
+        QJsonArray buckets;
+        for (const auto& bucket : g_histograms[i].buckets()) {
+            QJsonArray pair;
+            pair.append(bucket.first);
+            pair.append(static_cast<qint64>(bucket.second));
+            buckets.append(pair);
+        }
+
+        QJsonObject entry;
+        entry.insert("stage", QString::fromLatin1(stageName(stage)));
+        entry.insert("count", static_cast<qint64>(s.count));
+        entry.insert("minNs", s.minNs);
+        entry.insert("meanNs", s.meanNs);
+        entry.insert("p50Ns", s.p50Ns);
+        entry.insert("p95Ns", s.p95Ns);
+        entry.insert("p99Ns", s.p99Ns);
+        entry.insert("maxNs", s.maxNs);
+        entry.insert("buckets", buckets);
+        stages.append(entry);
+    }
+
+    QJsonObject root;
+    root.insert("capturedAt", QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+    root.insert("subBucketBits", LatencyHistogram::SUB_BUCKET_BITS);
+    root.insert("stages", stages);
+    return QJsonDocument(root).toJson(QJsonDocument::Indented);
+}
+
+const char* LatencyStats::stageName(LatencyStage stage) {
+    switch (stage) {
+    case LatencyStage::HookCallback: return "hookCallback";
+    case LatencyStage::HookQueue: return "hookQueue";
+    case LatencyStage::ForegroundTarget: return "foregroundTarget";
+    case LatencyStage::ForegroundLookup: return "foregroundLookup";
+    case LatencyStage::ProcessName: return "processName";
+    case LatencyStage::QueueWait: return "queueWait";
+    case LatencyStage::DeviceEnumeration: return "deviceEnumeration";
+    case LatencyStage::SessionScan: return "sessionScan";
+    case LatencyStage::SessionLookup: return "sessionLookup";
+    case LatencyStage::ProcessTree: return "processTree";
+    case LatencyStage::ProcessResolve: return "processResolve";
+    case LatencyStage::SetMute: return "setMute";
+    case LatencyStage::SetVolume: return "setVolume";
+    case LatencyStage::MuteTotal: return "muteTotal";
+    case LatencyStage::VolumeTotal: return "volumeTotal";
+    case LatencyStage::Count: break;
+    }
+    return "unknown";
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <QByteArray>
+#include "trace_recorder.h"
+#include <QElapsedTimer>
+#include <QPair>
+#include <QVector>
+#include <QtGlobal>
+#include <atomic>
+
+// Stages of a hotkey press, from the keypress to the sessions being changed
+enum class LatencyStage {
+    HookCallback,       // Keyboard hook callback, for every key event; its max is the worst case
+    HookQueue,          // Matched key event waiting for the hook dispatcher thread
+    ForegroundTarget,   // Hotkey finding its target process, usually the tracker's cached answer
+    ForegroundLookup,   // Foreground window's PID, on focus change or a cache miss
+    ProcessName,        // Executable name, including the UWP host lookup; same timing
+    QueueWait,          // Command waiting for the audio engine thread
+    DeviceEnumeration,  // Active render endpoints, usually from the device registry
+    SessionScan,        // One device's session enumeration
+    SessionLookup,      // Session index lookup, when the index is live
+    ProcessTree,        // Process listing for family matching, on first use or when a new process appears
+    ProcessResolve,     // PID to executable name, usually a cache hit
+    SetMute,            // One session's getMute/setMute
+    SetVolume,          // One session's getVolume/setVolume
+    MuteTotal,          // Mute hotkey to the result reaching the GUI
+    VolumeTotal,        // Volume hotkey to the result reaching the GUI
+    Count
+};
+
+// Log-linear histogram in the style of HdrHistogram: exact below 32ns, then
+// 32 linear sub-buckets per power of two, so every reported percentile is
+// within about 3% of the true value. Recording is lock-free.
+class LatencyHistogram {
+public:
+    struct Summary {
+        quint64 count = 0;
+        qint64 minNs = 0;
+        qint64 maxNs = 0;
+        qint64 meanNs = 0;
+        qint64 p50Ns = 0;
+        qint64 p95Ns = 0;
+        qint64 p99Ns = 0;
+    };
+
+    LatencyHistogram();
+
+    void record(qint64 nsecs);
+    void reset();
+    Summary summary() const;
+    // Non-empty buckets as (highest value in bucket, count) pairs, in value order
+    QVector<QPair<qint64, quint64>> buckets() const;
+
+    static constexpr int SUB_BUCKET_BITS = 5;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    // Values are clamped below 2^62 ns
+    static constexpr int BUCKET_COUNT = SUB_BUCKETS + (62 - SUB_BUCKET_BITS) * SUB_BUCKETS;
+
+    static int bucketIndex(qint64 nsecs);
+    static qint64 bucketLowest(int index);
+    static qint64 bucketHighest(int index);
+
+private:
+    std::atomic<quint64> counts_[BUCKET_COUNT];
+    std::atomic<quint64> total_;
+    std::atomic<qint64> sumNs_;
+    std::atomic<qint64> minNs_;
+    std::atomic<qint64> maxNs_;
+};
+
+// Process-wide histograms, one per stage; any thread may record
+class LatencyStats {
+public:
+    static void record(LatencyStage stage, qint64 nsecs);
+    static LatencyHistogram::Summary summary(LatencyStage stage);
+    static void reset();
+
+    // Summaries plus raw buckets for every stage, so exports can be merged or compared offline
+    static QByteArray toJson();
+
+    static const char* stageName(LatencyStage stage);
+};
+
+// Times its own scope into one stage, and into the trace when a capture is running
+class LatencySpan {
+public:
+    explicit LatencySpan(LatencyStage stage)
+        : stage_(stage), traceBeginNs_(TraceRecorder::isEnabled() ? TraceRecorder::now() : -1) { timer_.start(); }
+    ~LatencySpan() {
+        LatencyStats::record(stage_, timer_.nsecsElapsed());
+        if (traceBeginNs_ >= 0) {
+            TraceRecorder::complete(LatencyStats::stageName(stage_), "stage", traceBeginNs_);
+        }
+    }
+
+    LatencySpan(const LatencySpan&) = delete;
+    LatencySpan& operator=(const LatencySpan&) = delete;
+
+private:
+    LatencyStage stage_;
+    qint64 traceBeginNs_;
+    QElapsedTimer timer_;
+};
@@ -3,25 +3,323 @@
 #include <QTextStream>
 #include <QDateTime>
 #include <QMutex>
+#include <QSemaphore>
+#include <QThread>
+#include <QWaitCondition>
+#include <utility>
 
-static QFile *g_logFile = nullptr;
-static QMutex g_mutex;
+namespace {
+
+struct LogRecord {
+    qint64 seconds = 0;     // Seconds since epoch; formatted by the writer
+    LogLevel level = LogLevel::Info;
+    LogCategory category = LogCategory::General;
+    QString message;
+};
+
+// Bounded multi-producer queue (Vyukov). Each slot carries a sequence number,
+// so producers and the writer claim slots with a single CAS and never lock.
+class LogRing {
+public:
+    static constexpr quint64 CAPACITY = 8192;   // Power of two
+
+    LogRing() : enqueuePos_(0), dequeuePos_(0) {
+        for (quint64 i = 0; i < CAPACITY; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool tryPush(LogRecord& record) {
+        quint64 pos = enqueuePos_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots_[pos & MASK];
+            const quint64 seq = slot.sequence.load(std::memory_order_acquire);
+            const qint64 diff = static_cast<qint64>(seq) - static_cast<qint64>(pos);
+            if (diff == 0) {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1)) {
+                    slot.record = std::move(record);
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;   // Full
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(LogRecord* record) {
+        quint64 pos = dequeuePos_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots_[pos & MASK];
+            const quint64 seq = slot.sequence.load(std::memory_order_acquire);
+            const qint64 diff = static_cast<qint64>(seq) - static_cast<qint64>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    *record = std::move(slot.record);
+                    slot.sequence.store(pos + CAPACITY, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;   // Empty
+            } else {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool isEmpty() const {
+        return enqueuePos_.load() == dequeuePos_.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr quint64 MASK = CAPACITY - 1;
+
+    struct Slot {
+        std::atomic<quint64> sequence;
+        LogRecord record;
+    };
+
+    alignas(64) std::atomic<quint64> enqueuePos_;
+    alignas(64) std::atomic<quint64> dequeuePos_;
+    Slot slots_[CAPACITY];
+};
+
+// Records a producer may discard under DropOldest before giving up on its own
+constexpr int MAX_DROP_ATTEMPTS = 4;
+// The writer wakes at least this often, even without a nudge from a producer
+constexpr int WRITER_IDLE_MS = 250;
+// Blocked producers re-check for space at least this often
+constexpr int PRODUCER_WAIT_MS = 50;
+
+LogRing g_ring;
+QFile *g_logFile = nullptr;         // Owned by the writer while it runs
+QThread *g_writer = nullptr;
+QMutex g_lifecycleMutex;            // Serializes init() and shutdown()
+std::atomic<bool> g_running(false);
+std::atomic<bool> g_stopping(false);
+std::atomic<bool> g_writerIdle(false);
+std::atomic<int> g_overflow(static_cast<int>(LogOverflow::DropOldest));
+std::atomic<quint64> g_dropped(0);
+QSemaphore g_wakeWriter;
+
+QMutex g_spaceMutex;
+QWaitCondition g_spaceFreed;
+std::atomic<int> g_blockedProducers(0);
+
+void wakeWriter() {
+    // Only a sleeping writer needs the semaphore; a busy one re-checks the ring
+    if (g_writerIdle.exchange(false)) {
+        g_wakeWriter.release();
+    }
+}
+
+void wakeBlockedProducers() {
+    if (g_blockedProducers.load() > 0) {
+        QMutexLocker lk(&g_spaceMutex);
+        g_spaceFreed.wakeAll();
+    }
+}
+
+bool pushBlocking(LogRecord& record) {
+    g_blockedProducers.fetch_add(1);
+    bool pushed = false;
+    while (!pushed && g_running.load()) {
+        wakeWriter();
+        QMutexLocker lk(&g_spaceMutex);
+        pushed = g_ring.tryPush(record);
+        if (!pushed) {
+            g_spaceFreed.wait(&g_spaceMutex, PRODUCER_WAIT_MS);
+        }
+    }
+    g_blockedProducers.fetch_sub(1);
+    return pushed;
+}
+
+bool pushDroppingOldest(LogRecord& record) {
+    LogRecord discarded;
+    for (int attempt = 0; attempt < MAX_DROP_ATTEMPTS; ++attempt) {
+        // The writer may have drained the ring in the meantime
+        if (g_ring.tryPop(&discarded)) {
+            g_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (g_ring.tryPush(record)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void writeRecords(QFile *file) {
+    // The formatted timestamp only changes once a second
+    qint64 cachedSecond = -1;
+    QString cachedStamp;
+
+    for (;;) {
+        const bool stopping = g_stopping.load();
+
+        QTextStream ts(file);
+        LogRecord record;
+        int written = 0;
+        while (g_ring.tryPop(&record)) {
+            if (record.seconds != cachedSecond) {
+                cachedSecond = record.seconds;
+                cachedStamp = QDateTime::fromSecsSinceEpoch(cachedSecond).toString("yyyy-MM-dd hh:mm:ss");
+            }
+            ts << cachedStamp << "  ";
+            // Plain info lines keep the original format
+            if (record.level != LogLevel::Info || record.category != LogCategory::General) {
+                ts << Logger::levelName(record.level) << " [" << Logger::categoryName(record.category) << "] ";
+            }
+            ts << record.message << "\r\n";
+            if ((++written & 0xff) == 0) {
+                wakeBlockedProducers();
+            }
+        }
+        const quint64 dropped = g_dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0) {
+            ts << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss") << "  "
+               << Logger::levelName(LogLevel::Warning) << " [" << Logger::categoryName(LogCategory::General) << "] "
+               << QString("Log buffer overflowed, %1 records dropped").arg(dropped) << "\r\n";
+        }
+        if (written > 0 || dropped > 0) {
+            // One flush per batch instead of one per line
+            ts.flush();
+            file->flush();
+            wakeBlockedProducers();
+        }
+
+        if (stopping && g_ring.isEmpty()) {
+            break;
+        }
+
+        g_writerIdle.store(true);
+        // A producer that pushed before seeing the idle flag is caught here
+        if (g_ring.isEmpty() && !g_stopping.load()) {
+            g_wakeWriter.tryAcquire(1, WRITER_IDLE_MS);
+        }
+        g_writerIdle.store(false);
+    }
+}
+
+} // namespace
 
 void Logger::init(const QString &logFilePath) {
-    QMutexLocker lk(&g_mutex);
-    if (g_logFile) {
-        g_logFile->close();
+    shutdown();
+
+    QMutexLocker lk(&g_lifecycleMutex);
+    g_logFile = new QFile(logFilePath);
+    if (!g_logFile->open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
         delete g_logFile;
+        g_logFile = nullptr;
+        return;
     }
-    g_logFile = new QFile(logFilePath);
-    g_logFile->open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate);
+    g_stopping = false;
+    g_writer = QThread::create([file = g_logFile] { writeRecords(file); });
+    g_writer->setObjectName("Logger");
+    g_writer->start(QThread::LowPriority);
+    g_running = true;
+}
+
+void Logger::shutdown() {
+    QMutexLocker lk(&g_lifecycleMutex);
+    if (!g_writer) {
+        return;
+    }
+    // The writer drains whatever was queued before it exits
+    g_running = false;
+    g_stopping = true;
+    g_wakeWriter.release();
+    wakeBlockedProducers();
+    g_writer->wait();
+    delete g_writer;
+    g_writer = nullptr;
+
+    g_logFile->close();
+    delete g_logFile;
+    g_logFile = nullptr;
 }
 
 void Logger::log(const QString &msg) {
-    QMutexLocker lk(&g_mutex);
-    if (!g_logFile || !g_logFile->isOpen()) return;
-    QTextStream ts(g_logFile);
-    const auto t = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
-    ts << t << "  " << msg << "\r\n";
-    g_logFile->flush();
+    if (!isEnabled(LogLevel::Info, LogCategory::General)) return;
+    write(LogLevel::Info, LogCategory::General, msg);
+}
+
+void Logger::write(LogLevel level, LogCategory category, const QString &msg) {
+    if (!g_running.load(std::memory_order_relaxed)) return;
+
+    // Only the clock is read here; formatting and disk I/O happen on the writer
+    LogRecord record;
+    record.seconds = QDateTime::currentSecsSinceEpoch();
+    record.level = level;
+    record.category = category;
+    record.message = msg;
+
+    bool pushed = g_ring.tryPush(record);
+    if (!pushed) {
+        pushed = overflowPolicy() == LogOverflow::Block ? pushBlocking(record) : pushDroppingOldest(record);
+    }
+    if (pushed) {
+        wakeWriter();
+    } else {
+        g_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Logger::setOverflowPolicy(LogOverflow policy) {
+    g_overflow.store(static_cast<int>(policy), std::memory_order_relaxed);
+}
+
+LogOverflow Logger::overflowPolicy() {
+    return static_cast<LogOverflow>(g_overflow.load(std::memory_order_relaxed));
+}
+
+void Logger::setLevel(LogLevel level) {
+    for (std::atomic<int>& threshold : thresholds_) {
+        threshold.store(static_cast<int>(level), std::memory_order_relaxed);
+    }
+}
+
+void Logger::setLevel(LogCategory category, LogLevel level) {
+    thresholds_[static_cast<int>(category)].store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+const char* Logger::levelName(LogLevel level) {
+    switch (level) {
+    case LogLevel::Trace: return "trace";
+    case LogLevel::Debug: return "debug";
+    case LogLevel::Info: return "info";
+    case LogLevel::Warning: return "warning";
+    case LogLevel::Error: return "error";
+    case LogLevel::Off: return "off";
+    }
+    return "info";
+}
+
+const char* Logger::categoryName(LogCategory category) {
+    switch (category) {
+    case LogCategory::General: return "general";
+    case LogCategory::Audio: return "audio";
+    case LogCategory::Hotkey: return "hotkey";
+    case LogCategory::Config: return "config";
+    case LogCategory::Ui: return "ui";
+    case LogCategory::Update: return "update";
+    case LogCategory::Count: break;
+    }
+    return "general";
+}
+
+LogLevel Logger::levelFromString(const QString &name) {
+    for (int i = static_cast<int>(LogLevel::Trace); i <= static_cast<int>(LogLevel::Off); ++i) {
+        const LogLevel level = static_cast<LogLevel>(i);
+        if (name.compare(QString::fromLatin1(levelName(level)), Qt::CaseInsensitive) == 0) {
+            return level;
+        }
+    }
+    return LogLevel::Info;
+}
+
+LogOverflow Logger::overflowFromString(const QString &name) {
+    return name.compare(QString::fromLatin1("block"), Qt::CaseInsensitive) == 0 ? LogOverflow::Block : LogOverflow::DropOldest;
 }
@@ -1,7 +1,67 @@
 #pragma once
 #include <QString>
+#include <atomic>
+
+enum class LogLevel { Trace, Debug, Info, Warning, Error, Off };
+
+enum class LogCategory { General, Audio, Hotkey, Config, Ui, Update, Count };
+
+// What a producer does when the writer has fallen a full buffer behind
+enum class LogOverflow { DropOldest, Block };
+
 class Logger {
 public:
+    // Opens the log file and starts the background writer
     static void init(const QString &logFilePath);
+    // Writes out everything queued and stops the writer; lines logged afterwards are discarded
+    static void shutdown();
+
+    // Info-level line in the General category
     static void log(const QString &msg);
+    // Queues the line for the writer thread; never touches the file itself
+    static void write(LogLevel level, LogCategory category, const QString &msg);
+
+    static void setOverflowPolicy(LogOverflow policy);
+    static LogOverflow overflowPolicy();
+
+    // Cheap enough to guard every call site; the LOG_* macros do so
+    static bool isEnabled(LogLevel level, LogCategory category) {
+        return static_cast<int>(level) >= thresholds_[static_cast<int>(category)].load(std::memory_order_relaxed);
+    }
+    // Lowest level written, for every category or just one
+    static void setLevel(LogLevel level);
+    static void setLevel(LogCategory category, LogLevel level);
+
+    static const char* levelName(LogLevel level);
+    static const char* categoryName(LogCategory category);
+    // Accepts the names returned by levelName(), case-insensitive; Info otherwise
+    static LogLevel levelFromString(const QString &name);
+    // "block" or "drop-oldest"; DropOldest otherwise
+    static LogOverflow overflowFromString(const QString &name);
+
+private:
+    inline static std::atomic<int> thresholds_[static_cast<int>(LogCategory::Count)] = {
+        static_cast<int>(LogLevel::Info), static_cast<int>(LogLevel::Info), static_cast<int>(LogLevel::Info),
+        static_cast<int>(LogLevel::Info), static_cast<int>(LogLevel::Info), static_cast<int>(LogLevel::Info),
+    };
 };
+
+// The message expression, usually a QString(...).arg(...) chain, is only
+// evaluated when the level is enabled for the category
+#define MAW_LOG(level, category, message)                       \
+    do {                                                        \
+        if (Logger::isEnabled(level, category)) {               \
+            Logger::write(level, category, message);            \
+        }                                                       \
+    } while (0)
+
+// Release builds define MAW_STRIP_TRACE_LOGS, compiling trace calls out entirely
+#ifdef MAW_STRIP_TRACE_LOGS
+#define LOG_TRACE(category, message) do { } while (0)
+#else
+#define LOG_TRACE(category, message) MAW_LOG(LogLevel::Trace, LogCategory::category, message)
+#endif
+#define LOG_DEBUG(category, message) MAW_LOG(LogLevel::Debug, LogCategory::category, message)
+#define LOG_INFO(category, message) MAW_LOG(LogLevel::Info, LogCategory::category, message)
+#define LOG_WARNING(category, message) MAW_LOG(LogLevel::Warning, LogCategory::category, message)
+#define LOG_ERROR(category, message) MAW_LOG(LogLevel::Error, LogCategory::category, message)
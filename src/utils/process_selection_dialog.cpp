@@ -1,4 +1,5 @@
 #include "process_selection_dialog.h"
+#include "trace_recorder.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QPushButton>
@@ -61,6 +62,7 @@ DWORD ProcessSelectionDialog::getSelectedPID() const {
 }
 
 void ProcessSelectionDialog::refreshProcesses() {
+    TraceSpan span("ProcessSelectionDialog::refreshProcesses", "gui");
     processList->clear();
     
     HANDLE hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
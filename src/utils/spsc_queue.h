@@ -0,0 +1,49 @@
+#pragma once
+#include <QtGlobal>
+#include <atomic>
+
+// Bounded single-producer, single-consumer ring. Each side only reads the
+// other's index and publishes its own with one release store, so push and
+// pop are wait-free: no locks, no retry loops, no allocation. Safe to call
+// from a low-level hook callback.
+template <typename T, quint32 Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SpscQueue() : head_(0), tail_(0) {}
+
+    // Producer side; false when full
+    bool tryPush(const T& item) {
+        const quint32 tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        items_[tail & (Capacity - 1)] = item;
+        tail_.store(tail + 1, std::memory_order_seq_cst);
+        return true;
+    }
+
+    // Consumer side; false when empty
+    bool tryPop(T* item) {
+        const quint32 head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        *item = items_[head & (Capacity - 1)];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool isEmpty() const {
+        return head_.load() == tail_.load();
+    }
+
+private:
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    alignas(64) std::atomic<quint32> head_;
+    alignas(64) std::atomic<quint32> tail_;
+    T items_[Capacity];
+};
@@ -0,0 +1,133 @@
+#include "trace_recorder.h"
+#include "logger.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QTextStream>
+#include <QThread>
+#include <vector>
+
+namespace {
+
+struct TraceEvent {
+    const char *name;
+    const char *category;
+    qint64 beginNs;
+    qint64 durationNs;
+    quint64 tid;
+};
+
+QMutex g_mutex;
+QElapsedTimer g_clock;
+std::vector<TraceEvent> g_events;
+QHash<quint64, QString> g_threadNames;
+quint64 g_dropped = 0;
+
+quint64 currentThreadId() {
+    // The native ID on Windows, so the viewer matches other tools' captures
+    return static_cast<quint64>(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+}
+
+QString currentThreadName(quint64 tid) {
+    QThread *thread = QThread::currentThread();
+    if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()) {
+        return "GUI";
+    }
+    if (thread && !thread->objectName().isEmpty()) {
+        return thread->objectName();
+    }
+    return QString("Thread %1").arg(tid);
+}
+
+QString jsonEscaped(const QString &text) {
+    QString escaped = text;
+    escaped.replace("\\", "\\\\");
+    escaped.replace("\"", "\\\"");
+    return escaped;
+}
+
+} // namespace
+
+void TraceRecorder::start() {
+    QMutexLocker lk(&g_mutex);
+    g_events.clear();
+    g_events.reserve(64 * 1024);
+    g_threadNames.clear();
+    g_dropped = 0;
+    g_clock.start();
+    enabled_.store(true, std::memory_order_relaxed);
+    Logger::log("Trace capture started");
+}
+
+qint64 TraceRecorder::now() {
+    return g_clock.nsecsElapsed();
+}
+
+void TraceRecorder::complete(const char *name, const char *category, qint64 beginNs) {
+    const qint64 endNs = now();
+    const quint64 tid = currentThreadId();
+
+    QMutexLocker lk(&g_mutex);
+    // Stopped while the span was open
+    if (!isEnabled()) {
+        return;
+    }
+    if (g_events.size() >= static_cast<size_t>(MAX_EVENTS)) {
+        ++g_dropped;
+        return;
+    }
+    if (!g_threadNames.contains(tid)) {
+        g_threadNames.insert(tid, currentThreadName(tid));
+    }
+    g_events.push_back(TraceEvent{name, category, beginNs, endNs - beginNs, tid});
+}
+
+bool TraceRecorder::stop(const QString &path, QString *error) {
+    std::vector<TraceEvent> events;
+    QHash<quint64, QString> threadNames;
+    quint64 dropped = 0;
+    {
+        QMutexLocker lk(&g_mutex);
+        enabled_.store(false, std::memory_order_relaxed);
+        events.swap(g_events);
+        threadNames.swap(g_threadNames);
+        dropped = g_dropped;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (error) *error = file.errorString();
+        Logger::log(QString("Failed to write trace to %1: %2").arg(path, file.errorString()));
+        return false;
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QTextStream ts(&file);
+    ts << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (auto it = threadNames.constBegin(); it != threadNames.constEnd(); ++it) {
+        ts << (first ? "" : ",\n")
+           << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid << ",\"tid\":" << it.key()
+           << ",\"args\":{\"name\":\"" << jsonEscaped(it.value()) << "\"}}";
+        first = false;
+    }
+    // Complete events, in microseconds with nanosecond precision
+    for (const TraceEvent &event : events) {
+        ts << (first ? "" : ",\n")
+           << "{\"ph\":\"X\",\"name\":\"" << event.name << "\",\"cat\":\"" << event.category
+           << "\",\"pid\":" << pid << ",\"tid\":" << event.tid
+           << ",\"ts\":" << QString::number(event.beginNs / 1000.0, 'f', 3)
+           << ",\"dur\":" << QString::number(event.durationNs / 1000.0, 'f', 3) << "}";
+        first = false;
+    }
+    ts << "\n]}\n";
+    ts.flush();
+
+    Logger::log(QString("Trace capture written to %1: %2 spans%3")
+                .arg(path)
+                .arg(events.size())
+                .arg(dropped > 0 ? QString(", %1 dropped").arg(dropped) : QString()));
+    return true;
+}
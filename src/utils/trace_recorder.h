@@ -0,0 +1,49 @@
+#pragma once
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+
+// Optional capture of hot-path spans as Chrome trace-event JSON, which
+// chrome://tracing and ui.perfetto.dev open directly. Off by default; while
+// off, every span costs one relaxed atomic load.
+class TraceRecorder {
+public:
+    static bool isEnabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    // Discards any earlier capture and starts a new one
+    static void start();
+    // Stops capturing and writes the capture to `path`
+    static bool stop(const QString &path, QString *error = nullptr);
+
+    // Nanoseconds since start()
+    static qint64 now();
+    // Record a span from `beginNs` to now on the calling thread. `name` and
+    // `category` must be string literals; they are stored as pointers.
+    static void complete(const char *name, const char *category, qint64 beginNs);
+
+    // Spans stored per capture; later ones are counted and dropped
+    static constexpr int MAX_EVENTS = 1000000;
+
+private:
+    inline static std::atomic<bool> enabled_{false};
+};
+
+// Times its own scope into the trace when a capture is running
+class TraceSpan {
+public:
+    TraceSpan(const char *name, const char *category)
+        : name_(name), category_(category), beginNs_(TraceRecorder::isEnabled() ? TraceRecorder::now() : -1) {}
+    ~TraceSpan() {
+        if (beginNs_ >= 0) {
+            TraceRecorder::complete(name_, category_, beginNs_);
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char *name_;
+    const char *category_;
+    qint64 beginNs_;
+};
@@ -0,0 +1,19 @@
+# Turns a flight.bin left by MuteActiveWindowC into readable text:
+#   flight_decode [path/to/flight.bin]
+QT = core
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = flight_decode
+
+SOURCES += \
+    main.cpp \
+    ../../src/utils/flight_recorder.cpp \
+    ../../src/utils/logger.cpp
+
+HEADERS += \
+    ../../src/utils/flight_recorder.h \
+    ../../src/utils/logger.h
+
+INCLUDEPATH += ../../src/utils
@@ -0,0 +1,27 @@
+#include "flight_recorder.h"
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+#include <cstdio>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    const QStringList args = QCoreApplication::arguments();
+    const QString path = args.size() > 1 ? args.at(1) : QString("flight.bin");
+
+    QString error;
+    const QStringList lines = FlightRecorder::decode(path, &error);
+    if (!error.isEmpty()) {
+        err << path << ": " << error << "\n";
+        return 1;
+    }
+    for (const QString& line : lines) {
+        out << line << "\n";
+    }
+    err << lines.size() << " records\n";
+    return 0;
+}
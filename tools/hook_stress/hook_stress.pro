@@ -0,0 +1,30 @@
+# Stress test for the keyboard hook thread (Windows only). Injects a bound
+# hotkey while the main thread is idle, then while it is blocked, and reports
+# how long each press took to reach the hook dispatcher:
+#   hook_stress [--presses N] [--block-ms MS]
+QT = core gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = hook_stress
+
+SOURCES += \
+    main.cpp \
+    ../../src/utils/hotkey_matcher.cpp \
+    ../../src/utils/keyboard_hook.cpp \
+    ../../src/utils/latency_stats.cpp \
+    ../../src/utils/logger.cpp \
+    ../../src/utils/trace_recorder.cpp
+
+HEADERS += \
+    ../../src/utils/hotkey_matcher.h \
+    ../../src/utils/keyboard_hook.h \
+    ../../src/utils/latency_stats.h \
+    ../../src/utils/logger.h \
+    ../../src/utils/spsc_queue.h \
+    ../../src/utils/trace_recorder.h
+
+INCLUDEPATH += ../../src/utils
+
+LIBS += -luser32
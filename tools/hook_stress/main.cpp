@@ -0,0 +1,141 @@
+// Injects Ctrl+Alt+Shift+F24 with SendInput, first while the main thread
+// keeps processing events and then while it sleeps the way a busy GUI thread
+// would, and measures each press from injection to the hook dispatcher. With
+// the hook on its own thread both phases should look alike; a hook pumped by
+// the main thread would stall the second one (and all keyboard input) until
+// Windows gave up on it.
+//
+// The keystrokes are real: they reach whatever window has focus.
+
+#include "keyboard_hook.h"
+#include "latency_stats.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QKeyCombination>
+#include <QSemaphore>
+#include <QTextStream>
+#include <QThread>
+#include <Windows.h>
+#include <atomic>
+
+static const int STRESS_ACTION_ID = 0x5157;
+// A press that has not reached the dispatcher by then counts as missed
+static const int PRESS_TIMEOUT_MS = 1000;
+
+static QElapsedTimer g_clock;
+static std::atomic<qint64> g_injectedNs(0);
+static std::atomic<qint64> g_latencyNs(0);
+static QSemaphore g_dispatched;
+
+static void addKey(INPUT* input, WORD vk, bool down) {
+    ZeroMemory(input, sizeof(INPUT));
+    input->type = INPUT_KEYBOARD;
+    input->ki.wVk = vk;
+    input->ki.dwFlags = down ? 0 : KEYEVENTF_KEYUP;
+}
+
+// One full press and release of the chord
+static void injectChord() {
+    INPUT inputs[8];
+    addKey(&inputs[0], VK_LCONTROL, true);
+    addKey(&inputs[1], VK_LMENU, true);
+    addKey(&inputs[2], VK_LSHIFT, true);
+    addKey(&inputs[3], VK_F24, true);
+    addKey(&inputs[4], VK_F24, false);
+    addKey(&inputs[5], VK_LSHIFT, false);
+    addKey(&inputs[6], VK_LMENU, false);
+    addKey(&inputs[7], VK_LCONTROL, false);
+    g_injectedNs = g_clock.nsecsElapsed();
+    SendInput(8, inputs, sizeof(INPUT));
+}
+
+static QString formatUs(qint64 nsecs) {
+    return QString("%1 us").arg(nsecs / 1e3, 0, 'f', 1);
+}
+
+static void runPhase(QTextStream& out, const char *name, bool blockMainThread, int presses, int blockMs, int intervalMs) {
+    LatencyHistogram latency;
+    int missed = 0;
+
+    QThread *injector = QThread::create([&] {
+        for (int i = 0; i < presses; ++i) {
+            while (g_dispatched.tryAcquire()) {
+                // A late dispatch from an earlier, missed press
+            }
+            injectChord();
+            if (g_dispatched.tryAcquire(1, PRESS_TIMEOUT_MS)) {
+                latency.record(g_latencyNs.load());
+            } else {
+                ++missed;
+            }
+            QThread::msleep(intervalMs);
+        }
+    });
+    injector->start();
+    while (!injector->isFinished()) {
+        if (blockMainThread) {
+            Sleep(blockMs);
+        } else {
+            QCoreApplication::processEvents();
+            QThread::msleep(1);
+        }
+    }
+    injector->wait();
+    delete injector;
+
+    const LatencyHistogram::Summary s = latency.summary();
+    out << name << ": " << s.count << " presses, " << missed << " missed";
+    if (s.count > 0) {
+        out << ", p50 " << formatUs(s.p50Ns) << ", p95 " << formatUs(s.p95Ns)
+            << ", p99 " << formatUs(s.p99Ns) << ", max " << formatUs(s.maxNs);
+    }
+    out << "\n";
+    out.flush();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("hook_stress");
+    QTextStream out(stdout);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures keyboard hook responsiveness while the main thread is blocked. "
+                                     "Injects Ctrl+Alt+Shift+F24 into the desktop session.");
+    parser.addHelpOption();
+    QCommandLineOption pressesOption("presses", "Presses per phase (default 200).", "n", "200");
+    QCommandLineOption blockOption("block-ms", "How long the main thread blocks at a time (default 500).", "ms", "500");
+    QCommandLineOption intervalOption("interval-ms", "Pause between presses (default 10).", "ms", "10");
+    parser.addOption(pressesOption);
+    parser.addOption(blockOption);
+    parser.addOption(intervalOption);
+    parser.process(app);
+    const int presses = qMax(1, parser.value(pressesOption).toInt());
+    const int blockMs = qMax(1, parser.value(blockOption).toInt());
+    const int intervalMs = qMax(0, parser.value(intervalOption).toInt());
+
+    g_clock.start();
+    KeyboardHook& hook = KeyboardHook::instance();
+    // Emitted on the dispatcher thread; a direct connection keeps the main thread out of the measurement
+    QObject::connect(&hook, &KeyboardHook::actionTriggered, &app, [](int actionId) {
+        if (actionId == STRESS_ACTION_ID) {
+            g_latencyNs = g_clock.nsecsElapsed() - g_injectedNs.load();
+            g_dispatched.release();
+        }
+    }, Qt::DirectConnection);
+    hook.setBinding(STRESS_ACTION_ID, QKeySequence(QKeyCombination(Qt::ControlModifier | Qt::AltModifier | Qt::ShiftModifier, Qt::Key_F24)));
+    if (!hook.installHook()) {
+        out << "Could not install the keyboard hook\n";
+        return 1;
+    }
+
+    runPhase(out, "main thread idle", false, presses, blockMs, intervalMs);
+    runPhase(out, "main thread blocked", true, presses, blockMs, intervalMs);
+
+    const LatencyHistogram::Summary callback = LatencyStats::summary(LatencyStage::HookCallback);
+    out << "hook callback: " << callback.count << " key events, worst " << formatUs(callback.maxNs) << "\n";
+
+    hook.uninstallHook();
+    return 0;
+}
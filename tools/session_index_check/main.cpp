@@ -0,0 +1,270 @@
+// Drives AudioSessionIndex through SimulatedAudioBackend with a random mix of
+// session and device changes, invalidations and resyncs. Whenever the index
+// reports itself live it must hold exactly the sessions the backend has, once
+// each, under every key it is looked up by.
+
+#include "audio_session_index.h"
+#include "exclusion_set.h"
+#include "simulated_audio_backend.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+#include <algorithm>
+
+namespace {
+
+constexpr int DEVICE_COUNT = 4;
+constexpr int PROCESS_COUNT = 12;
+
+// xorshift64*, so a failing seed replays the same steps on every platform
+class Random {
+public:
+    explicit Random(quint64 seed) : state_(seed ? seed : 1) {}
+    quint64 next() {
+        state_ ^= state_ >> 12;
+        state_ ^= state_ << 25;
+        state_ ^= state_ >> 27;
+        return state_ * 0x2545f4914f6cdd1dull;
+    }
+    int below(int n) { return static_cast<int>(next() % static_cast<quint64>(n)); }
+
+private:
+    quint64 state_;
+};
+
+QString deviceId(int device) {
+    return QString("{check-device-%1}").arg(device);
+}
+
+// Casing varies between sessions of one process, as the system reports it
+QString exeName(quint32 pid, int variant) {
+    const QString name = QString("app%1.exe").arg(pid - 1000);
+    switch (variant % 3) {
+    case 1: return name.toUpper();
+    case 2: return QString("App%1.Exe").arg(pid - 1000);
+    }
+    return name;
+}
+
+QSet<quint64> idsOf(const QVector<AudioSessionEntry>& entries, QString *duplicate) {
+    QSet<quint64> ids;
+    for (const AudioSessionEntry& entry : entries) {
+        if (ids.contains(entry.sessionId)) {
+            *duplicate = QString("session %1 listed twice").arg(entry.sessionId);
+        }
+        ids.insert(entry.sessionId);
+    }
+    return ids;
+}
+
+// What the index should hold: the backend's sessions, tracked from the steps applied to it
+class Model {
+public:
+    void add(const AudioSessionEntry& entry) { sessions_.insert(entry.sessionId, entry); }
+    void remove(quint64 sessionId) { sessions_.remove(sessionId); }
+    void removeDevice(const QString& deviceId) {
+        for (auto it = sessions_.begin(); it != sessions_.end();) {
+            if (it->deviceId == deviceId) {
+                it = sessions_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    QVector<quint64> ids() const {
+        const QList<quint64> keys = sessions_.keys();
+        return QVector<quint64>(keys.begin(), keys.end());
+    }
+    bool isEmpty() const { return sessions_.isEmpty(); }
+
+    // Empty when `index` matches the model; the first difference otherwise
+    QString compare(const AudioSessionIndex& index) const {
+        if (index.sessionCount() != sessions_.size()) {
+            return QString("index holds %1 sessions, backend %2").arg(index.sessionCount()).arg(sessions_.size());
+        }
+
+        QHash<quint32, QSet<quint64>> byPID;
+        QHash<QString, QSet<quint64>> byExe;
+        QHash<QString, QSet<quint64>> byDevice;
+        for (const AudioSessionEntry& entry : sessions_) {
+            byPID[entry.pid].insert(entry.sessionId);
+            byExe[entry.processKey].insert(entry.sessionId);
+            byDevice[entry.deviceId].insert(entry.sessionId);
+        }
+
+        QString duplicate;
+        for (quint32 pid = 1000; pid < 1000 + PROCESS_COUNT; ++pid) {
+            if (idsOf(index.sessionsForPID(pid), &duplicate) != byPID.value(pid) || !duplicate.isEmpty()) {
+                return QString("PID %1: %2").arg(pid).arg(duplicate.isEmpty() ? QString("wrong sessions") : duplicate);
+            }
+            // Looked up with a spelling no session was added under
+            const QString lookupName = exeName(pid, 2).toLower().replace(".exe", ".EXE");
+            const QString key = ExclusionSet::normalizeProcessName(lookupName);
+            if (idsOf(index.sessionsForExeName(lookupName), &duplicate) != byExe.value(key) || !duplicate.isEmpty()) {
+                return QString("%1: %2").arg(lookupName, duplicate.isEmpty() ? QString("wrong sessions") : duplicate);
+            }
+        }
+        for (int device = 0; device < DEVICE_COUNT; ++device) {
+            const QString id = deviceId(device);
+            if (idsOf(index.sessionsForDevice(id), &duplicate) != byDevice.value(id) || !duplicate.isEmpty()) {
+                return QString("%1: %2").arg(id, duplicate.isEmpty() ? QString("wrong sessions") : duplicate);
+            }
+        }
+
+        QVector<quint32> pids = index.pids();
+        std::sort(pids.begin(), pids.end());
+        const QList<quint32> keys = byPID.keys();
+        QVector<quint32> expected(keys.begin(), keys.end());
+        std::sort(expected.begin(), expected.end());
+        if (pids != expected) {
+            return QString("pids() lists %1 PIDs, backend has %2").arg(pids.size()).arg(expected.size());
+        }
+        return QString();
+    }
+
+private:
+    QHash<quint64, AudioSessionEntry> sessions_;
+};
+
+// A session reported twice, as when a creation notification races an
+// enumeration, is indexed once
+QString checkDuplicateReport() {
+    AudioSessionIndex index;
+    AudioSessionEntry entry;
+    entry.sessionId = 7;
+    entry.deviceId = deviceId(0);
+    entry.pid = 1000;
+    entry.exeName = exeName(1000, 0);
+    entry.processKey = ExclusionSet::normalizeProcessName(entry.exeName);
+    index.sessionAdded(entry);
+
+    // Same session, now seen on another device under other casing
+    entry.deviceId = deviceId(1);
+    entry.exeName = exeName(1000, 1);
+    entry.processKey = ExclusionSet::normalizeProcessName(entry.exeName);
+    index.sessionAdded(entry);
+    index.synced();
+
+    Model model;
+    model.add(entry);
+    return model.compare(index);
+}
+
+// Random steps against the backend; returns the first failure, if any
+QString checkRandomSteps(quint64 seed, int steps, int *resyncs) {
+    SimulatedAudioBackend backend;
+    for (int device = 0; device < DEVICE_COUNT; ++device) {
+        backend.addDevice(deviceId(device), QString("Check Device %1").arg(device));
+    }
+    AudioSessionIndex index;
+    if (!backend.start(&index)) {
+        return "backend did not start";
+    }
+
+    Model model;
+    Random random(seed);
+    for (int step = 0; step < steps; ++step) {
+        QString action;
+        const int roll = random.below(100);
+        if (roll < 45 || model.isEmpty()) {
+            const int device = random.below(DEVICE_COUNT);
+            const quint32 pid = 1000 + random.below(PROCESS_COUNT);
+            const QString name = exeName(pid, random.below(3));
+            const quint64 id = backend.addSession(deviceId(device), pid, name);
+            AudioSessionEntry entry;
+            entry.sessionId = id;
+            entry.deviceId = deviceId(device);
+            entry.pid = pid;
+            entry.exeName = name;
+            entry.processKey = ExclusionSet::normalizeProcessName(name);
+            model.add(entry);
+            action = QString("add session %1").arg(id);
+        } else if (roll < 80) {
+            const QVector<quint64> ids = model.ids();
+            const quint64 id = ids.at(random.below(ids.size()));
+            backend.removeSession(id);
+            model.remove(id);
+            action = QString("remove session %1").arg(id);
+        } else if (roll < 85) {
+            const int device = random.below(DEVICE_COUNT);
+            backend.removeDevice(deviceId(device));
+            model.removeDevice(deviceId(device));
+            // Back again, empty, as when a headset is replugged
+            backend.addDevice(deviceId(device), QString("Check Device %1").arg(device));
+            action = QString("remove device %1").arg(device);
+        } else if (roll < 93) {
+            backend.invalidate();
+            if (index.isLive()) {
+                return QString("step %1: still live after invalidate").arg(step);
+            }
+            action = "invalidate";
+        } else {
+            if (!index.isLive()) {
+                ++*resyncs;
+            }
+            backend.resyncIfNeeded();
+            action = "resync";
+        }
+
+        if (index.isLive()) {
+            const QString failure = model.compare(index);
+            if (!failure.isEmpty()) {
+                return QString("step %1 (%2): %3").arg(step).arg(action, failure);
+            }
+        }
+    }
+
+    // Whatever happened while invalidated, a resync ends on the backend's view
+    backend.resyncIfNeeded();
+    if (!index.isLive()) {
+        return "not live after the final resync";
+    }
+    const QString failure = model.compare(index);
+    return failure.isEmpty() ? QString() : QString("after the final resync: %1").arg(failure);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Checks AudioSessionIndex against SimulatedAudioBackend.");
+    parser.addHelpOption();
+    QCommandLineOption seedsOption("seeds", "Number of random runs (default 50).", "n", "50");
+    QCommandLineOption stepsOption("steps", "Steps per run (default 2000).", "n", "2000");
+    parser.addOption(seedsOption);
+    parser.addOption(stepsOption);
+    parser.process(app);
+
+    const int seeds = qMax(1, parser.value(seedsOption).toInt());
+    const int steps = qMax(1, parser.value(stepsOption).toInt());
+
+    int failures = 0;
+    const QString duplicate = checkDuplicateReport();
+    if (!duplicate.isEmpty()) {
+        err << "duplicate report: FAILED: " << duplicate << "\n";
+        ++failures;
+    }
+
+    int resyncs = 0;
+    for (int run = 0; run < seeds; ++run) {
+        const quint64 seed = 0x9e3779b97f4a7c15ull * (run + 1);
+        const QString failure = checkRandomSteps(seed, steps, &resyncs);
+        if (!failure.isEmpty()) {
+            err << "seed " << run + 1 << ": FAILED: " << failure << "\n";
+            ++failures;
+        }
+    }
+
+    out << seeds << " runs of " << steps << " steps, " << resyncs << " resyncs, "
+        << failures << " failure(s)\n";
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,27 @@
+# Checks AudioSessionIndex against SimulatedAudioBackend: random session and
+# device changes, invalidations and resyncs, with the index compared to the
+# backend after every step. Builds and runs without Windows:
+#   session_index_check [--seeds N] [--steps N]
+QT = core
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = session_index_check
+
+SOURCES += \
+    main.cpp \
+    ../../src/audio/audio_session_index.cpp \
+    ../../src/audio/simulated_audio_backend.cpp \
+    ../../src/config/exclusion_set.cpp
+
+HEADERS += \
+    ../../src/audio/audio_backend.h \
+    ../../src/audio/audio_session_index.h \
+    ../../src/audio/process_tree.h \
+    ../../src/audio/simulated_audio_backend.h \
+    ../../src/config/exclusion_set.h
+
+INCLUDEPATH += ../../src/audio \
+               ../../src/config \
+               ../../src/utils